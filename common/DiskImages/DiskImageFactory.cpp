@@ -1,4 +1,6 @@
 #include "DiskImageFactory.h"
+#include <algorithm>
+#include <stdio.h>
 
 DiskImageFactory::~DiskImageFactory()
 {
@@ -15,9 +17,35 @@ void DiskImageFactory::RegisterDiskImageFormat( IDiskImageInterface* _diskImageI
 
 IDiskImageInterface* DiskImageFactory::LoadDiskImage( const std::string& _filename )
 {
+	// Read the start of the file once and let every format score it.
+	FILE* pIn = fopen( _filename.c_str(), "rb" );
+	if( nullptr == pIn )
+	{
+		return nullptr;
+	}
+
+	unsigned char header[DISK_IMAGE_PROBE_SIZE];
+	size_t headerSize = fread( header, 1, DISK_IMAGE_PROBE_SIZE, pIn );
+	fseek( pIn, 0, SEEK_END );
+	size_t fileSize = (size_t)ftell( pIn );
+	fclose( pIn );
+
+	std::vector< std::pair<int, IDiskImageInterface*> > candidates;
 	for( auto diskImage: m_DiskImages )
 	{
-		IDiskImageInterface* retVal = diskImage->NewImage();
+		int score = diskImage->Probe( header, headerSize, fileSize );
+		if( DISK_IMAGE_PROBE_NO != score )
+		{
+			candidates.push_back( std::make_pair( score, diskImage ) );
+		}
+	}
+
+	// Best scores first. Ties keep the registration order.
+	std::stable_sort( candidates.begin(), candidates.end(), []( const std::pair<int, IDiskImageInterface*>& _a, const std::pair<int, IDiskImageInterface*>& _b ) { return _a.first > _b.first; } );
+
+	for( auto& candidate: candidates )
+	{
+		IDiskImageInterface* retVal = candidate.second->NewImage();
 		if( retVal->Load( _filename ) )
 		{
 			return retVal;
@@ -15,9 +15,18 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #define DISK_IMAGE_INTERFACE_INVALID 0xFFFFFFFF
 
+// Probe scores. See IDiskImageInterface::Probe.
+#define DISK_IMAGE_PROBE_NO        0   // The file is not in this format
+#define DISK_IMAGE_PROBE_FALLBACK  1   // Format accepts anything, try it last
+#define DISK_IMAGE_PROBE_UNKNOWN   10  // Format can't tell without loading
+#define DISK_IMAGE_PROBE_LIKELY    50  // Header or size is consistent with the format
+#define DISK_IMAGE_PROBE_CERTAIN   100 // Signature matches
+#define DISK_IMAGE_PROBE_SIZE      4096 // Bytes from the start of the file given to Probe
+
 struct STrackInfo
 {
 	bool	isValid;
@@ -36,6 +45,21 @@ struct SSectorInfo
 	size_t  dataSize;
 };
 
+// Data of one stored copy of a sector.
+struct SSectorCopy
+{
+	const unsigned char* data;
+	size_t               dataSize;
+};
+
+// Run of consecutive sectors stored back to back in memory.
+struct SSectorSpan
+{
+	const unsigned char* data;
+	size_t               dataSize;
+	unsigned int         sectorsNum;
+};
+
 class IDiskImageInterface
 {
 public:
@@ -59,6 +83,49 @@ public:
 	virtual unsigned int			GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const { return (unsigned char)(uSector & 0xFF); }
 	virtual const unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const = 0;
 
+	// Fills _copies with every sector on the track with the given ID, in track order.
+	// Copy protected disks may repeat IDs, and weak sectors add one entry per stored copy.
+	// Returns the number of copies found.
+	virtual size_t					GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const
+	{
+		_copies.clear();
+		for( int sector = 0; sector < GetSectorsNum( uSide, uTrack ); ++sector )
+		{
+			if( GetSectorID( uTrack, uSide, sector ) == uSectorID )
+			{
+				const unsigned char* data = GetSector( uTrack, uSide, sector );
+				if( nullptr != data )
+				{
+					_copies.push_back( { data, GetSectorInfo( uTrack, uSide, sector ).dataSize } );
+				}
+			}
+		}
+		return _copies.size();
+	}
+
+	// Returns the longest run of up to uMaxSectors sectors starting at the given one that are stored
+	// back to back, following the order of logical sector numbers: sectors of a side, then sides of
+	// a track, then tracks. Images that don't store sectors that way return one sector per span.
+	// data is nullptr and sectorsNum 0 if the first sector doesn't exist.
+	virtual SSectorSpan				GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const
+	{
+		SSectorSpan span = { nullptr, 0, 0 };
+		if( uMaxSectors > 0 )
+		{
+			SSectorInfo info = GetSectorInfo( uTrack, uSide, uSector );
+			if( info.isValid )
+			{
+				span.data = GetSector( uTrack, uSide, uSector );
+				if( nullptr != span.data )
+				{
+					span.dataSize   = info.dataSize;
+					span.sectorsNum = 1;
+				}
+			}
+		}
+		return span;
+	}
+
 	virtual std::string 			GetFileSpec() = 0;
 	virtual std::string 			GetDiskInfo() = 0;
 
@@ -75,6 +142,11 @@ public:
 	virtual void					SetSectorSize( size_t _size     ) {}
 
 	virtual IDiskImageInterface*	NewImage() const = 0;
+
+	// Scores how likely a file is to be in this format from its first bytes (up to
+	// DISK_IMAGE_PROBE_SIZE) and its size, without opening it. DiskImageFactory only
+	// loads the formats with the highest scores.
+	virtual int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const { return DISK_IMAGE_PROBE_UNKNOWN; }
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	// Copy and uncomment the block below into your derived class' header file.
@@ -96,6 +168,8 @@ public:
 	// 		unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 	// 		unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	// const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+	// 		size_t			GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const override;
+	// 		SSectorSpan		GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const override;
 
 	// std::string 			GetFileSpec() override;
 	// std::string 			GetDiskInfo() override;
@@ -113,5 +187,7 @@ public:
 	// bool 					NeedManualSetup() const override { return false; }
 
 	// IDiskImageInterface*	NewImage() const override { return new ; }
+
+	// int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 };
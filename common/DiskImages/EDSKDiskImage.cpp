@@ -11,6 +11,7 @@
 ///////////////////////////////////////////////////////////////////
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <algorithm>
 #include <math.h>
 #include <sstream>
 #include <stdio.h>
@@ -29,6 +30,8 @@ CEDSKDiskImage::CEDSKDiskImage()
 {
 	lastError = "No error.";
 	isExtendedDSK = false;
+	lazyLoad = false;
+	writeOffsetInfo = false;
 }
 
 //////////////////////////////////////////
@@ -50,9 +53,13 @@ CEDSKDiskImage::~CEDSKDiskImage()
 //////////////////////////////////////////
 bool CEDSKDiskImage::Load(const std::string& _filename)
 {
-	// Open File
-	FILE* pIn = fopen(_filename.c_str(),"rb");
-	if( NULL == pIn )
+	// Clear data. Any other info from a previous load will be overwritten.
+	diskInfoBlock.trackSizeTable.clear();
+	sides[0].clear();
+	sides[1].clear();
+
+	// Map the whole file. Sector data is used in place from there.
+	if( !dataBlock.Open(_filename) )
 	{
 		lastError = "Could not open file ";
 		lastError += _filename;
@@ -62,71 +69,103 @@ bool CEDSKDiskImage::Load(const std::string& _filename)
 	}
 
 	// Check file size. Must be at least 256 bytes long to be able to read the header
-	fseek(pIn,0,SEEK_END);
-	size_t fileSize = ftell(pIn);
-	fseek(pIn,0,SEEK_SET);
-
-	if( fileSize < 256 )
+	if( dataBlock.GetSize() < 256 )
 	{
 		lastError = "File ";
 		lastError += _filename;
 		lastError += " is less than 256 bytes long. It's either corrupted or not a .DSK file.";
 
+		dataBlock.Close();
 		return false;
 	}
 
-	// Clear data. Any other info from a previous load will be overwritten.
-	diskInfoBlock.trackSizeTable.clear();
-	sides[0].clear();
-	sides[1].clear();
-
 	// Read DISK INFORMATION BLOCK
-	ReadDiskInformationBlock(pIn);
+	ReadDiskInformationBlock();
 
 	// Sanity checks
 	if( diskInfoBlock.sidesNum > CEDSKFile_MAX_SIDES_NUM )
 	{
+		dataBlock.Close();
 		return false;
 	}
 
 	if( diskInfoBlock.header.compare(0,2,"MV",2) != 0 && diskInfoBlock.header.compare(0,8,"EXTENDED",8) != 0 )
 	{
+		dataBlock.Close();
 		return false; // Not a normal or extended DSK file
 	}
 
+	// Locate tracks. Extended DSK tracks are found by summing the track size table,
+	// standard ones all have the same size. An Offset-Info block after the last
+	// track, if present, gives the offsets directly.
+	size_t              tracksNum = diskInfoBlock.tracksNum * diskInfoBlock.sidesNum;
+	std::vector<size_t> trackOffsets( tracksNum, 0 );
+	size_t              fileOffset = 256;
+	for( size_t trackIdx = 0; trackIdx < tracksNum; ++trackIdx )
+	{
+		if( isExtendedDSK )
+		{
+			trackOffsets[trackIdx] = diskInfoBlock.trackSizeTable[trackIdx] ? fileOffset : 0;
+			fileOffset += diskInfoBlock.trackSizeTable[trackIdx] * 256;
+		}
+		else
+		{
+			trackOffsets[trackIdx] = fileOffset;
+			fileOffset += diskInfoBlock.trackSize;
+		}
+	}
+
+	writeOffsetInfo = ReadOffsetInfo( fileOffset, trackOffsets );
+
 	// Read tracks
+	fileOffset = 256;
 	for( unsigned short int track = 0; track < diskInfoBlock.tracksNum; ++track )
 	{
 		for( unsigned char side = 0; side < diskInfoBlock.sidesNum; ++side )
 		{
+			size_t trackIdx = (track * diskInfoBlock.sidesNum) + side;
+
+			CEDSKFile_TrackInfoBlock tib;
+			tib.isUnformatted = false;
+			tib.isLoaded      = false;
+			tib.fileOffset    = trackOffsets[trackIdx];
+			tib.sectorsNum    = 0;
+			BuildSectorIDIndex(tib);
+
 			// Read Track info block if this is not an extended DSK, or if the disk is an
 			// extended DSK and thus the track size table has a non-zero value.
-			if( !isExtendedDSK || diskInfoBlock.trackSizeTable[ (track * diskInfoBlock.sidesNum) + side] )
+			if( isExtendedDSK && !diskInfoBlock.trackSizeTable[trackIdx] )
 			{
-				size_t fileOffset = ftell(pIn);
+				// Insert unformatted track info
+				tib.isUnformatted = true;
+				tib.isLoaded      = true;
+			}
+			else if( !lazyLoad )
+			{
+				// Standard DSK tracks are read one after the other, unless their offsets are known.
+				if( !isExtendedDSK && !writeOffsetInfo )
+				{
+					tib.fileOffset = fileOffset;
+				}
 
-				if( !ReadTrackInformationBlock(pIn) )
+				fileOffset = tib.fileOffset;
+				if( !ReadTrackInformationBlock(fileOffset,tib) )
 				{
-					fclose(pIn);
+					lastError = "File ";
+					lastError += _filename;
+					lastError += " has a corrupted or truncated track.";
+
+					sides[0].clear();
+					sides[1].clear();
+					dataBlock.Close();
 					return false;
 				}
-
-				if( isExtendedDSK )
-					fseek( pIn, fileOffset + (diskInfoBlock.trackSizeTable[ (track * diskInfoBlock.sidesNum) + side]*256),SEEK_SET );
-			}
-			else
-			{
-				// Insert unformatted track info
-				CEDSKFile_TrackInfoBlock tib;
-				tib.isUnformatted = true;
-				sides[side].push_back(tib);
 			}
+
+			sides[side].push_back(tib);
 		}
 	}
 
-	// Close file
-	fclose(pIn);
-
 	fileName = _filename;
 
 	// Fix extra tracks
@@ -156,6 +195,18 @@ bool CEDSKDiskImage::Load(const std::string& _filename)
 //////////////////////////////////////////
 bool CEDSKDiskImage::Save(const std::string& _filename)
 {
+	LoadAllTracks();
+
+	// The file is about to be rewritten, so stop using it as sector storage.
+	if( dataBlock.IsSameFile(_filename) && !dataBlock.Detach() )
+	{
+		lastError = "Could not copy the sector data of ";
+		lastError += _filename;
+		lastError += " to memory.";
+
+		return false;
+	}
+
 	// Open File
 	FILE* pOut = fopen(_filename.c_str(),"wb");
 	if( NULL == pOut )
@@ -171,14 +222,21 @@ bool CEDSKDiskImage::Save(const std::string& _filename)
 	WriteDiskInformationBlock(pOut);
 
 	// Write tracks
+	std::vector<size_t> trackOffsets;
 	for( unsigned short int track = 0; track < diskInfoBlock.tracksNum; ++track )
 	{
 		for( unsigned char side = 0; side < diskInfoBlock.sidesNum; ++side )
 		{
+			trackOffsets.push_back( sides[side][track].isUnformatted ? 0 : (size_t)ftell(pOut) );
 			WriteTrackInformationBlock(pOut,sides[side][track]);
 		}
 	}
 
+	if( writeOffsetInfo )
+	{
+		WriteOffsetInfo(pOut,trackOffsets);
+	}
+
 	// Close File
 	fclose(pOut);
 
@@ -211,8 +269,16 @@ unsigned int CEDSKDiskImage::New(unsigned char uTracks, unsigned char uSides, un
 	emptySectorInfo.FDCStatus2 = 0;
 	emptySectorInfo.dataLength = 0;
 
-	uint8vector emptySectorData;
-	emptySectorData.insert( emptySectorData.begin(), uSectorSize, 0xE5 );
+	emptySectorInfo.dataSize   = (unsigned short int)uSectorSize;
+
+	if( !dataBlock.Allocate( uSides * uTracks * uSecsPerTrack * uSectorSize ) )
+	{
+		diskInfoBlock.tracksNum = 0;
+		diskInfoBlock.sidesNum  = 0;
+		return 0;
+	}
+	memset( dataBlock.GetData(), 0xE5, dataBlock.GetSize() );
+	size_t dataOffset = 0;
 
 	// Fill tracks
 	CEDSKFile_TrackInfoBlock emptyTrack;
@@ -221,16 +287,14 @@ unsigned int CEDSKDiskImage::New(unsigned char uTracks, unsigned char uSides, un
 	emptyTrack.gap3Length = 0x4E;
 	emptyTrack.header = "Track-Info\r\n";
 	emptyTrack.isUnformatted = false;
+	emptyTrack.isLoaded = true;
+	emptyTrack.fileOffset = 0;
 	emptyTrack.recordingMode = 0;
 	emptyTrack.sectorsNum = uSecsPerTrack;
 	emptyTrack.sectorSize = shiftFactor;
 	emptyTrack.unused[0] = 0;
 	emptyTrack.unused[1] = 0;
 	emptyTrack.unused[2] = 0;
-	for( unsigned char sector = 0; sector < uSecsPerTrack; ++sector )
-	{
-		emptyTrack.sectorData.push_back( emptySectorData );
-	}
 
 	for( unsigned short int track = 0; track < diskInfoBlock.tracksNum; ++track )
 	{
@@ -244,9 +308,12 @@ unsigned int CEDSKDiskImage::New(unsigned char uTracks, unsigned char uSides, un
 				emptySectorInfo.side		= side;
 				emptySectorInfo.track		= track;
 				emptySectorInfo.sectorID	= sector;
-				
+				emptySectorInfo.dataOffset	= dataOffset;
+				dataOffset += uSectorSize;
+
 				emptyTrack.sectorInfoList.push_back(emptySectorInfo);
 			}
+			BuildSectorIDIndex( emptyTrack );
 			sides[side].push_back( emptyTrack );
 		}
 	}
@@ -258,36 +325,32 @@ unsigned int CEDSKDiskImage::New(unsigned char uTracks, unsigned char uSides, un
 // ReadDiskInformationBlock - Read a CEDSKFile_DiskInfoBlock structure
 //                            from an open file.
 ///////////////////////////////////////////////////////////////////////
-void CEDSKDiskImage::ReadDiskInformationBlock(FILE* _pIn)
+void CEDSKDiskImage::ReadDiskInformationBlock()
 {
+	const unsigned char* data = dataBlock.GetData();
 	char tmpBuf[35];
 
 	// Read header string
 	memset(tmpBuf,0,35);
-	fread(tmpBuf,1,34,_pIn);
+	memcpy(tmpBuf,data,34);
 	diskInfoBlock.header = tmpBuf;
 	isExtendedDSK = (diskInfoBlock.header.substr(0,8) == "EXTENDED");
 
 	// Read creator string
 	memset(tmpBuf,0,35);
-	fread(tmpBuf,1,14,_pIn);
+	memcpy(tmpBuf,data + 34,14);
 	diskInfoBlock.creator = tmpBuf;
 
 	// Read track number and size, and side number
-	fread(&diskInfoBlock.tracksNum,1,1,_pIn);
-	fread(&diskInfoBlock.sidesNum ,1,1,_pIn);
-	fread(&diskInfoBlock.trackSize,1,2,_pIn);
+	diskInfoBlock.tracksNum = data[48];
+	diskInfoBlock.sidesNum  = data[49];
+	diskInfoBlock.trackSize = data[50] | (data[51] << 8);
 
 	// Read track size table
-	unsigned int tableLength = diskInfoBlock.tracksNum * diskInfoBlock.sidesNum;
-	for( unsigned int tableByte = 0; tableByte < tableLength; ++tableByte )
-	{
-		fread(&tmpBuf[0],1,1,_pIn);
-		diskInfoBlock.trackSizeTable.push_back(tmpBuf[0]);
-	}
-
-	// Skip unused block data
-	fseek( _pIn, 256, SEEK_SET );
+	size_t tableLength = diskInfoBlock.tracksNum * diskInfoBlock.sidesNum;
+	tableLength = std::min( tableLength, dataBlock.GetSize() - 52 );
+	diskInfoBlock.trackSizeTable.assign( data + 52, data + 52 + tableLength );
+	diskInfoBlock.trackSizeTable.resize( diskInfoBlock.tracksNum * diskInfoBlock.sidesNum, 0 );
 }
 
 ///////////////////////////////////////////////////////////////////////
@@ -327,19 +390,26 @@ void CEDSKDiskImage::WriteDiskInformationBlock(FILE* _pOut) const
 //                             structure and associated sector info
 //                             and data from an open file.
 ///////////////////////////////////////////////////////////////////////
-bool CEDSKDiskImage::ReadTrackInformationBlock(FILE* _pIn)
+bool CEDSKDiskImage::ReadTrackInformationBlock(size_t& _offset, CEDSKFile_TrackInfoBlock& _tib) const
 {
+	const unsigned char* data     = dataBlock.GetData();
+	size_t               fileSize = dataBlock.GetSize();
+
 	CEDSKFile_TrackInfoBlock tib;
 	tib.isUnformatted = false;
+	tib.isLoaded      = true;
+	tib.fileOffset    = _offset;
 	char tmpBuf[14];
 
-	// Store current file offset to skip unused data after reading block.
 	// The Track info block is 256 bytes long on disk.
-	size_t fileOffset = ftell(_pIn);
+	if( _offset > fileSize || fileSize - _offset < 256 )
+	{
+		return false;
+	}
 
 	// Read header
 	memset(tmpBuf,0,14);
-	fread(tmpBuf,1,13,_pIn);
+	memcpy(tmpBuf,data + _offset,13);
 	tib.header = tmpBuf;
 
 	if( tib.header.compare("Track-Info\r\n") != 0 )
@@ -348,26 +418,31 @@ bool CEDSKDiskImage::ReadTrackInformationBlock(FILE* _pIn)
 	}
 
 	// Read data
-	fread( tib.unused       ,1,3,_pIn);
-	fread(&tib.trackNumber  ,1,1,_pIn);
-	fread(&tib.sideNumber   ,1,1,_pIn);
-	fread(&tib.dataRate     ,1,1,_pIn);
-	fread(&tib.recordingMode,1,1,_pIn);
-	fread(&tib.sectorSize   ,1,1,_pIn);
-	fread(&tib.sectorsNum   ,1,1,_pIn);
-	fread(&tib.gap3Length   ,1,1,_pIn);
-	fread(&tib.fillerByte   ,1,1,_pIn);
-	
+	memcpy(tib.unused,data + _offset + 13,3);
+	tib.trackNumber   = data[_offset + 16];
+	tib.sideNumber    = data[_offset + 17];
+	tib.dataRate      = data[_offset + 18];
+	tib.recordingMode = data[_offset + 19];
+	tib.sectorSize    = data[_offset + 20];
+	tib.sectorsNum    = data[_offset + 21];
+	tib.gap3Length    = data[_offset + 22];
+	tib.fillerByte    = data[_offset + 23];
+
+	if( fileSize - _offset < 24 + (size_t)tib.sectorsNum * 8 )
+	{
+		return false;
+	}
+
 	// Read sector info blocks
 	for( unsigned char sector = 0; sector < tib.sectorsNum; ++sector )
 	{
-		ReadSectorInformationBlock(_pIn,tib);		
+		ReadSectorInformationBlock(data + _offset + 24 + (sector * 8),tib);
 	}
 
 	// Skip unused data
-	fseek( _pIn, fileOffset+256, SEEK_SET );
+	_offset += 256;
 
-	// Read actual sector data
+	// Locate actual sector data
 	for( unsigned char sector = 0; sector < tib.sectorsNum; ++sector )
 	{
 		unsigned short int dataSize = tib.sectorInfoList[sector].dataLength;
@@ -375,19 +450,56 @@ bool CEDSKDiskImage::ReadTrackInformationBlock(FILE* _pIn)
 		{
 			dataSize = (unsigned short int)(128 * pow(2,tib.sectorSize));
 		}
-		uint8vector tmpVec;
 
-		for( unsigned short int dataByte = 0; dataByte < dataSize; ++dataByte )
+		if( fileSize - _offset < dataSize )
 		{
-			fread(&tmpBuf[0],1,1,_pIn);
-			tmpVec.push_back(tmpBuf[0]);
+			return false;
 		}
 
-		tib.sectorData.push_back(tmpVec);
+		tib.sectorInfoList[sector].dataOffset = _offset;
+		tib.sectorInfoList[sector].dataSize   = dataSize;
+		_offset += dataSize;
+	}
+
+	BuildSectorIDIndex(tib);
+	_tib = tib;
+
+	return true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// ReadOffsetInfo - Read the track offsets from an Offset-Info block
+//                  at the given file offset.
+//
+//                  Returns false, leaving _trackOffsets untouched,
+//                  if there's no valid block there.
+///////////////////////////////////////////////////////////////////////
+bool CEDSKDiskImage::ReadOffsetInfo(size_t _offset, std::vector<size_t>& _trackOffsets) const
+{
+	const unsigned char* data     = dataBlock.GetData();
+	size_t               fileSize = dataBlock.GetSize();
+	size_t               blockLen = CEDSKFile_OFFSET_INFO_HEADER_LEN + (_trackOffsets.size() * 4);
+
+	if( _offset > fileSize || fileSize - _offset < blockLen || 0 != memcmp(data + _offset,CEDSKFile_OFFSET_INFO_HEADER,CEDSKFile_OFFSET_INFO_HEADER_LEN) )
+	{
+		return false;
 	}
 
-	// Insert track data
-	sides[tib.sideNumber].push_back(tib);
+	std::vector<size_t> trackOffsets( _trackOffsets.size(), 0 );
+	const unsigned char* entry = data + _offset + CEDSKFile_OFFSET_INFO_HEADER_LEN;
+	for( size_t trackIdx = 0; trackIdx < trackOffsets.size(); ++trackIdx, entry += 4 )
+	{
+		trackOffsets[trackIdx] = entry[0] | (entry[1] << 8) | (entry[2] << 16) | ((size_t)entry[3] << 24);
+
+		// Formatted tracks must point to a track info block inside the file.
+		bool isFormatted = !isExtendedDSK || 0 != diskInfoBlock.trackSizeTable[trackIdx];
+		if( isFormatted && (trackOffsets[trackIdx] < 256 || trackOffsets[trackIdx] > fileSize - 256) )
+		{
+			return false;
+		}
+	}
+
+	_trackOffsets = trackOffsets;
 
 	return true;
 }
@@ -437,9 +549,100 @@ void CEDSKDiskImage::WriteTrackInformationBlock(FILE* _pOut, const CEDSKFile_Tra
 	// Write sector data
 	for( unsigned char sector = 0; sector < _tib.sectorsNum; ++sector )
 	{
-		unsigned short int dataSize = (_tib.sectorInfoList[sector].dataLength != 0) ? _tib.sectorInfoList[sector].dataLength : _tib.sectorData[sector].size();
+		const CEDSKFile_SectorInfo& si = _tib.sectorInfoList[sector];
+		unsigned short int dataSize = (si.dataLength != 0) ? std::min(si.dataLength,si.dataSize) : si.dataSize;
 		
-		fwrite(_tib.sectorData[sector].data(),1,dataSize,_pOut);
+		fwrite(dataBlock.GetData() + si.dataOffset,1,dataSize,_pOut);
+	}
+}
+
+///////////////////////////////////////////////////////////////////////
+// WriteOffsetInfo - Write an Offset-Info block with the given track
+//                   offsets to an open file.
+///////////////////////////////////////////////////////////////////////
+void CEDSKDiskImage::WriteOffsetInfo(FILE* _pOut, const std::vector<size_t>& _trackOffsets) const
+{
+	std::vector<unsigned char> block( CEDSKFile_OFFSET_INFO_HEADER, CEDSKFile_OFFSET_INFO_HEADER + CEDSKFile_OFFSET_INFO_HEADER_LEN );
+	for( size_t trackOffset : _trackOffsets )
+	{
+		block.push_back( (unsigned char)( trackOffset        & 0xFF) );
+		block.push_back( (unsigned char)((trackOffset >>  8) & 0xFF) );
+		block.push_back( (unsigned char)((trackOffset >> 16) & 0xFF) );
+		block.push_back( (unsigned char)((trackOffset >> 24) & 0xFF) );
+	}
+
+	fwrite(block.data(),1,block.size(),_pOut);
+}
+
+///////////////////////////////////////////////////////////////////////
+// GetTrack - Returns the requested track, reading it first if the
+//            image was lazy loaded, or NULL if it doesn't exist.
+///////////////////////////////////////////////////////////////////////
+const CEDSKFile_TrackInfoBlock* CEDSKDiskImage::GetTrack(unsigned int _track, unsigned int _side) const
+{
+	if( _side >= CEDSKFile_MAX_SIDES_NUM || _track >= sides[_side].size() )
+	{
+		return NULL;
+	}
+
+	CEDSKFile_TrackInfoBlock& tib = sides[_side][_track];
+	if( !tib.isLoaded )
+	{
+		LoadTrack(tib);
+	}
+
+	return &tib;
+}
+
+///////////////////////////////////////////////////////////////////////
+// LoadTrack - Reads a lazy loaded track. Tracks that can't be read
+//             are left as unformatted.
+///////////////////////////////////////////////////////////////////////
+void CEDSKDiskImage::LoadTrack(CEDSKFile_TrackInfoBlock& _tib) const
+{
+	size_t fileOffset = _tib.fileOffset;
+	if( !ReadTrackInformationBlock(fileOffset,_tib) )
+	{
+		_tib.isUnformatted = true;
+		_tib.sectorsNum    = 0;
+		_tib.sectorInfoList.clear();
+	}
+
+	_tib.isLoaded = true;
+}
+
+///////////////////////////////////////////////////////////////////////
+// BuildSectorIDIndex - Links the sectors of a track by ID, so they
+//                      can be found without scanning the track.
+///////////////////////////////////////////////////////////////////////
+void CEDSKDiskImage::BuildSectorIDIndex(CEDSKFile_TrackInfoBlock& _tib)
+{
+	for( size_t sectorID = 0; sectorID < 256; ++sectorID )
+	{
+		_tib.sectorByID[sectorID] = -1;
+	}
+
+	// Walk backwards so each chain ends up in track order.
+	for( size_t sector = _tib.sectorInfoList.size(); sector > 0; --sector )
+	{
+		CEDSKFile_SectorInfo& si = _tib.sectorInfoList[sector - 1];
+
+		si.nextSameID = _tib.sectorByID[si.sectorID];
+		_tib.sectorByID[si.sectorID] = (short int)(sector - 1);
+	}
+}
+
+void CEDSKDiskImage::LoadAllTracks() const
+{
+	for( size_t side = 0; side < CEDSKFile_MAX_SIDES_NUM; ++side )
+	{
+		for( size_t track = 0; track < sides[side].size(); ++track )
+		{
+			if( !sides[side][track].isLoaded )
+			{
+				LoadTrack(sides[side][track]);
+			}
+		}
 	}
 }
 
@@ -448,17 +651,19 @@ void CEDSKDiskImage::WriteTrackInformationBlock(FILE* _pOut, const CEDSKFile_Tra
 //                              from an open file and store it in the
 //                              given CEDSKFile_TrackInfoBlock structure.
 ////////////////////////////////////////////////////////////////////////
-void CEDSKDiskImage::ReadSectorInformationBlock(FILE* _pIn, CEDSKFile_TrackInfoBlock& _tib)
+void CEDSKDiskImage::ReadSectorInformationBlock(const unsigned char* _data, CEDSKFile_TrackInfoBlock& _tib) const
 {
 	CEDSKFile_SectorInfo si;
 
-	fread(&si.track     ,1,1,_pIn);
-	fread(&si.side      ,1,1,_pIn);
-	fread(&si.sectorID  ,1,1,_pIn);
-	fread(&si.sectorSize,1,1,_pIn);
-	fread(&si.FDCStatus1,1,1,_pIn);
-	fread(&si.FDCStatus2,1,1,_pIn);
-	fread(&si.dataLength,1,2,_pIn);
+	si.track      = _data[0];
+	si.side       = _data[1];
+	si.sectorID   = _data[2];
+	si.sectorSize = _data[3];
+	si.FDCStatus1 = _data[4];
+	si.FDCStatus2 = _data[5];
+	si.dataLength = _data[6] | (_data[7] << 8);
+	si.dataOffset = 0;
+	si.dataSize   = 0;
 
 	_tib.sectorInfoList.push_back(si);
 }
@@ -499,16 +704,18 @@ int CEDSKDiskImage::GetTracksNum() const
 
 int CEDSKDiskImage::GetSectorsNum() const
 {
-	if( 0 < GetSidesNum() && 0 < GetTracksNum() )
-		return sides[0][0].sectorInfoList.size();
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(0,0);
+	if( 0 < GetSidesNum() && 0 < GetTracksNum() && NULL != tib )
+		return tib->sectorInfoList.size();
 
 	return 0;
 }
 
 int CEDSKDiskImage::GetSectorsNum(size_t _side, size_t _track) const
 {
-	if( _side < (size_t)GetSidesNum() && _track < (size_t)GetTracksNum() )
-		return sides[_side][_track].sectorInfoList.size();
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack((unsigned int)_track,(unsigned int)_side);
+	if( _side < (size_t)GetSidesNum() && _track < (size_t)GetTracksNum() && NULL != tib )
+		return tib->sectorInfoList.size();
 
 	return 0;
 }
@@ -532,6 +739,8 @@ std::string CEDSKDiskImage::GetDiskInfo()
 	int sectorsNum = 0;
 	int sectorSize = 0;
 
+	LoadAllTracks();
+
 	for( int side = 0; side < diskInfoBlock.sidesNum; ++side )
 	{
 		for( size_t track = 0; track < sides[side].size(); ++track )
@@ -585,25 +794,31 @@ std::string CEDSKDiskImage::GetDiskInfo()
 
 unsigned char* CEDSKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
 {
-	if( uTrack < (unsigned int)GetTracksNum() && uSide < (unsigned int)GetSidesNum() && uSector < sides[uSide][uTrack].sectorsNum )
-	{
-		return sides[uSide][uTrack].sectorData[uSector].data();
-	}
-
-	return NULL;
+	return const_cast<unsigned char*>( static_cast<const CEDSKDiskImage*>(this)->GetSector( uTrack, uSide, uSector ) );
 }
 
 const unsigned char* CEDSKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
 {
-	return GetSector( uTrack, uSide, uSector );
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(uTrack,uSide);
+	if( uTrack < (unsigned int)GetTracksNum() && uSide < (unsigned int)GetSidesNum() && NULL != tib && uSector < tib->sectorInfoList.size() )
+	{
+		const CEDSKFile_SectorInfo& si = tib->sectorInfoList[uSector];
+		if( si.dataSize > 0 )
+		{
+			return dataBlock.GetData() + si.dataOffset;
+		}
+	}
+
+	return NULL;
 }
 
 unsigned int CEDSKDiskImage::GetSectorID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
 {
 	if( uTrack < (unsigned int)GetTracksNum() && uSide < (unsigned int)GetSidesNum() )
 	{
-		if( !sides[uSide].empty() && !sides[uSide][uTrack].sectorInfoList.empty() )
-			return sides[uSide][uTrack].sectorInfoList[uSector].sectorID;
+		const CEDSKFile_TrackInfoBlock* tib = GetTrack(uTrack,uSide);
+		if( NULL != tib && !tib->sectorInfoList.empty() )
+			return tib->sectorInfoList[uSector].sectorID;
 	}
 
 	return DISK_IMAGE_INTERFACE_INVALID;
@@ -611,36 +826,66 @@ unsigned int CEDSKDiskImage::GetSectorID( unsigned int uTrack, unsigned int uSid
 
 const unsigned char* CEDSKDiskImage::GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID ) const
 {
-	if( uTrack < (unsigned int)GetTracksNum() && uSide < (unsigned int)GetSidesNum() && uTrack < sides[uSide].size() && !sides[uSide][uTrack].isUnformatted )
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(uTrack,uSide);
+	if( uTrack < (unsigned int)GetTracksNum() && uSide < (unsigned int)GetSidesNum() && NULL != tib && !tib->isUnformatted && uSectorID < 256 )
 	{
-		int currSector = 0;
-		while( currSector < sides[uSide][uTrack].sectorsNum )
+		short int sector = tib->sectorByID[uSectorID];
+		if( sector >= 0 )
 		{
-			if( uSectorID == GetSectorID(uTrack, uSide, currSector) )
-			{
-				return GetSector(uTrack, uSide, currSector);
-			}
-
-			++currSector;
+			return GetSector(uTrack, uSide, sector);
 		}
 	}
 
 	return NULL;
 }
 
+// Weak sectors store all their copies one after the other, so dataLength
+// is a multiple of the sector size.
+size_t CEDSKDiskImage::GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const
+{
+	_copies.clear();
+
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(uTrack,uSide);
+	if( uTrack >= (unsigned int)GetTracksNum() || uSide >= (unsigned int)GetSidesNum() || NULL == tib || tib->isUnformatted || uSectorID >= 256 )
+	{
+		return 0;
+	}
+
+	for( short int sector = tib->sectorByID[uSectorID]; sector >= 0; sector = tib->sectorInfoList[sector].nextSameID )
+	{
+		const CEDSKFile_SectorInfo& si = tib->sectorInfoList[sector];
+		if( 0 == si.dataSize )
+		{
+			continue;
+		}
+
+		size_t sectorSize = (size_t)(128 * pow(2,si.sectorSize));
+		size_t copiesNum  = (si.dataSize > sectorSize) ? si.dataSize / sectorSize : 1;
+		size_t copySize   = (si.dataSize > sectorSize) ? sectorSize : si.dataSize;
+		for( size_t copy = 0; copy < copiesNum; ++copy )
+		{
+			_copies.push_back( { dataBlock.GetData() + si.dataOffset + (copy * copySize), copySize } );
+		}
+	}
+
+	return _copies.size();
+}
+
 STrackInfo CEDSKDiskImage::GetTrackInfo ( unsigned int _track, unsigned int _side  ) const
 {
 	STrackInfo retVal;
 
-	retVal.isValid     = (_side < (unsigned int)GetSidesNum()) && (_track < (unsigned int)GetTracksNum());
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(_track,_side);
+
+	retVal.isValid     = (_side < (unsigned int)GetSidesNum()) && (_track < (unsigned int)GetTracksNum()) && NULL != tib;
 	if( retVal.isValid )
 	{
-		retVal.isFormatted = !sides[_side][_track].isUnformatted;
-		retVal.sectorsNum  =  sides[_side][_track].sectorInfoList.size();
+		retVal.isFormatted = !tib->isUnformatted;
+		retVal.sectorsNum  =  tib->sectorInfoList.size();
 		retVal.dataSize    =  0;
-		for( size_t sec = 0; sec < sides[_side][_track].sectorInfoList.size(); ++sec )
+		for( size_t sec = 0; sec < tib->sectorInfoList.size(); ++sec )
 		{
-			retVal.dataSize += (size_t)(128 * pow(2,sides[_side][_track].sectorInfoList[sec].sectorSize));
+			retVal.dataSize += (size_t)(128 * pow(2,tib->sectorInfoList[sec].sectorSize));
 		}
 	}
 
@@ -651,13 +896,16 @@ SSectorInfo CEDSKDiskImage::GetSectorInfo( unsigned int _track, unsigned int _si
 {
 	SSectorInfo retVal;
 
-	retVal.isValid   = (_side < (unsigned int)GetSidesNum()) && (_track < (unsigned int)GetTracksNum()) && (_sector < sides[_side][_track].sectorsNum);
+	const CEDSKFile_TrackInfoBlock* tib = GetTrack(_track,_side);
+
+	retVal.isValid   = (_side < (unsigned int)GetSidesNum()) && (_track < (unsigned int)GetTracksNum()) && NULL != tib && (_sector < tib->sectorInfoList.size());
 	if( retVal.isValid )
 	{
-		retVal.hasErrors = sides[_side][_track].sectorInfoList[_sector].FDCStatus1 != 0 || sides[_side][_track].sectorInfoList[_sector].FDCStatus2 != 0;
+		const CEDSKFile_SectorInfo& si = tib->sectorInfoList[_sector];
+		retVal.hasErrors = si.FDCStatus1 != 0 || si.FDCStatus2 != 0;
 		retVal.isInUse   = true;  // FS should check or update this info
-		retVal.dataSize  = (size_t)(128 * pow(2,sides[_side][_track].sectorInfoList[_sector].sectorSize));
-		retVal.copiesNum = sides[_side][_track].sectorInfoList[_sector].dataLength / retVal.dataSize; // Number of copies of the sector stored
+		retVal.dataSize  = (size_t)(128 * pow(2,si.sectorSize));
+		retVal.copiesNum = si.dataLength / retVal.dataSize; // Number of copies of the sector stored
 		retVal.isWeak    = retVal.copiesNum > 1;
 	}
 
@@ -675,13 +923,15 @@ size_t CEDSKDiskImage::GetSectorSize()
 {
 	size_t retVal = GetSectorSize(0,0,0);
 
+	LoadAllTracks();
+
 	for( unsigned int side = 0; side < GetSidesNum(); ++side )
 	{
 		for( unsigned int track = 0; track < sides[side].size(); ++track )
 		{
 			for( unsigned int sector = 0; sector < sides[side][track].sectorsNum; ++sector )
 			{
-				if( GetSectorSize(side, track, sector) != retVal )
+				if( GetSectorSize(track, side, sector) != retVal )
 				{
 					return 0;
 				}
@@ -696,6 +946,8 @@ size_t CEDSKDiskImage::GetDataSize()
 {
 	size_t retVal = 0;
 
+	LoadAllTracks();
+
 	for( size_t side = 0; side < CEDSKFile_MAX_SIDES_NUM; ++side )
 	{
 		for( size_t track = 0; track < sides[side].size(); ++track )
@@ -713,7 +965,29 @@ size_t CEDSKDiskImage::GetDataSize()
 	return retVal;
 }
 
+// The new image is set up for lazy loading and Offset-Info writing like this one,
+// so a tool can register a configured instance with its DiskImageFactory.
 IDiskImageInterface* CEDSKDiskImage::NewImage() const
 {
-	return new CEDSKDiskImage;
+	CEDSKDiskImage* image = new CEDSKDiskImage;
+	image->SetLazyLoad( lazyLoad );
+	image->SetWriteOffsetInfo( writeOffsetInfo );
+
+	return image;
+}
+
+int CEDSKDiskImage::Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const
+{
+	if( _fileSize < 256 || _headerSize < 8 )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	// Same signatures Load accepts
+	if( 0 != memcmp( _header, "MV", 2 ) && 0 != memcmp( _header, "EXTENDED", 8 ) )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	return DISK_IMAGE_PROBE_CERTAIN;
 }
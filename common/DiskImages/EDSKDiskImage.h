@@ -12,7 +12,6 @@
 //       - Add creation of new empty disk images.
 //       - This is an idea. Create a base log class so that the
 //         whole operation history can be reviewed.
-//       - Add support for Simon Owen's extension Offset-Info.
 //
 ///////////////////////////////////////////////////////////////////
 
@@ -22,12 +21,15 @@
 #include <vector>
 
 #include "DiskImageInterface.h"
+#include "MappedFile.h"
 
 typedef std::vector<unsigned char> uint8vector;
 
 #define CEDSKFile_Side0			false
 #define CEDSKFile_Side1			true
 #define CEDSKFile_MAX_SIDES_NUM 2
+#define CEDSKFile_OFFSET_INFO_HEADER		"Offset-Info\r\n"
+#define CEDSKFile_OFFSET_INFO_HEADER_LEN	13
 // Notes:
 // - Format information can be found at:
 //   http://www.cpcwiki.eu/index.php/Format:DSK_disk_image_file_format
@@ -72,6 +74,13 @@ typedef std::vector<unsigned char> uint8vector;
 //   b5     DD  Data Error in Data Field (CRC-fail in data-field)
 //   b6     CM  Control Mark (read/scan command found sector with deleted DAM)
 //   b7     0   Not Used
+//
+// - Offset-Info extension (Simon Owen)
+//   An optional block right after the last track, so readers can locate any
+//   track without summing the track size table:
+//     "Offset-Info\r\n"  13 bytes
+//     Track offsets     4 bytes little endian per track size table entry,
+//                       in the same order. 0 for unformatted tracks.
 
 struct CEDSKFile_DiskInfoBlock
 {
@@ -92,6 +101,11 @@ struct CEDSKFile_SectorInfo
 	unsigned char FDCStatus1;      // FDC Status register 1 (equivalent to NEC765 ST1 status register)
 	unsigned char FDCStatus2;      // FDC status register 2 (equivalent to NEC765 ST2 status register)
 	unsigned short int dataLength; // Actual data length in bytes
+
+	// Not stored in the file. Location of the sector data in the image data block.
+	size_t             dataOffset;
+	unsigned short int dataSize;
+	short int          nextSameID;   // Next sector on the track with the same ID, or -1
 };
 
 struct CEDSKFile_TrackInfoBlock
@@ -106,9 +120,13 @@ struct CEDSKFile_TrackInfoBlock
 	unsigned char sectorsNum;                   		// Number of sectors
 	unsigned char gap3Length;                   		// GAP#3 length
 	unsigned char fillerByte;                   		// Filler byte value
-	std::vector<CEDSKFile_SectorInfo> sectorInfoList;	// Sector information list
-	std::vector<uint8vector> sectorData;          		// Actual sector data
+	std::vector<CEDSKFile_SectorInfo> sectorInfoList;	// Sector information list. Sector data is kept in the image data block.
 	bool isUnformatted;                         		// Is this an unformatted track?
+
+	// Not stored in the file.
+	size_t fileOffset;									// Offset of the track info block in the image file
+	bool   isLoaded;									// False until the track is read, in lazy loading mode
+	short int sectorByID[256];							// First sector with each ID, or -1
 };
 
 class CEDSKDiskImage:public IDiskImageInterface
@@ -134,6 +152,7 @@ public:
 			unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 			unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+			size_t			GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const override;
 
 	std::string 			GetFileSpec() override;
 	std::string 			GetDiskInfo() override;
@@ -151,31 +170,60 @@ public:
 	bool 					NeedManualSetup() const override { return false; }
 
 	IDiskImageInterface*	NewImage() const override;
+
+	int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	const 	std::string&					GetLastError()		const {return lastError;}
 	const 	CEDSKFile_DiskInfoBlock&		GetDiskInfoBlock()	const {return diskInfoBlock;}
 			CEDSKFile_DiskInfoBlock&		GetDiskInfoBlock()		  {return diskInfoBlock;}
 	bool									IsExtendedDSK()			  {return isExtendedDSK;}
-	std::vector<CEDSKFile_TrackInfoBlock>&	GetSide(bool _sideB)	  {return _sideB ? sides[1]:sides[0];}
+	std::vector<CEDSKFile_TrackInfoBlock>&	GetSide(bool _sideB)	  {LoadAllTracks(); return _sideB ? sides[1]:sides[0];}
+
+	// When enabled before Load, only the disk information block is read and
+	// every track is read the first time it's accessed.
+	// Tracks are then read from const methods without any locking, so a lazy
+	// loaded image must only be used from one thread at a time. Call GetSide
+	// first to read every track if the image is to be shared between threads.
+	void									SetLazyLoad(bool _lazyLoad)	{lazyLoad = _lazyLoad;}
+	bool									IsLazyLoad()		const	{return lazyLoad;}
+
+	// Save writes an Offset-Info block if enabled. Load enables it only if
+	// the file had one, so this also tells if the loaded file had it.
+	bool									HasOffsetInfo()		const	{return writeOffsetInfo;}
+	void									SetWriteOffsetInfo(bool _write) {writeOffsetInfo = _write;}
 
 private:
-	// Read functions
-	void ReadDiskInformationBlock		(FILE* _pIn);
-	bool ReadTrackInformationBlock		(FILE* _pIn);
-	void ReadSectorInformationBlock		(FILE* _pIn, CEDSKFile_TrackInfoBlock& _tib);
+	// Read functions. They decode the blocks straight from the image data block.
+	void ReadDiskInformationBlock		();
+	bool ReadTrackInformationBlock		(size_t& _offset, CEDSKFile_TrackInfoBlock& _tib) const;
+	bool ReadOffsetInfo					(size_t _offset, std::vector<size_t>& _trackOffsets) const;
+	void ReadSectorInformationBlock		(const unsigned char* _data, CEDSKFile_TrackInfoBlock& _tib) const;
+
+	// Track access. Reads the track first if it wasn't loaded yet.
+	const CEDSKFile_TrackInfoBlock* GetTrack(unsigned int _track, unsigned int _side) const;
+	void                            LoadTrack(CEDSKFile_TrackInfoBlock& _tib) const;
+	void                            LoadAllTracks() const;
+	static void                     BuildSectorIDIndex(CEDSKFile_TrackInfoBlock& _tib);
 
 	// Write functions
 	void   WriteDiskInformationBlock	(FILE* _pOut) const;
 	void   WriteTrackInformationBlock	(FILE* _pOut, const CEDSKFile_TrackInfoBlock& _tib) const;
+	void   WriteOffsetInfo				(FILE* _pOut, const std::vector<size_t>& _trackOffsets) const;
 	size_t WriteSectorInformationBlock	(FILE* _pOut, const CEDSKFile_SectorInfo& _si     ) const;
 
 	// Variables
 	std::string								lastError;
 	CEDSKFile_DiskInfoBlock					diskInfoBlock;
 	bool									isExtendedDSK;
-	std::vector<CEDSKFile_TrackInfoBlock>	sides[2];
+	bool									lazyLoad;
+	bool									writeOffsetInfo;
+	mutable std::vector<CEDSKFile_TrackInfoBlock>	sides[2];	// Mutable so lazy loaded tracks can be read from const methods, see SetLazyLoad
 	std::string								fileName;
+
+	// All the sector data of the image. Holds the whole image file once
+	// loaded, or just the sector data of images created with New.
+	CMappedFile								dataBlock;
 };
 
 #endif
\ No newline at end of file
@@ -14,39 +14,59 @@
 /////////////////////////////////////////////////////////////////////
 #define _CRT_SECURE_NO_WARNINGS
 
+#include <algorithm>
 #include <chrono>
 #include <cmath>
 #include <ctime>
 #include <iomanip>
 #include <iostream>
+#include <mutex>
 #include <stdio.h>
 #include <string.h>
 #include <sstream>
 
 #include "../FS_Utils.h"
 #include "IMDDiskImage.h"
+#include "MappedFile.h"
+
+// Copies _size bytes from the read cursor to _dst and advances it.
+// Returns false if there aren't enough bytes left.
+static bool ReadBytes( const uint8_t*& _cursor, const uint8_t* _end, void* _dst, size_t _size )
+{
+	if( (size_t)(_end - _cursor) < _size )
+	{
+		return false;
+	}
+
+	memcpy( _dst, _cursor, _size );
+	_cursor += _size;
+
+	return true;
+}
 
 // Load the contents of a image file.
+// The whole file is mapped once and decoded from memory. Everything is decoded
+// into locals first, so if the file is bad the current image and its index stay as they were.
 bool CIMDDiskImage::Load( const std::string& _filename )
 {
-	// Open file
-	FILE* pIn = fopen( _filename.c_str(), "rb" );
-	if( 0 == pIn )
+	CMappedFile file;
+	if( !file.Open( _filename ) )
 	{
 		return false;
 	}
 
-	// Get file size
-	unsigned int uFileSize = 0;
-	fseek( pIn, 0, SEEK_END );
-	uFileSize = (unsigned int)ftell( pIn );
-	fseek( pIn, 0, SEEK_SET );
+	const uint8_t* cursor = file.GetData();
+	const uint8_t* end    = cursor + file.GetSize();
 
 	// Read header
-	fread( &asciiHeader, 1, IMD_ASCII_HEADER_LEN, pIn );
-	asciiHeader[IMD_ASCII_HEADER_LEN] = 0;
+	char newHeader[IMD_ASCII_HEADER_LEN+1];
+	if( !ReadBytes( cursor, end, newHeader, IMD_ASCII_HEADER_LEN ) )
+	{
+		return false;
+	}
+	newHeader[IMD_ASCII_HEADER_LEN] = 0;
 
-	std::string strHeader = asciiHeader;
+	std::string strHeader = newHeader;
 	std::string strSignature = IMD_FORMAT_SIGNATURE;
 	if( strHeader.compare(0, strSignature.length(), strSignature) != 0 )
 	{
@@ -54,25 +74,32 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 	}
 
 	// Read comment
-	comment.clear();
-	char charBuf;
-	fread( &charBuf, 1, 1, pIn );
-	while( charBuf != IMD_COMMENT_TERMINATOR )
+	const uint8_t* commentEnd = (const uint8_t*)memchr( cursor, IMD_COMMENT_TERMINATOR, end - cursor );
+	if( nullptr == commentEnd )
 	{
-		comment.push_back(charBuf);
-		fread( &charBuf, 1, 1, pIn );
+		return false;
 	}
+	std::string newComment( (const char*)cursor, commentEnd - cursor );
+	cursor = commentEnd + 1;
+
+	std::vector<SIMDTrack> newSides[IMD_MAX_SIDE_NUM];
 
 	// Read tracks
-	while( ftell(pIn) < uFileSize )
+	while( cursor < end )
 	{
 		SIMDTrack tmpTrack;
 
-		fread( &tmpTrack.mode				, 1, 1, pIn );
-		fread( &tmpTrack.track				, 1, 1, pIn );
-		fread( &tmpTrack.side				, 1, 1, pIn );
-		fread( &tmpTrack.sectorsPerTrack	, 1, 1, pIn );
-		fread( &tmpTrack.sectorSizeFactor	, 1, 1, pIn );
+		uint8_t trackHeader[5];
+		if( !ReadBytes( cursor, end, trackHeader, sizeof(trackHeader) ) )
+		{
+			return false;
+		}
+
+		tmpTrack.mode				= trackHeader[0];
+		tmpTrack.track				= trackHeader[1];
+		tmpTrack.side				= trackHeader[2];
+		tmpTrack.sectorsPerTrack	= trackHeader[3];
+		tmpTrack.sectorSizeFactor	= trackHeader[4];
 
 		if( ((tmpTrack.side & IMD_SIDE_MASK) >= IMD_MAX_SIDE_NUM) || (tmpTrack.sectorSizeFactor > IMD_MAX_SECTOR_SIZE_FACTOR) )
 			return false;
@@ -82,29 +109,43 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 		bool hasHeadMap		= (tmpTrack.side & IMD_USE_HEAD_MAP_MASK) != 0;
 		bool hasCylinderMap	= (tmpTrack.side & IMD_USE_CYLINDER_MAP_MASK) != 0;
 
+		// Maps are stored in this order: sector numbering, cylinder, head.
 		tmpTrack.sectorNumberingMap.resize(tmpTrack.sectorsPerTrack);
-		fread( tmpTrack.sectorNumberingMap.data(), 1, tmpTrack.sectorsPerTrack, pIn );
-		if( hasHeadMap )
+		if( !ReadBytes( cursor, end, tmpTrack.sectorNumberingMap.data(), tmpTrack.sectorsPerTrack ) )
 		{
-			tmpTrack.sectorHeadMap.resize(tmpTrack.sectorsPerTrack);
-			fread( tmpTrack.sectorHeadMap.data(), 1, tmpTrack.sectorsPerTrack, pIn );
+			return false;
 		}
 		if( hasCylinderMap )
 		{
 			tmpTrack.sectorCylinderMap.resize(tmpTrack.sectorsPerTrack);
-			fread( tmpTrack.sectorNumberingMap.data(), 1, tmpTrack.sectorsPerTrack, pIn );
+			if( !ReadBytes( cursor, end, tmpTrack.sectorCylinderMap.data(), tmpTrack.sectorsPerTrack ) )
+			{
+				return false;
+			}
+		}
+		if( hasHeadMap )
+		{
+			tmpTrack.sectorHeadMap.resize(tmpTrack.sectorsPerTrack);
+			if( !ReadBytes( cursor, end, tmpTrack.sectorHeadMap.data(), tmpTrack.sectorsPerTrack ) )
+			{
+				return false;
+			}
 		}
 
 		// Read sectors
+		tmpTrack.sectors.resize( tmpTrack.sectorsPerTrack );
 		uint8_t tmpByte = 0;
 		for( uint8_t sector = 0; sector < tmpTrack.sectorsPerTrack; ++sector )
 		{
-			SIMDSector tmpSector;
+			SIMDSector& tmpSector = tmpTrack.sectors[sector];
 
-			fread( &tmpByte, 1, 1, pIn );
+			if( !ReadBytes( cursor, end, &tmpByte, 1 ) )
+			{
+				return false;
+			}
 			tmpSector.type = ByteToSectorType( tmpByte );
 
-			// Compressed sectors will be uncompressed so they can actually be written to.
+			// Compressed sectors keep only their fill byte until they are written to.
 			switch( tmpSector.type )
 			{
 			case EIMDSectorType::NORMAL_DATA:
@@ -112,8 +153,12 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 			case EIMDSectorType::NORMAL_DATA_DELETED_ADDRESS_MARK:
 			case EIMDSectorType::DELETED_DATA_READ_ERROR:
 				{
-					tmpSector.data.resize( sectorSize );
-					fread( tmpSector.data.data(), 1, sectorSize, pIn );
+					if( (size_t)(end - cursor) < sectorSize )
+					{
+						return false;
+					}
+					tmpSector.data.assign( cursor, cursor + sectorSize );
+					cursor += sectorSize;
 				}
 				break;
 			case EIMDSectorType::COMPRESSED_DATA:
@@ -121,8 +166,11 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 			case EIMDSectorType::COMPRESSED_DATA_DELETED_ADDRESS_MARK:
 			case EIMDSectorType::COMPRESSED_DELETED_READ_ERROR:
 				{
-					fread( &tmpByte, 1, 1, pIn );
-					tmpSector.data.insert( tmpSector.data.begin(), sectorSize, tmpByte );
+					if( !ReadBytes( cursor, end, &tmpByte, 1 ) )
+					{
+						return false;
+					}
+					tmpSector.fillByte = tmpByte;
 				}
 				break;
 			case EIMDSectorType::UNAVAILABLE:
@@ -130,15 +178,20 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 			// If the type is outside the expected range, it's an error!
 			default:return false; break;
 			}
-
-			tmpTrack.sectors.push_back( tmpSector );
 		}
 
-		sides[tmpTrack.side & IMD_SIDE_MASK].push_back( tmpTrack );
+		newSides[tmpTrack.side & IMD_SIDE_MASK].push_back( std::move(tmpTrack) );
 	}
 
-	// Close file
-	fclose( pIn );
+	// The whole file was read, so replace the current image.
+	memcpy( asciiHeader, newHeader, sizeof(asciiHeader) );
+	comment.swap( newComment );
+	for( size_t side = 0; side < IMD_MAX_SIDE_NUM; ++side )
+	{
+		sides[side].swap( newSides[side] );
+	}
+
+	BuildIndex();
 
 	fileName = _filename;
 
@@ -146,21 +199,18 @@ bool CIMDDiskImage::Load( const std::string& _filename )
 }
 
 // Saves current image to a file
+// The whole image is assembled in memory and written with a single call.
 bool CIMDDiskImage::Save( const std::string& _filename )
 {
-	FILE* pOut = fopen( _filename.c_str(), "wb" );
-	if( 0 == pOut )
-	{
-		return false;
-	}
+	std::vector<uint8_t> outBuffer;
+	outBuffer.reserve( IMD_ASCII_HEADER_LEN + comment.length() + 1 + GetDataSize() );
 
 	// Write header
-	fwrite( &asciiHeader, 1, IMD_ASCII_HEADER_LEN, pOut );
+	outBuffer.insert( outBuffer.end(), asciiHeader, asciiHeader + IMD_ASCII_HEADER_LEN );
 
 	// Write comment
-	char charBuf = IMD_COMMENT_TERMINATOR;
-	fwrite( comment.c_str(), comment.length(), 1, pOut );	
-	fwrite( &charBuf, 1, 1, pOut );
+	outBuffer.insert( outBuffer.end(), comment.begin(), comment.end() );
+	outBuffer.push_back( IMD_COMMENT_TERMINATOR );
 
 	// Write tracks
 	for( size_t side = 0; side < IMD_MAX_SIDE_NUM; ++side )
@@ -169,64 +219,69 @@ bool CIMDDiskImage::Save( const std::string& _filename )
 		{
 			const SIMDTrack& curTrack = sides[side][track];
 
-			fwrite( &curTrack.mode				, 1, 1, pOut );
-			fwrite( &curTrack.track				, 1, 1, pOut );
-			fwrite( &curTrack.side				, 1, 1, pOut );
-			fwrite( &curTrack.sectorsPerTrack	, 1, 1, pOut );
-			fwrite( &curTrack.sectorSizeFactor	, 1, 1, pOut );
+			outBuffer.push_back( curTrack.mode );
+			outBuffer.push_back( curTrack.track );
+			outBuffer.push_back( curTrack.side );
+			outBuffer.push_back( curTrack.sectorsPerTrack );
+			outBuffer.push_back( curTrack.sectorSizeFactor );
 			
-			fwrite(  curTrack.sectorNumberingMap.data(), 1, curTrack.sectorNumberingMap.size(), pOut );
-
-			if( !curTrack.sectorCylinderMap.empty() )
-				fwrite(  curTrack.sectorCylinderMap.data(), 1, curTrack.sectorCylinderMap.size(), pOut );
-			if( !curTrack.sectorHeadMap.empty() )
-				fwrite(  curTrack.sectorHeadMap.data(), 1, curTrack.sectorHeadMap.size(), pOut );
+			outBuffer.insert( outBuffer.end(), curTrack.sectorNumberingMap.begin(), curTrack.sectorNumberingMap.end() );
+			outBuffer.insert( outBuffer.end(), curTrack.sectorCylinderMap.begin() , curTrack.sectorCylinderMap.end()  );
+			outBuffer.insert( outBuffer.end(), curTrack.sectorHeadMap.begin()     , curTrack.sectorHeadMap.end()      );
 
 			// Write sectors
-			uint8_t tmpByte = 0;
 			for( size_t sector = 0; sector < curTrack.sectors.size(); ++sector )
 			{
 				const SIMDSector& curSector = curTrack.sectors[sector];
 
-				// Adjust type as we decompress sectors on load.
-				switch( curSector.type )
+				uint8_t typeByte = SectorTypeToByte( curSector.type );
+				if( curSector.type == EIMDSectorType::UNAVAILABLE )
 				{
-				case EIMDSectorType::NORMAL_DATA:
-				case EIMDSectorType::NORMAL_DATA_READ_ERROR:
-				case EIMDSectorType::NORMAL_DATA_DELETED_ADDRESS_MARK:
-				case EIMDSectorType::DELETED_DATA_READ_ERROR:
-					{
-						tmpByte = SectorTypeToByte( curSector.type );
-					}
-					break;
-				case EIMDSectorType::COMPRESSED_DATA:
-				case EIMDSectorType::COMPRESSED_DATA_READ_ERROR:
-				case EIMDSectorType::COMPRESSED_DATA_DELETED_ADDRESS_MARK:
-				case EIMDSectorType::COMPRESSED_DELETED_READ_ERROR:
-					{
-						// Taking advantage of the fact that the compressed sector type is always
-						// the same as the uncompressed one, plus one.
-						// So, as we uncompressed the sector data, just subtract one from the type.
-						// Please note that this only works for types 1 or higher.
-						tmpByte = SectorTypeToByte( curSector.type ) - 1;
-					}
-				default:break;
+					outBuffer.push_back( typeByte );
+					continue;
 				}
 
-				fwrite( &tmpByte, 1, 1, pOut );
+				// Sectors may have been written to since they were loaded, so look
+				// for uniform ones again. Normal data types are odd numbers and their
+				// compressed counterparts are the next number.
+				bool    isUniform = curSector.data.empty();
+				uint8_t fillByte  = curSector.fillByte;
+				if( !isUniform )
+				{
+					fillByte  = curSector.data[0];
+					isUniform = curSector.data.end() == std::find_if( curSector.data.begin(), curSector.data.end(), [fillByte]( uint8_t _byte ) { return _byte != fillByte; } );
+				}
 
-				if( curSector.type != EIMDSectorType::UNAVAILABLE )
+				typeByte = ((typeByte - 1) & ~1) + 1;
+				if( isUniform )
+				{
+					outBuffer.push_back( typeByte + 1 );
+					outBuffer.push_back( fillByte );
+				}
+				else
 				{
-					fwrite( curSector.data.data(), 1, curSector.data.size(), pOut );
+					outBuffer.push_back( typeByte );
+					outBuffer.insert( outBuffer.end(), curSector.data.begin(), curSector.data.end() );
 				}
 			}
 		}
 	}
 
+	FILE* pOut = fopen( _filename.c_str(), "wb" );
+	if( 0 == pOut )
+	{
+		return false;
+	}
+
+	bool retVal = fwrite( outBuffer.data(), 1, outBuffer.size(), pOut ) == outBuffer.size();
+
 	// Close file
-	fclose( pOut );
+	if( 0 != fclose( pOut ) )
+	{
+		retVal = false;
+	}
 
-	return true;
+	return retVal;
 }
 
 // Creates a blank image with the specified parameters.
@@ -261,8 +316,8 @@ unsigned int CIMDDiskImage::New( unsigned char uTracks, unsigned char uSides, un
 	tmpTrack.sectorSizeFactor	= shiftFactor;
 	
 	SIMDSector tmpSector;
-	tmpSector.type = EIMDSectorType::NORMAL_DATA;
-	tmpSector.data.insert( tmpSector.data.begin(), uSectorSize, IMD_FILLER_BYTE );
+	tmpSector.type     = EIMDSectorType::NORMAL_DATA;
+	tmpSector.fillByte = IMD_FILLER_BYTE;
 
 	for( unsigned char sector = 0; sector < uSecsPerTrack; ++sector )
 	{
@@ -283,69 +338,57 @@ unsigned int CIMDDiskImage::New( unsigned char uTracks, unsigned char uSides, un
 		}
 	}
 
-	return GetDataSize();
-}
+	BuildIndex();
 
-// Returns pointer to the required sector's data or NULL if parameters are invalid.
-const unsigned char* CIMDDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
-{
-	return GetSector( uTrack, uSide, uSector );
+	return GetDataSize();
 }
 
-unsigned char* CIMDDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
+// Returns a read only block of IMD_MAX_SECTOR_SIZE bytes set to _fillByte.
+// Compressed sectors point here when read, so reading them doesn't expand them.
+static const uint8_t* GetFillBlock( uint8_t _fillByte )
 {
-	if( uSide   >= IMD_MAX_SIDE_NUM ) return nullptr;
-	if( uTrack  >= sides[uSide].size() ) return nullptr;
+	static std::vector<uint8_t> fillBlocks[256];
+	static std::mutex           fillBlocksMutex;
 
-	// Look for the right track as they can be in any order on the IMD file.
-	size_t trackIdx = IMD_MAX_TRACK_NUM;
-	for( size_t track = 0; track < sides[uSide].size(); ++track )
+	std::lock_guard<std::mutex> lock( fillBlocksMutex );
+	if( fillBlocks[_fillByte].empty() )
 	{
-		if( sides[uSide][track].track == uTrack )
-		{
-			trackIdx = track;
-			break;
-		}
+		fillBlocks[_fillByte].assign( IMD_MAX_SECTOR_SIZE, _fillByte );
 	}
 
-	if( trackIdx == IMD_MAX_TRACK_NUM )
-	{
-		return nullptr;
-	}
-
-	SIMDTrack& curTrack = sides[uSide][trackIdx];
+	return fillBlocks[_fillByte].data();
+}
 
-	// Determine if sector numbers start from 0 or 1.
-	// TODO:Maybe the Filesystem should be using the
-	//		GetSectorByID function instead.
-	unsigned char minSectorID = 1;
-	for( size_t sector = 0; sector < curTrack.sectorNumberingMap.size(); ++sector )
+// Returns pointer to the required sector's data or NULL if parameters are invalid.
+const unsigned char* CIMDDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
+{
+	const SIMDTrack*  curTrack  = nullptr;
+	const SIMDSector* curSector = FindSector( uTrack, uSide, uSector, curTrack );
+	if( nullptr == curSector || curSector->type == EIMDSectorType::UNAVAILABLE )
 	{
-		minSectorID = std::min( curTrack.sectorNumberingMap[sector], minSectorID );
+		return nullptr;
 	}
 
-	size_t sectorIdx = IMD_MAX_SECTOR_NUM;
-	for( size_t sector = 0; sector < curTrack.sectorNumberingMap.size(); ++sector )
-	{
-		// IMD physical sector numbers may start from 0 or 1, maybe other numbers...
-		if( curTrack.sectorNumberingMap[sector] == uSector+minSectorID )
-		{
-			sectorIdx = sector;
-			break;
-		}
-	}
+	return curSector->data.empty() ? GetFillBlock( curSector->fillByte ) : curSector->data.data();
+}
 
-	if( sectorIdx == IMD_MAX_SECTOR_NUM )
+// Returns a writable pointer to the required sector's data or NULL if parameters are invalid.
+// Compressed sectors are expanded first.
+unsigned char* CIMDDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
+{
+	const SIMDTrack* curTrack  = nullptr;
+	SIMDSector*      curSector = const_cast<SIMDSector*>( FindSector( uTrack, uSide, uSector, curTrack ) );
+	if( nullptr == curSector || curSector->type == EIMDSectorType::UNAVAILABLE )
 	{
 		return nullptr;
 	}
 
-	if( curTrack.sectors[sectorIdx].type != EIMDSectorType::UNAVAILABLE || curTrack.sectors[sectorIdx].type != EIMDSectorType::COUNT )
+	if( curSector->data.empty() )
 	{
-		return curTrack.sectors[sectorIdx].data.data();
+		curSector->data.assign( IMD_SECTOR_SIZE_FACTOR_BASE << curTrack->sectorSizeFactor, curSector->fillByte );
 	}
 
-	return nullptr;
+	return curSector->data.data();
 }
 
 // Returns pointer to the required sector's data or NULL if parameters are invalid.
@@ -510,7 +553,43 @@ std::string CIMDDiskImage::GetDiskInfo()
 
 const unsigned char* CIMDDiskImage::GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID ) const
 {
-	return GetSector( uTrack, uSide, uSectorID );
+	const SIMDTrack* curTrack = FindTrack( uTrack, uSide );
+	if( nullptr == curTrack || uSectorID > IMD_MAX_SECTOR_NUM || IMD_NO_INDEX == curTrack->sectorIndex[uSectorID] )
+	{
+		return nullptr;
+	}
+
+	const SIMDSector& curSector = curTrack->sectors[curTrack->sectorIndex[uSectorID]];
+	if( curSector.type == EIMDSectorType::UNAVAILABLE )
+	{
+		return nullptr;
+	}
+
+	return curSector.data.empty() ? GetFillBlock( curSector.fillByte ) : curSector.data.data();
+}
+
+// IMD files store a single copy of each sector, but IDs may be repeated on a track.
+size_t CIMDDiskImage::GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const
+{
+	_copies.clear();
+
+	const SIMDTrack* curTrack = FindTrack( uTrack, uSide );
+	if( nullptr == curTrack || uSectorID > IMD_MAX_SECTOR_NUM )
+	{
+		return 0;
+	}
+
+	size_t sectorSize = IMD_SECTOR_SIZE_FACTOR_BASE << curTrack->sectorSizeFactor;
+	for( int sector = curTrack->sectorIndex[uSectorID]; sector != IMD_NO_INDEX; sector = curTrack->sectors[sector].nextSameID )
+	{
+		const SIMDSector& curSector = curTrack->sectors[sector];
+		if( curSector.type != EIMDSectorType::UNAVAILABLE )
+		{
+			_copies.push_back( { curSector.data.empty() ? GetFillBlock( curSector.fillByte ) : curSector.data.data(), sectorSize } );
+		}
+	}
+
+	return _copies.size();
 }
 
 STrackInfo CIMDDiskImage::GetTrackInfo ( unsigned int _track, unsigned int _side ) const
@@ -529,7 +608,15 @@ STrackInfo CIMDDiskImage::GetTrackInfo ( unsigned int _track, unsigned int _side
 
 unsigned int CIMDDiskImage::GetSectorID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
 {
-	return uSector+1;
+	// Same lookup as GetSector, so GetSectorByID( GetSectorID( n ) ) finds sector n.
+	const SIMDTrack*  curTrack  = nullptr;
+	const SIMDSector* curSector = FindSector( uTrack, uSide, uSector, curTrack );
+	if( nullptr == curSector )
+	{
+		return 0;
+	}
+
+	return curTrack->sectorNumberingMap[curSector - curTrack->sectors.data()];
 }
 
 SSectorInfo CIMDDiskImage::GetSectorInfo( unsigned int _track, unsigned int _side, unsigned int _sector ) const
@@ -540,23 +627,14 @@ SSectorInfo CIMDDiskImage::GetSectorInfo( unsigned int _track, unsigned int _sid
 
 	if( retVal.isValid )
 	{
-		const SIMDTrack& curTrack = sides[_side][_track];
-		
-		size_t sectorIdx = IMD_MAX_SECTOR_NUM;
-		for( size_t sector = 0; sector < curTrack.sectorNumberingMap.size(); ++sector )
-		{
-			// IMD physical sector numbers start from 1...
-			if( curTrack.sectorNumberingMap[sector] == _sector+1 )
-			{
-				sectorIdx = sector;
-				break;
-			}
-		}
+		// Same lookup as GetSector, so both agree on which sector _sector is.
+		const SIMDTrack*  curTrack  = nullptr;
+		const SIMDSector* curSector = FindSector( _track, _side, _sector, curTrack );
 
-		if( sectorIdx != IMD_MAX_SECTOR_NUM )
+		if( nullptr != curSector )
 		{
 			retVal.hasErrors = false;
-			EIMDSectorType sectorType = sides[_side][_track].sectors[sectorIdx].type;
+			EIMDSectorType sectorType = curSector->type;
 			switch( sectorType )
 			{
 			case EIMDSectorType::NORMAL_DATA_READ_ERROR			:
@@ -572,7 +650,7 @@ SSectorInfo CIMDDiskImage::GetSectorInfo( unsigned int _track, unsigned int _sid
 			retVal.isInUse   = true;  // FS should check or update this info
 			retVal.isWeak    = false;
 			retVal.copiesNum = 1; // Number of copies of the sector stored
-			retVal.dataSize  = sides[_side][_track].sectors[sectorIdx].data.size();
+			retVal.dataSize  = (sectorType == EIMDSectorType::UNAVAILABLE) ? 0 : (IMD_SECTOR_SIZE_FACTOR_BASE << curTrack->sectorSizeFactor);
 		}
 		else
 		{
@@ -617,7 +695,92 @@ uint8_t CIMDDiskImage::SectorTypeToByte( EIMDSectorType _sectorType ) const
 	}
 }
 
+// Rebuilds the track and sector lookup tables.
+// Must be called whenever tracks or sectors are added, removed or renumbered.
+void CIMDDiskImage::BuildIndex()
+{
+	for( size_t side = 0; side < IMD_MAX_SIDE_NUM; ++side )
+	{
+		for( size_t track = 0; track < IMD_MAX_TRACK_NUM; ++track )
+		{
+			trackIndex[side][track] = IMD_NO_INDEX;
+		}
+
+		for( size_t track = 0; track < sides[side].size(); ++track )
+		{
+			SIMDTrack& curTrack = sides[side][track];
+
+			// Keep the first one if a track number is repeated.
+			if( IMD_NO_INDEX == trackIndex[side][curTrack.track] )
+			{
+				trackIndex[side][curTrack.track] = (int16_t)track;
+			}
+
+			curTrack.minSectorID = 1;
+			for( size_t sectorID = 0; sectorID <= IMD_MAX_SECTOR_NUM; ++sectorID )
+			{
+				curTrack.sectorIndex[sectorID] = IMD_NO_INDEX;
+			}
+
+			// Walk backwards so sectors sharing an ID are chained in track order.
+			size_t sectorsNum = std::min( curTrack.sectorNumberingMap.size(), curTrack.sectors.size() );
+			for( size_t sector = sectorsNum; sector > 0; --sector )
+			{
+				uint8_t sectorID = curTrack.sectorNumberingMap[sector - 1];
+
+				curTrack.minSectorID = std::min( sectorID, curTrack.minSectorID );
+				curTrack.sectors[sector - 1].nextSameID = curTrack.sectorIndex[sectorID];
+				curTrack.sectorIndex[sectorID] = (int16_t)(sector - 1);
+			}
+		}
+	}
+}
+
+const SIMDTrack* CIMDDiskImage::FindTrack( unsigned int _track, unsigned int _side ) const
+{
+	if( _side >= IMD_MAX_SIDE_NUM || _track >= IMD_MAX_TRACK_NUM || IMD_NO_INDEX == trackIndex[_side][_track] )
+	{
+		return nullptr;
+	}
+
+	return &sides[_side][trackIndex[_side][_track]];
+}
+
+const SIMDSector* CIMDDiskImage::FindSector( unsigned int _track, unsigned int _side, unsigned int _sector, const SIMDTrack*& _curTrack ) const
+{
+	if( _side   >= IMD_MAX_SIDE_NUM ) return nullptr;
+	if( _track  >= sides[_side].size() ) return nullptr;
+
+	_curTrack = FindTrack( _track, _side );
+	if( nullptr == _curTrack )
+	{
+		return nullptr;
+	}
+
+	// IMD physical sector numbers may start from 0 or 1, maybe other numbers...
+	// TODO:Maybe the Filesystem should be using the
+	//		GetSectorByID function instead.
+	unsigned int sectorID = _sector + _curTrack->minSectorID;
+	if( sectorID > IMD_MAX_SECTOR_NUM || IMD_NO_INDEX == _curTrack->sectorIndex[sectorID] )
+	{
+		return nullptr;
+	}
+
+	return &_curTrack->sectors[_curTrack->sectorIndex[sectorID]];
+}
+
 IDiskImageInterface* CIMDDiskImage::NewImage() const
 {
 	return new CIMDDiskImage;
 }
+
+int CIMDDiskImage::Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const
+{
+	size_t signatureLen = strlen( IMD_FORMAT_SIGNATURE );
+	if( _headerSize < signatureLen || 0 != memcmp( _header, IMD_FORMAT_SIGNATURE, signatureLen ) )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	return DISK_IMAGE_PROBE_CERTAIN;
+}
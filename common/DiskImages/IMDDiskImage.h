@@ -42,6 +42,7 @@
 #define IMD_MODE_300KBPS_MFM		4
 #define IMD_MODE_250KBPS_MFM		5
 #define IMD_FILLER_BYTE 			0xE5
+#define IMD_NO_INDEX				-1
 
 enum EIMDSectorType
 {
@@ -57,10 +58,16 @@ enum EIMDSectorType
 	COUNT
 };
 
+// Sectors filled with a single byte value are kept as just that value
+// (data stays empty) until a writable pointer to them is requested.
 struct SIMDSector
 {
 	EIMDSectorType type;
 	std::vector<uint8_t> data;
+	uint8_t fillByte;
+	int16_t nextSameID;		// Next sector on the track with the same ID, or IMD_NO_INDEX. Filled by CIMDDiskImage::BuildIndex.
+
+	SIMDSector() : type(EIMDSectorType::UNAVAILABLE), fillByte(0), nextSameID(IMD_NO_INDEX) {}
 };
 
 // Mode byte explained:
@@ -82,12 +89,16 @@ struct SIMDTrack
 	std::vector<uint8_t> 	sectorCylinderMap;
 	std::vector<uint8_t> 	sectorHeadMap;
 	std::vector<SIMDSector> sectors;
+
+	// Lookup data, filled by CIMDDiskImage::BuildIndex.
+	uint8_t minSectorID;							// Lowest sector ID, or 1 if all IDs are higher.
+	int16_t sectorIndex[IMD_MAX_SECTOR_NUM + 1];	// Sector ID -> position of its first sector in sectors, or IMD_NO_INDEX.
 };
 
 class CIMDDiskImage:public IDiskImageInterface
 {
 public:
-	CIMDDiskImage() {}
+	CIMDDiskImage() { BuildIndex(); }
 	~CIMDDiskImage(){}
 
 	// IDiskImageInterface //////////////////////////////////////////////////////////////////////////////////
@@ -107,6 +118,7 @@ public:
 			unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 			unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+			size_t			GetSectorCopiesByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID, std::vector<SSectorCopy>& _copies ) const override;
 
 	std::string 			GetFileSpec() override;
 	std::string 			GetDiskInfo() override;
@@ -124,6 +136,8 @@ public:
 	bool 					NeedManualSetup() const override { return false; }
 
 	IDiskImageInterface*	NewImage() const override;
+
+	int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	void            SetComment	 ( const char* newComment ) { comment = newComment; }
@@ -136,6 +150,15 @@ private:
 
 	std::vector<SIMDTrack> sides[IMD_MAX_SIDE_NUM];
 
+	// Track number -> position in sides[side], or IMD_NO_INDEX.
+	// Tracks can be stored in any order on IMD files, so this saves
+	// searching for them on every sector access.
+	int16_t trackIndex[IMD_MAX_SIDE_NUM][IMD_MAX_TRACK_NUM];
+
+	void				BuildIndex();
+	const SIMDTrack*	FindTrack ( unsigned int _track, unsigned int _side ) const;
+	const SIMDSector*	FindSector( unsigned int _track, unsigned int _side, unsigned int _sector, const SIMDTrack*& _curTrack ) const;
+
 	EIMDSectorType 	ByteToSectorType( uint8_t _byte 			 ) const;
 	uint8_t 		SectorTypeToByte( EIMDSectorType _sectorType ) const;
 };
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <cmath>
 #include <stdio.h>
 #include <string.h>
@@ -318,6 +319,32 @@ std::string CJVCDiskImage::GetDiskInfo()
 	return retVal;
 }
 
+// Sectors are stored in logical order, so the span runs up to the end of the image
+// unless every sector carries an attribute byte, which splits the data.
+SSectorSpan CJVCDiskImage::GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const
+{
+	SSectorSpan span = { nullptr, 0, 0 };
+
+	const unsigned char* sector = GetSector( uTrack, uSide, uSector );
+	if( nullptr == sector || 0 == uMaxSectors )
+	{
+		return span;
+	}
+
+	size_t uSectorSize = 128 << header.sectorSizeCode;
+	size_t sectorsNum  = 1;
+	if( 0 == header.sectorAttributeFlag )
+	{
+		sectorsNum = std::min( (size_t)uMaxSectors, (dataBlockSize - (size_t)(sector - dataBlock)) / uSectorSize );
+	}
+
+	span.data       = sector;
+	span.dataSize   = sectorsNum * uSectorSize;
+	span.sectorsNum = (unsigned int)sectorsNum;
+
+	return span;
+}
+
 const unsigned char* CJVCDiskImage::GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID ) const
 {
 	return GetSector( uTrack, uSide, uSectorID-1 ); // -1 to convert from 1-based index to 0-based index
@@ -332,3 +359,37 @@ IDiskImageInterface* CJVCDiskImage::NewImage() const
 {
 	return new CJVCDiskImage;
 }
+
+int CJVCDiskImage::Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const
+{
+	// Headerless images are left to the RAW format, as in Load.
+	size_t fileHeaderSize = _fileSize % 256;
+	if( 0 == fileHeaderSize )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	JVCHeader probeHeader;
+	size_t bytesToRead = std::min( std::min( fileHeaderSize, (size_t)JVC_HEADER_DATA_SIZE ), _headerSize );
+	if( bytesToRead >= 1 ) probeHeader.sectorsPerTrack     = _header[0];
+	if( bytesToRead >= 2 ) probeHeader.sideCount           = _header[1];
+	if( bytesToRead >= 3 ) probeHeader.sectorSizeCode      = _header[2];
+	if( bytesToRead >= 4 ) probeHeader.firstSectorID       = _header[3];
+	if( bytesToRead >= 5 ) probeHeader.sectorAttributeFlag = _header[4];
+
+	if( 0 == probeHeader.sectorsPerTrack || 0 == probeHeader.sideCount || probeHeader.sideCount > 2 || probeHeader.sectorSizeCode > 3 )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	bool   hasSectorAttribute = probeHeader.sectorAttributeFlag != 0;
+	size_t sectorSize         = (JVC_HEADER_SECTOR_SIZE_BASE << probeHeader.sectorSizeCode) + (hasSectorAttribute ? 1 : 0);
+	if( sectorSize > JVC_HEADER_MAX_SECTOR_SIZE )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	// A data area made of whole tracks makes the header believable.
+	size_t trackSize = probeHeader.sectorsPerTrack * sectorSize * probeHeader.sideCount;
+	return ( 0 == (_fileSize - fileHeaderSize) % trackSize ) ? DISK_IMAGE_PROBE_LIKELY : DISK_IMAGE_PROBE_UNKNOWN;
+}
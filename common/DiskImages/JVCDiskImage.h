@@ -44,6 +44,7 @@ public:
 			unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 			unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+	SSectorSpan				GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const override;
 
 	std::string 			GetFileSpec() override;
 	std::string 			GetDiskInfo() override;
@@ -61,6 +62,8 @@ public:
 	bool 					NeedManualSetup() const override;
 
 	IDiskImageInterface*	NewImage() const override;
+
+	int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 private:
 	unsigned char* dataBlock;
@@ -0,0 +1,336 @@
+////////////////////////////////////////////////////////////////////
+//
+// MappedFile.cpp - Implementation of CMappedFile, a helper class
+//                  that gives flat disk image formats direct access
+//                  to the image file contents.
+//
+// By Roberto Carlos Fernández Gerhardt aka robcfg
+//
+////////////////////////////////////////////////////////////////////
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include "MappedFile.h"
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#define MAPPEDFILE_DEFAULT_PAGE_SIZE 4096
+
+CMappedFile::CMappedFile()
+{
+	mFileOffset = 0;
+	mData       = nullptr;
+	mSize       = 0;
+	mMapped     = false;
+	mFileDevice = 0;
+	mFileInode  = 0;
+	mMapBase    = nullptr;
+	mMapSize    = 0;
+	mPageSize   = MAPPEDFILE_DEFAULT_PAGE_SIZE;
+	mDirtyCount = 0;
+
+#ifndef _WIN32
+	long pageSize = sysconf( _SC_PAGESIZE );
+	if( pageSize > 0 )
+	{
+		mPageSize = (size_t)pageSize;
+	}
+#endif
+}
+
+CMappedFile::~CMappedFile()
+{
+	Close();
+}
+
+bool CMappedFile::Open( const std::string& _filename, size_t _offset, size_t _size )
+{
+	Close();
+
+#ifndef _WIN32
+	int fd = open( _filename.c_str(), O_RDONLY );
+	if( fd < 0 )
+	{
+		return false;
+	}
+
+	struct stat fileStat;
+	if( 0 != fstat( fd, &fileStat ) || _offset > (size_t)fileStat.st_size )
+	{
+		close( fd );
+		return false;
+	}
+
+	mFileDevice = (unsigned long long)fileStat.st_dev;
+	mFileInode  = (unsigned long long)fileStat.st_ino;
+
+	size_t available = (size_t)fileStat.st_size - _offset;
+	size_t size      = (0 == _size) ? available : _size;
+	if( size > available )
+	{
+		close( fd );
+		return false;
+	}
+
+	if( size > 0 )
+	{
+		// mmap offsets must be page aligned, so map from the start of the page holding _offset.
+		size_t alignedOffset = _offset - (_offset % mPageSize);
+		size_t mapSize       = size + (_offset - alignedOffset);
+
+		void* mapBase = mmap( nullptr, mapSize, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, (off_t)alignedOffset );
+		if( MAP_FAILED != mapBase )
+		{
+			mMapBase = mapBase;
+			mMapSize = mapSize;
+			mData    = (unsigned char*)mapBase + (_offset - alignedOffset);
+			mMapped  = true;
+		}
+	}
+	close( fd );
+
+	if( size > 0 && !mMapped )
+#endif
+	{
+		// No mapping available, read the contents into memory.
+		FILE* pIn = fopen( _filename.c_str(), "rb" );
+		if( nullptr == pIn )
+		{
+			return false;
+		}
+
+		fseek( pIn, 0, SEEK_END );
+		size_t fileSize = (size_t)ftell( pIn );
+		if( _offset > fileSize || (0 != _size && _size > fileSize - _offset) )
+		{
+			fclose( pIn );
+			return false;
+		}
+
+		mSize = (0 == _size) ? fileSize - _offset : _size;
+		mData = new unsigned char[mSize];
+		fseek( pIn, (long)_offset, SEEK_SET );
+		size_t bytesRead = fread( mData, 1, mSize, pIn );
+		fclose( pIn );
+
+		if( bytesRead != mSize )
+		{
+			Close();
+			return false;
+		}
+	}
+#ifndef _WIN32
+	else
+	{
+		mSize = size;
+	}
+#endif
+
+	mFileName   = _filename;
+	mFileOffset = _offset;
+	mDirtyPages.assign( (mSize + mPageSize - 1) / mPageSize, false );
+	mDirtyCount = 0;
+
+	return true;
+}
+
+bool CMappedFile::Allocate( size_t _size )
+{
+	Close();
+
+	mData = new unsigned char[_size];
+	if( nullptr == mData )
+	{
+		return false;
+	}
+
+	memset( mData, 0, _size );
+	mSize = _size;
+
+	return true;
+}
+
+void CMappedFile::Close()
+{
+#ifndef _WIN32
+	if( mMapped )
+	{
+		munmap( mMapBase, mMapSize );
+	}
+	else
+#endif
+	{
+		delete[] mData;
+	}
+
+	mFileName.clear();
+	mFileOffset = 0;
+	mData       = nullptr;
+	mSize       = 0;
+	mMapped     = false;
+	mFileDevice = 0;
+	mFileInode  = 0;
+	mMapBase    = nullptr;
+	mMapSize    = 0;
+	mDirtyPages.clear();
+	mDirtyCount = 0;
+}
+
+bool CMappedFile::Detach()
+{
+	if( !IsFileBacked() )
+	{
+		return true;
+	}
+
+	unsigned char* data = new unsigned char[mSize];
+	if( nullptr == data )
+	{
+		return false;
+	}
+
+	if( mSize > 0 )
+	{
+		memcpy( data, mData, mSize );
+	}
+	size_t size = mSize;
+
+	Close();
+
+	mData = data;
+	mSize = size;
+
+	return true;
+}
+
+bool CMappedFile::IsSameFile( const std::string& _filename ) const
+{
+	if( !IsFileBacked() )
+	{
+		return false;
+	}
+
+	if( _filename == mFileName )
+	{
+		return true;
+	}
+
+#ifndef _WIN32
+	struct stat fileStat;
+	if( 0 == stat( _filename.c_str(), &fileStat ) )
+	{
+		return (unsigned long long)fileStat.st_dev == mFileDevice && (unsigned long long)fileStat.st_ino == mFileInode;
+	}
+#endif
+
+	return false;
+}
+
+bool CMappedFile::Flush()
+{
+	if( !IsFileBacked() )
+	{
+		return false;
+	}
+
+	if( 0 == mDirtyCount )
+	{
+		return true;
+	}
+
+	FILE* pOut = fopen( mFileName.c_str(), "rb+" );
+	if( nullptr == pOut )
+	{
+		return false;
+	}
+
+	// Write runs of contiguous dirty pages with a single call each.
+	bool   retVal    = true;
+	size_t pagesNum  = mDirtyPages.size();
+	size_t page      = 0;
+	while( page < pagesNum )
+	{
+		if( !mDirtyPages[page] )
+		{
+			++page;
+			continue;
+		}
+
+		size_t firstPage = page;
+		while( page < pagesNum && mDirtyPages[page] )
+		{
+			++page;
+		}
+
+		size_t start = firstPage * mPageSize;
+		size_t end   = page * mPageSize;
+		if( end > mSize )
+		{
+			end = mSize;
+		}
+
+		if( 0 != fseek( pOut, (long)(mFileOffset + start), SEEK_SET ) ||
+			fwrite( mData + start, 1, end - start, pOut ) != end - start )
+		{
+			retVal = false;
+			break;
+		}
+
+		for( size_t clean = firstPage; clean < page; ++clean )
+		{
+			mDirtyPages[clean] = false;
+			--mDirtyCount;
+		}
+	}
+
+	if( 0 != fclose( pOut ) )
+	{
+		retVal = false;
+	}
+
+	return retVal;
+}
+
+bool CMappedFile::WriteTo( FILE* _file ) const
+{
+	if( nullptr == _file )
+	{
+		return false;
+	}
+
+	if( 0 == mSize )
+	{
+		return true;
+	}
+
+	return fwrite( mData, 1, mSize, _file ) == mSize;
+}
+
+void CMappedFile::MarkDirty( size_t _offset, size_t _size )
+{
+	if( !IsFileBacked() || 0 == _size || _offset >= mSize )
+	{
+		return;
+	}
+
+	size_t lastPage = (_offset + _size - 1) / mPageSize;
+	if( lastPage >= mDirtyPages.size() )
+	{
+		lastPage = mDirtyPages.size() - 1;
+	}
+
+	for( size_t page = _offset / mPageSize; page <= lastPage; ++page )
+	{
+		if( !mDirtyPages[page] )
+		{
+			mDirtyPages[page] = true;
+			++mDirtyCount;
+		}
+	}
+}
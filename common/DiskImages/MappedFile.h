@@ -0,0 +1,77 @@
+////////////////////////////////////////////////////////////////////
+//
+// MappedFile.h - Header file for CMappedFile, a helper class that
+//                gives flat disk image formats direct access to the
+//                image file contents.
+//
+// On POSIX systems the file is mapped with copy-on-write semantics,
+// so opening an image costs the same regardless of its size and
+// sector pointers point straight into the mapping. Modified pages
+// are tracked so Flush only writes back what actually changed.
+//
+// Elsewhere, or if the mapping fails, the file is read into a heap
+// buffer and Flush writes back the dirty pages the same way.
+//
+// By Roberto Carlos Fernández Gerhardt aka robcfg
+//
+////////////////////////////////////////////////////////////////////
+
+#ifndef __MAPPED_FILE_H__
+#define __MAPPED_FILE_H__
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+class CMappedFile
+{
+public:
+	CMappedFile();
+	~CMappedFile();
+
+	CMappedFile( const CMappedFile& ) = delete;
+	CMappedFile& operator=( const CMappedFile& ) = delete;
+
+	// Maps _size bytes of _filename starting at _offset. A _size of 0 maps up to the end of the file.
+	bool					Open    ( const std::string& _filename, size_t _offset = 0, size_t _size = 0 );
+	// Allocates an anonymous, zero filled block not backed by any file.
+	bool					Allocate( size_t _size );
+	void					Close   ();
+	// Copies the contents to a private heap block and drops the link with the file.
+	bool					Detach  ();
+
+	// Writes the dirty pages back to the file the block was opened from.
+	bool					Flush   ();
+	// Writes the whole block to _file at its current position.
+	bool					WriteTo ( FILE* _file ) const;
+
+	void					MarkDirty( size_t _offset, size_t _size );
+	bool					IsDirty  () const { return mDirtyCount != 0; }
+
+	bool					IsFileBacked() const { return !mFileName.empty(); }
+	// Tells if _filename refers to the file the block was opened from.
+	bool					IsSameFile  ( const std::string& _filename ) const;
+	const std::string&		GetFileName () const { return mFileName; }
+
+	const unsigned char*	GetData() const { return mData; }
+		  unsigned char*	GetData()       { return mData; }
+	size_t					GetSize() const { return mSize; }
+
+private:
+	std::string				mFileName;
+	size_t					mFileOffset;
+	unsigned char*			mData;
+	size_t					mSize;
+	bool					mMapped;
+	unsigned long long		mFileDevice;	// Identity of the opened file, to detect aliased paths
+	unsigned long long		mFileInode;
+
+	void*					mMapBase;	// Mapped region, aligned to a page boundary
+	size_t					mMapSize;
+
+	size_t					mPageSize;
+	std::vector<bool>		mDirtyPages;
+	size_t					mDirtyCount;
+};
+
+#endif
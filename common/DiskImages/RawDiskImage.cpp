@@ -12,46 +12,24 @@
 #include "RawDiskImage.h"
 #include <sstream>
 
+// Maps the image file. Sectors are accessed straight from the mapping,
+// so nothing is read until a sector is actually used.
 bool CRAWDiskImage::Load(const std::string& _filename)
 {
 	mFileName = _filename;
 
-	// Open file
-	FILE* pIn = fopen( _filename.c_str(), "rb" );
-	if( 0 == pIn )
-		return false;
-
-	// Get file size
-	size_t uFileSize = 0;
-	fseek( pIn, 0, SEEK_END );
-	uFileSize = ftell( pIn );
-	fseek( pIn, 0, SEEK_SET );
-
-	// Allocate memory
-	if( mDataBlock )
-	{
-		delete[] mDataBlock;
-		mDataSize = 0;
-	}
-
-	mDataBlock = new unsigned char[uFileSize];
-	if( !mDataBlock )
-	{
-		fclose( pIn );
-		return false;
-	}
-
-	// Read data
-	fread( mDataBlock, 1, uFileSize, pIn );
-	fclose( pIn );
-
-	mDataSize = uFileSize;
-
-	return true;
+	return mData.Open( _filename );
 }
 
+// Saving to the file the image was loaded from only writes back the
+// pages modified since then. Any other file gets the whole image.
 bool CRAWDiskImage::Save(const std::string& _filename)
 {
+	if( mData.IsSameFile( _filename ) )
+	{
+		return mData.Flush();
+	}
+
 	// Open file
 	FILE* pOut = fopen( _filename.c_str(), "wb" );
 	if( 0 == pOut )
@@ -59,15 +37,10 @@ bool CRAWDiskImage::Save(const std::string& _filename)
 		return false;
 	}
 
-	size_t bytesWritten = fwrite( mDataBlock, 1, mDataSize, pOut );
+	bool retVal = mData.WriteTo( pOut );
 	fclose(pOut);
 
-	if( bytesWritten != mDataSize )
-	{
-		return false;
-	}
-
-	return true;
+	return retVal;
 }
 
 // Creates a blank image with the specified parameters.
@@ -77,28 +50,19 @@ unsigned int CRAWDiskImage::New( unsigned char uTracks, unsigned char uSides, un
 	mTracksNum  = uTracks;
 	mSectorsNum = uSecsPerTrack;
 	mSectorSize = uSectorSize;
-	mDataSize   = mTracksNum * mSidesNum * mSectorsNum * mSectorSize;
-
-	if(nullptr != mDataBlock)
-	{
-		delete mDataBlock;
-	}
 
-	mDataBlock = new unsigned char[mDataSize];
-	if( nullptr == mDataBlock )
+	if( !mData.Allocate( mTracksNum * mSidesNum * mSectorsNum * mSectorSize ) )
 	{
 		mSidesNum   = 0;
 		mTracksNum  = 0;
 		mSectorsNum = 0;
 		mSectorSize = 0;
-		mDataSize   = 0;
 		return 0;
 	}
 
-	memset( mDataBlock, 0, mDataSize );
 	mFileName = "";
 
-	return mDataSize;
+	return (unsigned int)mData.GetSize();
 }
 
 std::string CRAWDiskImage::GetFileSpec()
@@ -128,7 +92,7 @@ std::string CRAWDiskImage::GetDiskInfo()
 	sstream << "Sides       : "   << mSidesNum   << std::endl;
 	sstream << "Sectors     : "   << mSectorsNum << std::endl;
 	sstream << "Sector size : "   << mSectorSize << " bytes" << std::endl;
-	sstream << "Total size  : "   << mDataSize << " bytes/" << mDataSize / 1024 << " KB" << std::endl;
+	sstream << "Total size  : "   << mData.GetSize() << " bytes/" << mData.GetSize() / 1024 << " KB" << std::endl;
 	retVal = sstream.str();
 
 	return retVal;
@@ -148,38 +112,72 @@ SSectorInfo CRAWDiskImage::GetSectorInfo( unsigned int _track, unsigned int _sid
 	return retVal;
 }
  
-const unsigned char* CRAWDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
+// Returns the offset of the sector in the image or (size_t)-1 if out of bounds.
+size_t CRAWDiskImage::GetSectorOffset( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
 {
 	if( mSidesNum == 0 || mTracksNum == 0 || mSectorsNum == 0 || mSectorSize == 0 )
 	{
-		return 0;
+		return (size_t)-1;
 	}
 
 	size_t trackSize = mSectorsNum * mSectorSize;
 	size_t pos = (mSidesNum * uTrack * trackSize ) + (uSide * trackSize ) + (uSector * mSectorSize);
-	if( pos < mDataSize - mSectorSize )
+	if( pos + mSectorSize <= mData.GetSize() )
+	{
+		return pos;
+	}
+
+	return (size_t)-1;
+}
+
+const unsigned char* CRAWDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
+{
+	size_t pos = GetSectorOffset( uTrack, uSide, uSector );
+	if( pos == (size_t)-1 )
 	{
-		return &mDataBlock[pos];
+		return 0;
 	}
 
-	return 0;
+	return mData.GetData() + pos;
 }
 
+// Callers may write through the returned pointer, so the sector is flagged
+// for the next Save.
 unsigned char* CRAWDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
 {
-	if( mSidesNum == 0 || mTracksNum == 0 || mSectorsNum == 0 || mSectorSize == 0 )
+	size_t pos = GetSectorOffset( uTrack, uSide, uSector );
+	if( pos == (size_t)-1 )
 	{
 		return 0;
 	}
 
-	size_t trackSize = mSectorsNum * mSectorSize;
-	size_t pos = (mSidesNum * uTrack * trackSize ) + (uSide * trackSize ) + (uSector * mSectorSize);
-	if( pos < mDataSize - mSectorSize )
+	mData.MarkDirty( pos, mSectorSize );
+
+	return mData.GetData() + pos;
+}
+
+// Sectors are stored in logical order, so the span runs up to the end of the image.
+SSectorSpan CRAWDiskImage::GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const
+{
+	SSectorSpan span = { nullptr, 0, 0 };
+
+	size_t pos = GetSectorOffset( uTrack, uSide, uSector );
+	if( pos == (size_t)-1 || 0 == uMaxSectors )
+	{
+		return span;
+	}
+
+	size_t sectorsNum = (mData.GetSize() - pos) / mSectorSize;
+	if( sectorsNum > uMaxSectors )
 	{
-		return &mDataBlock[pos];
+		sectorsNum = uMaxSectors;
 	}
 
-	return 0;
+	span.data       = mData.GetData() + pos;
+	span.dataSize   = sectorsNum * mSectorSize;
+	span.sectorsNum = (unsigned int)sectorsNum;
+
+	return span;
 }
 
 const unsigned char* CRAWDiskImage::GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID ) const
@@ -196,3 +194,9 @@ IDiskImageInterface* CRAWDiskImage::NewImage() const
 {
 	return new CRAWDiskImage;
 }
+
+int CRAWDiskImage::Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const
+{
+	// Any file can be a raw image, so let the other formats go first.
+	return DISK_IMAGE_PROBE_FALLBACK;
+}
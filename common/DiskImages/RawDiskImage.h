@@ -12,12 +12,13 @@
 
 #include <string.h>
 #include "DiskImageInterface.h"
+#include "MappedFile.h"
 
 class CRAWDiskImage:public IDiskImageInterface
 {
 public:
-	CRAWDiskImage() { mSidesNum = 0; mTracksNum = 0; mSectorsNum = 0; mSectorSize = 0; mDataBlock = 0; mDataSize = 0; }
-	~CRAWDiskImage(){ if(0 != mDataBlock) delete[] mDataBlock; }
+	CRAWDiskImage() { mSidesNum = 0; mTracksNum = 0; mSectorsNum = 0; mSectorSize = 0; }
+	~CRAWDiskImage(){}
 
 	// IDiskImageInterface //////////////////////////////////////////////////////////////////////////////////
 	bool					Load( const std::string& _filename ) override;
@@ -36,6 +37,7 @@ public:
 			unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 			unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+	SSectorSpan				GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const override;
 
 	std::string 			GetFileSpec() override;
 	std::string 			GetDiskInfo() override;
@@ -48,11 +50,13 @@ public:
 	void					SetSectorsNum( size_t _sectors ) override { mSectorsNum = _sectors; }
 	void					SetSectorSize( size_t _size    ) override { mSectorSize = _size;    }
 
-	size_t					GetDataSize() override { return mDataSize; };
+	size_t					GetDataSize() override { return mData.GetSize(); };
 
 	bool 					NeedManualSetup() const override { return true; }
 
 	IDiskImageInterface*	NewImage() const override;
+
+	int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 private:
@@ -61,8 +65,9 @@ private:
 	size_t          mTracksNum;
 	size_t          mSectorsNum;
 	size_t          mSectorSize;
-	unsigned char*  mDataBlock;
-	size_t          mDataSize;
+	CMappedFile     mData;
+
+	size_t          GetSectorOffset( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const;
 };
 
 #endif
\ No newline at end of file
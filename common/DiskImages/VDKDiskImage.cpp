@@ -20,6 +20,7 @@
 #include "VDKDiskImage.h"
 
 // Load the contents of a image file.
+// Only the header is read, the sector data is mapped from the file.
 bool CVDKDiskImage::Load( const std::string& _filename )
 {
 	// Open file
@@ -52,46 +53,33 @@ bool CVDKDiskImage::Load( const std::string& _filename )
 		fread( name, 1, uNameLen, pIn );
 	}
 
+	// Close file
+	fclose( pIn );
+
 	// Check data size
 	unsigned int uDataSize = ((vdkHead.tracks * VDK_SECTORSPERTRACK * VDK_SECTORSIZE) * vdkHead.sides);
 	unsigned int uRightSize = vdkHead.header_len + uDataSize /*+ uNameLen*/;
 
 	if( uRightSize != uFileSize )
 	{
-		fclose(pIn);
 		return false;
 	}
 
-	// Read Data
-	dataBlockSize = uDataSize;
-	dataBlock = new unsigned char[dataBlockSize];
-
-	if( 0 == dataBlock )
+	// Map Data
+	if( !dataBlock.Open( _filename, vdkHead.header_len, uDataSize ) )
 	{
-		fclose(pIn);
 		return false;
 	}
 
-	fseek(pIn,vdkHead.header_len,SEEK_SET);
-	fread( dataBlock, 1, dataBlockSize, pIn );
-
-	// Close file
-	fclose( pIn );
-
+	fileHeaderLen = vdkHead.header_len;
 	fileName = _filename;
 
 	return true;
 }
 
-// Saves current image to a file
-bool CVDKDiskImage::Save( const std::string& _filename )
+// Writes header, name and padding.
+bool CVDKDiskImage::WriteHeader( FILE* pOut ) const
 {
-	FILE* pOut = fopen( _filename.c_str(), "wb" );
-	if( 0 == pOut )
-	{
-		return false;
-	}
-
 	// Save Header
 	fwrite( &vdkHead, 1, sizeof(vdkHead), pOut );
 
@@ -112,13 +100,52 @@ bool CVDKDiskImage::Save( const std::string& _filename )
 		}
 	}
 
+	return 0 == ferror( pOut );
+}
+
+// Saves current image to a file
+// When saving over the mapped file and the header keeps its size, only the
+// header and the modified sectors are written.
+bool CVDKDiskImage::Save( const std::string& _filename )
+{
+	bool sameFile = dataBlock.IsSameFile( _filename );
+
+	if( sameFile && fileHeaderLen == vdkHead.header_len )
+	{
+		FILE* pOut = fopen( _filename.c_str(), "rb+" );
+		if( 0 == pOut )
+		{
+			return false;
+		}
+
+		bool headerWritten = WriteHeader( pOut );
+		fclose( pOut );
+
+		return headerWritten && dataBlock.Flush();
+	}
+
+	// The data offset changes, so the file is rewritten from scratch and
+	// the mapping can't be kept.
+	if( sameFile && !dataBlock.Detach() )
+	{
+		return false;
+	}
+
+	FILE* pOut = fopen( _filename.c_str(), "wb" );
+	if( 0 == pOut )
+	{
+		return false;
+	}
+
+	bool retVal = WriteHeader( pOut );
+
 	// Save Data
-	fwrite( dataBlock, 1, dataBlockSize, pOut );
+	retVal = dataBlock.WriteTo( pOut ) && retVal;
 
 	// Close file
 	fclose(pOut);
 
-	return true;
+	return retVal;
 }
 
 // Creates a blank image with the specified parameters.
@@ -142,22 +169,18 @@ unsigned int CVDKDiskImage::New( unsigned char uTracks, unsigned char uSides, un
 	vdkHead.flags       = 0;
 	vdkHead.compression = VDK_COMPOUT; 
 
-	dataBlockSize = ((vdkHead.tracks * VDK_SECTORSPERTRACK * VDK_SECTORSIZE) * vdkHead.sides);
+	unsigned int dataBlockSize = ((vdkHead.tracks * VDK_SECTORSPERTRACK * VDK_SECTORSIZE) * vdkHead.sides);
 
-	if(0 != dataBlock)
-	{
-		delete dataBlock;
-	}
-
-	dataBlock = new unsigned char[dataBlockSize];
-	if( 0 == dataBlock )
+	if( !dataBlock.Allocate( dataBlockSize ) )
 	{
 		memset( &vdkHead, 0, sizeof(vdkHead) );
 		return 0;
 	}
 
-	memset( dataBlock, VDK_EMPTYSECTORFILL, dataBlockSize   );
-	memset( name     , 0                  , VDK_MAXNAME + 1 );
+	fileHeaderLen = 0;
+
+	memset( dataBlock.GetData(), VDK_EMPTYSECTORFILL, dataBlockSize   );
+	memset( name                , 0                  , VDK_MAXNAME + 1 );
 
 	return dataBlockSize;
 }
@@ -184,14 +207,9 @@ void CVDKDiskImage::SetName( const char* newName )
 
 // Returns pointer to the required sector's data or NULL if parameters are invalid.
 const unsigned char* CVDKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const
-{
-	return GetSector( uTrack, uSide, uSector );
-}
-
-unsigned char* CVDKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
 {
 	// Check values
-	if( 0 == dataBlock                 ) return 0;
+	if( 0 == dataBlock.GetData()       ) return 0;
 	if( uTrack  >= vdkHead.tracks      ) return 0;
 	if( uSide   >= vdkHead.sides       ) return 0;
 	if( uSector >= VDK_SECTORSPERTRACK ) return 0;
@@ -200,7 +218,19 @@ unsigned char* CVDKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide
 	unsigned int uTrackStart = VDK_TRACKSIZE * vdkHead.sides * uTrack;
 	unsigned int uSectorPos = uTrackStart + ( uSide * VDK_TRACKSIZE ) + ( uSector * VDK_SECTORSIZE );
 
-	return &dataBlock[uSectorPos];
+	return dataBlock.GetData() + uSectorPos;
+}
+
+// Writable access flags the sector as modified, so Save writes it back.
+unsigned char* CVDKDiskImage::GetSector( unsigned int uTrack, unsigned int uSide, unsigned int uSector )
+{
+	unsigned char* sector = const_cast<unsigned char*>(const_cast<const CVDKDiskImage*>(this)->GetSector(uTrack, uSide, uSector));
+	if( 0 != sector )
+	{
+		dataBlock.MarkDirty( sector - dataBlock.GetData(), VDK_SECTORSIZE );
+	}
+
+	return sector;
 }
 
 // IDiskImageInterface ///////////////////////
@@ -264,6 +294,30 @@ std::string CVDKDiskImage::GetDiskInfo()
 	return retVal;
 }
 
+// Sectors are stored in logical order, so the span runs up to the end of the image.
+SSectorSpan CVDKDiskImage::GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const
+{
+	SSectorSpan span = { nullptr, 0, 0 };
+
+	const unsigned char* sector = GetSector( uTrack, uSide, uSector );
+	if( 0 == sector || 0 == uMaxSectors )
+	{
+		return span;
+	}
+
+	size_t sectorsNum = (dataBlock.GetSize() - (sector - dataBlock.GetData())) / VDK_SECTORSIZE;
+	if( sectorsNum > uMaxSectors )
+	{
+		sectorsNum = uMaxSectors;
+	}
+
+	span.data       = sector;
+	span.dataSize   = sectorsNum * VDK_SECTORSIZE;
+	span.sectorsNum = (unsigned int)sectorsNum;
+
+	return span;
+}
+
 const unsigned char* CVDKDiskImage::GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSectorID ) const
 {
 	return GetSector( uTrack, uSide, uSectorID );
@@ -309,10 +363,24 @@ size_t CVDKDiskImage::GetSectorSize()
 
 size_t CVDKDiskImage::GetDataSize()
 {
-	return dataBlockSize;
+	return dataBlock.GetSize();
 }
 
 IDiskImageInterface* CVDKDiskImage::NewImage() const
 {
 	return new CVDKDiskImage;
 }
+
+int CVDKDiskImage::Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const
+{
+	if( _headerSize < sizeof(SVDKHeader) || _header[0] != VDK_ID1 || _header[1] != VDK_ID2 )
+	{
+		return DISK_IMAGE_PROBE_NO;
+	}
+
+	// Same size check as Load
+	size_t headerLen = _header[2] | (_header[3] << 8);
+	size_t dataSize  = _header[8] * VDK_TRACKSIZE * _header[9];
+
+	return ( headerLen + dataSize == _fileSize ) ? DISK_IMAGE_PROBE_CERTAIN : DISK_IMAGE_PROBE_NO;
+}
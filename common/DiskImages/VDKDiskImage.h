@@ -44,6 +44,7 @@
 
 #include <string.h>
 #include "DiskImageInterface.h"
+#include "MappedFile.h"
 
 // Defines taken from PC-Dragon source file DOSCART.C
 #define VDK_VER_MAJOR       2
@@ -90,8 +91,8 @@ struct SVDKHeader
 class CVDKDiskImage:public IDiskImageInterface
 {
 public:
-	CVDKDiskImage() { dataBlock = 0; dataBlockSize = 0; name[0] = 0; }
-	~CVDKDiskImage(){ if(0 != dataBlock) delete dataBlock; }
+	CVDKDiskImage() { fileHeaderLen = 0; name[0] = 0; }
+	~CVDKDiskImage(){}
 
 	// IDiskImageInterface //////////////////////////////////////////////////////////////////////////////////
 	bool					Load( const std::string& _filename ) override;
@@ -110,6 +111,7 @@ public:
 			unsigned char*	GetSector    ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) override;
 			// unsigned int	GetSectorID  ( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
 	const 	unsigned char*	GetSectorByID( unsigned int uTrack, unsigned int uSide, unsigned int uSector ) const override;
+	SSectorSpan				GetSectorSpan( unsigned int uTrack, unsigned int uSide, unsigned int uSector, unsigned int uMaxSectors ) const override;
 
 	std::string 			GetFileSpec() override;
 	std::string 			GetDiskInfo() override;
@@ -127,21 +129,26 @@ public:
 	bool 					NeedManualSetup() const override { return false; }
 
 	IDiskImageInterface*	NewImage() const override;
+
+	int						Probe( const unsigned char* _header, size_t _headerSize, size_t _fileSize ) const override;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	const SVDKHeader&		GetHeader       () const { return vdkHead;			}
-	unsigned char*			GetDataBlock    ()    	 { return dataBlock;		}
-	unsigned int			GetDataBlockSize()		 { return dataBlockSize;	}
+	const unsigned char*	GetDataBlock    () const { return dataBlock.GetData();		}
+	unsigned char*			GetWritableDataBlock()	 { dataBlock.MarkDirty( 0, dataBlock.GetSize() ); return dataBlock.GetData(); } // Flags the whole block for the next Save
+	unsigned int			GetDataBlockSize()		 { return (unsigned int)dataBlock.GetSize();	}
 	const char*				GetName         () const { return name;				}
 
 	void                 	SetName			( const char* newName );
 
 private:
 	SVDKHeader           	vdkHead;
-	unsigned char*       	dataBlock;
-	unsigned int         	dataBlockSize;
+	CMappedFile          	dataBlock;
+	unsigned short       	fileHeaderLen;	// Header length of the file dataBlock is mapped from
 	char                 	name[VDK_MAXNAME + 1];
 	std::string          	fileName;
+
+	bool					WriteHeader( FILE* pOut ) const;
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,201 @@
+////////////////////////////////////////////////////////////////////
+//
+// imdbench.cpp - Times single sector reads from an IMD image through
+//                the track/sector index against extracting the
+//                whole disk.
+//
+// Usage: imdbench [image.imd] [passes]
+//
+// Without an image, an 80 track, 2 side, 18 x 256 byte one is
+// created next to the executable and used instead.
+//
+// By Roberto Carlos Fernández Gerhardt aka robcfg
+//
+////////////////////////////////////////////////////////////////////
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+
+#include "IMDDiskImage.h"
+
+using namespace std;
+
+#define IMDBENCH_DEFAULT_PASSES	50
+#define IMDBENCH_READS			1000000
+#define IMDBENCH_TEMP_IMAGE		"imdbench.imd"
+
+struct SSectorAddress
+{
+	unsigned int track;
+	unsigned int side;
+	unsigned int sector;
+};
+
+static double ElapsedMs( chrono::steady_clock::time_point _start )
+{
+	return chrono::duration<double, milli>( chrono::steady_clock::now() - _start ).count();
+}
+
+// Every third sector is left as the formatting filler so it is stored
+// compressed, the rest get data that changes with each byte.
+static bool CreateImage( const string& _filename )
+{
+	CIMDDiskImage disk;
+	disk.New( 80, 2, 18, 256 );
+
+	for( unsigned int side = 0; side < 2; ++side )
+	{
+		for( unsigned int track = 0; track < 80; ++track )
+		{
+			for( unsigned int sector = 0; sector < 18; ++sector )
+			{
+				if( sector % 3 == 0 )
+				{
+					continue;
+				}
+
+				unsigned char* data = disk.GetSector( track, side, sector );
+				for( unsigned int byte = 0; byte < 256; ++byte )
+				{
+					data[byte] = (unsigned char)(track * 7 + side * 3 + sector + byte);
+				}
+			}
+		}
+	}
+
+	return disk.Save( _filename );
+}
+
+static void ListSectors( const CIMDDiskImage& _disk, vector<SSectorAddress>& _sectors )
+{
+	_sectors.clear();
+	for( int side = 0; side < _disk.GetSidesNum(); ++side )
+	{
+		for( int track = 0; track < _disk.GetTracksNum(); ++track )
+		{
+			int sectorsNum = _disk.GetSectorsNum( side, track );
+			for( int sector = 0; sector < sectorsNum; ++sector )
+			{
+				_sectors.push_back( { (unsigned int)track, (unsigned int)side, (unsigned int)sector } );
+			}
+		}
+	}
+}
+
+// Loads the image and copies every sector out, as extracting a full disk does.
+static bool ExtractDisk( const string& _filename, vector<unsigned char>& _out, unsigned long& _checksum )
+{
+	CIMDDiskImage disk;
+	if( !disk.Load( _filename ) )
+	{
+		return false;
+	}
+
+	const CIMDDiskImage& constDisk = disk;
+	vector<SSectorAddress> sectors;
+	ListSectors( constDisk, sectors );
+
+	_out.clear();
+	for( const SSectorAddress& address : sectors )
+	{
+		const unsigned char* data = constDisk.GetSector( address.track, address.side, address.sector );
+		if( nullptr != data )
+		{
+			size_t sectorSize = disk.GetSectorSize( address.track, address.side, address.sector );
+			_out.insert( _out.end(), data, data + sectorSize );
+			_checksum += data[0];
+		}
+	}
+
+	return true;
+}
+
+int main( int argc, char** argv )
+{
+	string filename = argc > 1 ? argv[1] : IMDBENCH_TEMP_IMAGE;
+	int passes = argc > 2 ? atoi( argv[2] ) : IMDBENCH_DEFAULT_PASSES;
+	if( passes <= 0 )
+	{
+		passes = IMDBENCH_DEFAULT_PASSES;
+	}
+
+	if( argc < 2 && !CreateImage( filename ) )
+	{
+		printf( "Couldn't create %s\n", filename.c_str() );
+		return -1;
+	}
+
+	CIMDDiskImage disk;
+	if( !disk.Load( filename ) )
+	{
+		printf( "Couldn't load %s\n", filename.c_str() );
+		return -1;
+	}
+
+	const CIMDDiskImage& constDisk = disk;
+	vector<SSectorAddress> sectors;
+	ListSectors( constDisk, sectors );
+	if( sectors.empty() )
+	{
+		printf( "%s has no sectors\n", filename.c_str() );
+		return -1;
+	}
+
+	unsigned long checksum = 0;
+	vector<unsigned char> extracted;
+
+	// Full disk extraction: load and decode the image, then copy every sector.
+	auto start = chrono::steady_clock::now();
+	for( int pass = 0; pass < passes; ++pass )
+	{
+		if( !ExtractDisk( filename, extracted, checksum ) )
+		{
+			printf( "Couldn't load %s\n", filename.c_str() );
+			return -1;
+		}
+	}
+	double extractMs = ElapsedMs( start ) / passes;
+
+	// Every sector of the already loaded image through the index.
+	start = chrono::steady_clock::now();
+	for( int pass = 0; pass < passes; ++pass )
+	{
+		for( const SSectorAddress& address : sectors )
+		{
+			const unsigned char* data = constDisk.GetSector( address.track, address.side, address.sector );
+			checksum += (nullptr != data) ? data[0] : 0;
+		}
+	}
+	double allSectorsMs = ElapsedMs( start ) / passes;
+
+	// Single sector reads in random order through the index.
+	mt19937 rng( 1234 );
+	uniform_int_distribution<size_t> pick( 0, sectors.size() - 1 );
+	vector<size_t> order( IMDBENCH_READS );
+	for( size_t& idx : order )
+	{
+		idx = pick( rng );
+	}
+
+	start = chrono::steady_clock::now();
+	for( size_t idx : order )
+	{
+		const SSectorAddress& address = sectors[idx];
+		const unsigned char* data = constDisk.GetSector( address.track, address.side, address.sector );
+		checksum += (nullptr != data) ? data[0] : 0;
+	}
+	double singleReadNs = ElapsedMs( start ) * 1000000.0 / IMDBENCH_READS;
+
+	printf( "Image          : %s (%zu sectors, %zu bytes)\n", filename.c_str(), sectors.size(), extracted.size() );
+	printf( "Full extraction: %10.3f ms per disk (%d passes)\n", extractMs, passes );
+	printf( "Indexed, all   : %10.3f ms per disk (%.1f ns per sector)\n", allSectorsMs, allSectorsMs * 1000000.0 / sectors.size() );
+	printf( "Indexed, single: %10.1f ns per sector (%d random reads)\n", singleReadNs, IMDBENCH_READS );
+	printf( "Reading one sector is %.0fx faster than extracting the disk.\n", extractMs * 1000000.0 / singleReadNs );
+	printf( "Checksum       : %lu\n", checksum );
+
+	return 0;
+}
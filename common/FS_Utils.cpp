@@ -5,38 +5,305 @@
 ////////////////////////////////////////////////////////////////////
 
 #include "FS_Utils.h"
+#include <ctype.h>
 #include <string.h> // for strcasecmp
 #include <vector>
+#include <algorithm>
 
 #ifndef _WIN32
 #define _stricmp strcasecmp
 #endif
 
+CDiskGeometry::CDiskGeometry()
+{
+    SetDisk( nullptr );
+}
+
+CDiskGeometry::CDiskGeometry( IDiskImageInterface* _disk )
+{
+    SetDisk( _disk );
+}
+
+// Reads and caches the disk geometry.
+void CDiskGeometry::SetDisk( IDiskImageInterface* _disk )
+{
+    disk               = _disk;
+    sidesNum           = 0;
+    tracksNum          = 0;
+    sectorsPerTrack    = 0;
+    sectorsPerCylinder = 0;
+    lsnNum             = 0;
+
+    if( nullptr == disk )
+    {
+        return;
+    }
+
+    int sides   = disk->GetSidesNum();
+    int tracks  = disk->GetTracksNum();
+    int sectors = disk->GetSectorsNum();
+    if( sides <= 0 || tracks <= 0 || sectors <= 0 )
+    {
+        return;
+    }
+
+    sidesNum           = (unsigned int)sides;
+    tracksNum          = (unsigned int)tracks;
+    sectorsPerTrack    = (unsigned int)sectors;
+    sectorsPerCylinder = sidesNum * sectorsPerTrack;
+    lsnNum             = (uint32_t)(tracksNum * sectorsPerCylinder);
+}
+
 // Translates track, head and sector numbers to Logical Sector Number
-unsigned short int LSN( const IDiskImageInterface& _disk, unsigned short int _track, unsigned short int _side, unsigned short int _sector )
+uint32_t CDiskGeometry::LSN( unsigned int _track, unsigned int _side, unsigned int _sector ) const
 {
-    return ((_track * _disk.GetSidesNum() * _disk.GetSectorsNum()) + (_side * _disk.GetSectorsNum()) + _sector);
+    return (_track * sectorsPerCylinder) + (_side * sectorsPerTrack) + _sector;
 }
 
-// Returns the track number of a given LSN
-unsigned char LSNTrack( const IDiskImageInterface& _disk, unsigned short int LSN )
+// Translates a Logical Sector Number to track, head and sector numbers
+void CDiskGeometry::LSNToTHS( uint32_t _lsn, unsigned int& _track, unsigned int& _side, unsigned int& _sector ) const
 {
+    if( 0 == sectorsPerCylinder )
+    {
+        _track = _side = _sector = 0;
+        return;
+    }
+
     // track = LSN / (SECTORS * HEADS)
-    return (unsigned char)(LSN/(_disk.GetSidesNum() * _disk.GetSectorsNum()));
+    // head = LSN % (SECTORS * HEADS) / SECTORS
+    // sector = LSN % (SECTORS * HEADS) % SECTORS
+    unsigned int cylinderSector = _lsn % sectorsPerCylinder;
+
+    _track  = _lsn / sectorsPerCylinder;
+    _side   = cylinderSector / sectorsPerTrack;
+    _sector = cylinderSector % sectorsPerTrack;
+}
+
+// Returns the track number of a given LSN
+unsigned int CDiskGeometry::LSNTrack( uint32_t _lsn ) const
+{
+    unsigned int track, side, sector;
+    LSNToTHS( _lsn, track, side, sector );
+    return track;
 }
 
 // Returns the head number of a given LSN
-unsigned char LSNHead( const IDiskImageInterface& _disk, unsigned short int LSN )
+unsigned int CDiskGeometry::LSNHead( uint32_t _lsn ) const
 {
-    // head = LSN % (SECTORS * HEADS) / SECTORS
-    return (unsigned char)(LSN % (_disk.GetSectorsNum() * _disk.GetSidesNum()) / _disk.GetSectorsNum());
+    unsigned int track, side, sector;
+    LSNToTHS( _lsn, track, side, sector );
+    return side;
 }
 
 // Returns the sector number of a given LSN
-unsigned char LSNSector( const IDiskImageInterface& _disk, unsigned short int LSN )
+unsigned int CDiskGeometry::LSNSector( uint32_t _lsn ) const
 {
-    // sector = LSN % (SECTORS * HEADS) % SECTORS
-    return (unsigned char)(LSN % (_disk.GetSectorsNum() * _disk.GetSidesNum()) % _disk.GetSectorsNum());
+    unsigned int track, side, sector;
+    LSNToTHS( _lsn, track, side, sector );
+    return sector;
+}
+
+const unsigned char* CDiskGeometry::GetSector( uint32_t _lsn ) const
+{
+    if( _lsn >= lsnNum )
+    {
+        return nullptr;
+    }
+
+    unsigned int track, side, sector;
+    LSNToTHS( _lsn, track, side, sector );
+
+    const IDiskImageInterface* constDisk = disk;
+    return constDisk->GetSector( track, side, sector );
+}
+
+unsigned char* CDiskGeometry::GetSector( uint32_t _lsn )
+{
+    if( _lsn >= lsnNum )
+    {
+        return nullptr;
+    }
+
+    unsigned int track, side, sector;
+    LSNToTHS( _lsn, track, side, sector );
+
+    return disk->GetSector( track, side, sector );
+}
+
+// Only the first LSN of the run is divided, the rest are reached by stepping
+// the sector, side and track counters.
+template< typename Disk, typename Sector >
+bool CDiskGeometry::GetSectorRun( Disk* _disk, const CDiskGeometry& _geometry, uint32_t _firstLSN, uint32_t _count, std::vector<Sector*>& _sectors )
+{
+    _sectors.clear();
+
+    if( _firstLSN > _geometry.lsnNum || _count > _geometry.lsnNum - _firstLSN )
+    {
+        return false;
+    }
+
+    _sectors.reserve( _count );
+
+    unsigned int track, side, sector;
+    _geometry.LSNToTHS( _firstLSN, track, side, sector );
+
+    for( uint32_t sectorIdx = 0; sectorIdx < _count; ++sectorIdx )
+    {
+        Sector* data = _disk->GetSector( track, side, sector );
+        if( nullptr == data )
+        {
+            _sectors.clear();
+            return false;
+        }
+        _sectors.push_back( data );
+
+        if( ++sector == _geometry.sectorsPerTrack )
+        {
+            sector = 0;
+            if( ++side == _geometry.sidesNum )
+            {
+                side = 0;
+                ++track;
+            }
+        }
+    }
+
+    return true;
+}
+
+bool CDiskGeometry::GetSectors( uint32_t _firstLSN, uint32_t _count, std::vector<const unsigned char*>& _sectors ) const
+{
+    const IDiskImageInterface* constDisk = disk;
+    return GetSectorRun( constDisk, *this, _firstLSN, _count, _sectors );
+}
+
+bool CDiskGeometry::GetSectors( uint32_t _firstLSN, uint32_t _count, std::vector<unsigned char*>& _sectors )
+{
+    return GetSectorRun( disk, *this, _firstLSN, _count, _sectors );
+}
+
+bool CDiskGeometry::GetSpans( uint32_t _firstLSN, uint32_t _count, std::vector<SSectorSpan>& _spans ) const
+{
+    _spans.clear();
+
+    if( _firstLSN > lsnNum || _count > lsnNum - _firstLSN )
+    {
+        return false;
+    }
+
+    const IDiskImageInterface* constDisk = disk;
+    while( _count > 0 )
+    {
+        unsigned int track, side, sector;
+        LSNToTHS( _firstLSN, track, side, sector );
+
+        SSectorSpan span = constDisk->GetSectorSpan( track, side, sector, _count );
+        if( nullptr == span.data || 0 == span.sectorsNum )
+        {
+            _spans.clear();
+            return false;
+        }
+
+        if( span.sectorsNum > _count )
+        {
+            span.dataSize   = span.dataSize / span.sectorsNum * _count;
+            span.sectorsNum = _count;
+        }
+
+        _spans.push_back( span );
+        _firstLSN += span.sectorsNum;
+        _count    -= span.sectorsNum;
+    }
+
+    return true;
+}
+
+void CFileNameIndex::Add( const std::string& _name, size_t _pos )
+{
+    index.emplace( _name, _pos );
+}
+
+size_t CFileNameIndex::Find( const std::string& _name ) const
+{
+    auto it = index.find( _name );
+
+    return (it == index.end()) ? npos : it->second;
+}
+
+// FNV-1a over the upper case version of the name.
+size_t CFileNameIndex::SNameHash::operator()( const std::string& _name ) const
+{
+    uint32_t hash = 2166136261u;
+    for( unsigned char c : _name )
+    {
+        hash ^= (uint32_t)toupper( c );
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+bool CFileNameIndex::SNameEqual::operator()( const std::string& _a, const std::string& _b ) const
+{
+    return _a.length() == _b.length() && 0 == _stricmp( _a.c_str(), _b.c_str() );
+}
+
+void AppendSpans( const std::vector<SSectorSpan>& _spans, size_t _begin, size_t _end, std::vector<unsigned char>& _dst )
+{
+    std::vector<SFileSegment> segments;
+    _dst.reserve( _dst.size() + AppendSpanSegments( _spans, _begin, _end, segments ) );
+
+    for( const SFileSegment& segment : segments )
+    {
+        _dst.insert( _dst.end(), segment.data, segment.data + segment.size );
+    }
+}
+
+size_t AppendSpanSegments( const std::vector<SSectorSpan>& _spans, size_t _begin, size_t _end, std::vector<SFileSegment>& _segments )
+{
+    size_t bytesAdded = 0;
+    size_t spanStart  = 0;
+    for( const SSectorSpan& span : _spans )
+    {
+        if( spanStart >= _end )
+        {
+            break;
+        }
+
+        size_t spanEnd = spanStart + span.dataSize;
+        if( spanEnd > _begin && span.dataSize > 0 )
+        {
+            size_t first = (_begin > spanStart) ? _begin - spanStart : 0;
+            size_t last  = std::min( spanEnd, _end ) - spanStart;
+
+            // Spans may follow each other in memory too, so merge them.
+            const unsigned char* data = span.data + first;
+            if( !_segments.empty() && _segments.back().data + _segments.back().size == data )
+            {
+                _segments.back().size += last - first;
+            }
+            else
+            {
+                _segments.push_back( { data, last - first } );
+            }
+            bytesAdded += last - first;
+        }
+
+        spanStart = spanEnd;
+    }
+
+    return bytesAdded;
+}
+
+size_t GetSegmentsSize( const std::vector<SFileSegment>& _segments )
+{
+    size_t size = 0;
+    for( const SFileSegment& segment : _segments )
+    {
+        size += segment.size;
+    }
+
+    return size;
 }
 
 const CDirectoryEntryWrapper* FindDirectoryEntry( const CDirectoryEntryWrapper* _parent, std::vector<std::string>& _tokens, size_t curToken )
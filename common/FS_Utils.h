@@ -8,10 +8,103 @@
 
 #include "DiskImages/DiskImageInterface.h"
 #include "FileSystems/FileSystemInterface.h"
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
-unsigned short int LSN      ( const IDiskImageInterface& _disk, unsigned short int _track, unsigned short int _side, unsigned short int _sector );
-unsigned char      LSNTrack ( const IDiskImageInterface& _disk, unsigned short int LSN );
-unsigned char      LSNHead  ( const IDiskImageInterface& _disk, unsigned short int LSN );
-unsigned char      LSNSector( const IDiskImageInterface& _disk, unsigned short int LSN );
+// Translates Logical Sector Numbers to track, head and sector numbers and back.
+//
+// The disk geometry is read once when the disk is set, so translations don't
+// go through the disk image interface. File systems keep one of these next to
+// their disk pointer and call SetDisk again if the image geometry changes.
+//
+// LSNs are counted cylinder by cylinder: all sectors of side 0 of a track,
+// then side 1, and so on.
+class CDiskGeometry
+{
+public:
+    CDiskGeometry();
+    explicit CDiskGeometry( IDiskImageInterface* _disk );
+
+    void                  SetDisk( IDiskImageInterface* _disk );
+    IDiskImageInterface*  GetDisk() const { return disk; }
+
+    bool         IsValid          () const { return nullptr != disk && 0 != sectorsPerCylinder; }
+    unsigned int GetSidesNum      () const { return sidesNum; }
+    unsigned int GetTracksNum     () const { return tracksNum; }
+    unsigned int GetSectorsPerTrack() const { return sectorsPerTrack; }
+    uint32_t     GetLSNNum        () const { return lsnNum; }
+
+    uint32_t     LSN      ( unsigned int _track, unsigned int _side, unsigned int _sector ) const;
+    void         LSNToTHS ( uint32_t _lsn, unsigned int& _track, unsigned int& _side, unsigned int& _sector ) const;
+    unsigned int LSNTrack ( uint32_t _lsn ) const;
+    unsigned int LSNHead  ( uint32_t _lsn ) const;
+    unsigned int LSNSector( uint32_t _lsn ) const;
+
+    // Returns nullptr if the LSN is out of the disk or the sector is missing.
+    // The const version reads through the const disk interface, so the image isn't marked as modified.
+    const unsigned char* GetSector( uint32_t _lsn ) const;
+          unsigned char* GetSector( uint32_t _lsn );
+
+    // Translates the run of _count sectors starting at _firstLSN in one go, replacing the contents of _sectors.
+    // Returns false if any of them is out of the disk or missing.
+    bool GetSectors( uint32_t _firstLSN, uint32_t _count, std::vector<const unsigned char*>& _sectors ) const;
+    bool GetSectors( uint32_t _firstLSN, uint32_t _count, std::vector<unsigned char*>& _sectors );
+
+    // Splits the run of _count sectors starting at _firstLSN into as few spans of contiguous
+    // sector data as the image allows, replacing the contents of _spans.
+    // Returns false if any of the sectors is out of the disk or missing.
+    bool GetSpans( uint32_t _firstLSN, uint32_t _count, std::vector<SSectorSpan>& _spans ) const;
+
+private:
+    IDiskImageInterface*  disk;
+    unsigned int          sidesNum;
+    unsigned int          tracksNum;
+    unsigned int          sectorsPerTrack;
+    unsigned int          sectorsPerCylinder;
+    uint32_t              lsnNum;
+
+    template< typename Disk, typename Sector >
+    static bool GetSectorRun( Disk* _disk, const CDiskGeometry& _geometry, uint32_t _firstLSN, uint32_t _count, std::vector<Sector*>& _sectors );
+};
+
+// Case insensitive map from file names or paths to positions in a file system's own
+// file list, so looking a file up by name doesn't scan the whole directory.
+//
+// Names are compared ignoring ASCII case, like _stricmp. If a name is added more than
+// once the first position is kept, which is what a search from the start would find.
+// File systems rebuild the index whenever their file list changes.
+class CFileNameIndex
+{
+public:
+    static const size_t npos = (size_t)-1;
+
+    void   Clear  ()                  { index.clear(); }
+    void   Reserve( size_t _namesNum ) { index.reserve( _namesNum ); }
+    void   Add    ( const std::string& _name, size_t _pos );
+    // Returns npos if there's no file with that name.
+    size_t Find   ( const std::string& _name ) const;
+
+private:
+    struct SNameHash
+    {
+        size_t operator()( const std::string& _name ) const;
+    };
+    struct SNameEqual
+    {
+        bool operator()( const std::string& _a, const std::string& _b ) const;
+    };
+
+    std::unordered_map<std::string, size_t, SNameHash, SNameEqual> index;
+};
+
+// Appends bytes [_begin,_end) of the data held by _spans, taken as a whole, to _dst.
+void AppendSpans( const std::vector<SSectorSpan>& _spans, size_t _begin, size_t _end, std::vector<unsigned char>& _dst );
+// Appends segments for bytes [_begin,_end) of the data held by _spans to _segments.
+// Returns the number of bytes they cover.
+size_t AppendSpanSegments( const std::vector<SSectorSpan>& _spans, size_t _begin, size_t _end, std::vector<SFileSegment>& _segments );
+// Total number of bytes covered by _segments.
+size_t GetSegmentsSize( const std::vector<SFileSegment>& _segments );
 
-const CDirectoryEntryWrapper* FindDirectoryEntry( const CDirectoryEntryWrapper* _parent, std::vector<std::string>& _tokens, size_t curToken );
\ No newline at end of file
+const CDirectoryEntryWrapper* FindDirectoryEntry( const CDirectoryEntryWrapper* _parent, std::vector<std::string>& _tokens, size_t curToken );
@@ -0,0 +1,107 @@
+////////////////////////////////////////////////////////////////////
+//
+// FileSegments.cpp - Writing of file contents held as segments.
+//
+////////////////////////////////////////////////////////////////////
+
+#include "FileSegments.h"
+
+#ifndef _WIN32
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+// Segments handed to each writev call.
+#if defined(IOV_MAX) && IOV_MAX < 256
+#define WRITE_SEGMENTS_BATCH IOV_MAX
+#elif defined(IOV_MAX)
+#define WRITE_SEGMENTS_BATCH 256
+#else
+#define WRITE_SEGMENTS_BATCH 16
+#endif
+#endif
+
+// Writes the segments to the file, in order, and returns the number of bytes written.
+// On POSIX systems they're handed to writev in batches, so the data goes from the
+// disk image to the file without being copied into an intermediate buffer.
+size_t WriteFileSegments( FILE* _file, const std::vector<SFileSegment>& _segments )
+{
+    size_t bytesWritten = 0;
+
+#ifndef _WIN32
+    // Anything already buffered by stdio must go before the segments.
+    if( 0 != fflush( _file ) )
+    {
+        return 0;
+    }
+
+    int          fd             = fileno( _file );
+    size_t       segment        = 0;
+    size_t       segmentOffset  = 0; // Bytes of the current segment already written
+    struct iovec iov[WRITE_SEGMENTS_BATCH];
+
+    while( true )
+    {
+        while( segment < _segments.size() && segmentOffset == _segments[segment].size )
+        {
+            ++segment;
+            segmentOffset = 0;
+        }
+
+        if( segment == _segments.size() )
+        {
+            break;
+        }
+
+        int iovNum = 0;
+        for( size_t idx = segment; idx < _segments.size() && iovNum < WRITE_SEGMENTS_BATCH; ++idx )
+        {
+            size_t offset = (idx == segment) ? segmentOffset : 0;
+            iov[iovNum].iov_base = (void*)(_segments[idx].data + offset);
+            iov[iovNum].iov_len  = _segments[idx].size - offset;
+            ++iovNum;
+        }
+
+        ssize_t written = writev( fd, iov, iovNum );
+        if( written < 0 && EINTR == errno )
+        {
+            continue;
+        }
+        if( written <= 0 )
+        {
+            break;
+        }
+
+        bytesWritten += (size_t)written;
+
+        // Skip what went out, which may end in the middle of a segment.
+        size_t left = (size_t)written;
+        while( left > 0 )
+        {
+            size_t segmentLeft = _segments[segment].size - segmentOffset;
+            if( left < segmentLeft )
+            {
+                segmentOffset += left;
+                break;
+            }
+
+            left -= segmentLeft;
+            ++segment;
+            segmentOffset = 0;
+        }
+    }
+#else
+    for( const SFileSegment& segment : _segments )
+    {
+        size_t written = fwrite( segment.data, 1, segment.size, _file );
+        bytesWritten += written;
+        if( written != segment.size )
+        {
+            break;
+        }
+    }
+#endif
+
+    return bytesWritten;
+}
@@ -0,0 +1,25 @@
+////////////////////////////////////////////////////////////////////
+//
+// FileSegments.h - Pieces of a file's contents, as handed out by
+//                  the file systems' ExtractFileSegments, and how
+//                  to write them to a file.
+//
+// Kept apart from FS_Utils so the tools with their own copies of
+// the disk image and file system interfaces can use it too.
+//
+////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <stdio.h>
+#include <vector>
+
+// Piece of a file's contents.
+struct SFileSegment
+{
+    const unsigned char* data;
+    size_t               size;
+};
+
+// Writes the segments to the file, in order, and returns the number of bytes written.
+size_t WriteFileSegments( FILE* _file, const std::vector<SFileSegment>& _segments );
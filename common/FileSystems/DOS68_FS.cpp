@@ -15,7 +15,11 @@ bool CDOS68_FS::Load(IDiskImageInterface* _disk)
 
 	mDisk = _disk;
 
+	// The directory is only read here.
+	const IDiskImageInterface* constDisk = _disk;
+
 	mDirectory.clear();
+	mNameIndex.Clear();
 
 	unsigned char side   = DOS68_DIR_START_SIDE;
 	unsigned char track  = DOS68_DIR_START_TRACK;
@@ -28,7 +32,7 @@ bool CDOS68_FS::Load(IDiskImageInterface* _disk)
 	{
 		size_t offset = 0;
 
-		const unsigned char* sectorData = _disk->GetSector( track, side, sector );
+		const unsigned char* sectorData = constDisk->GetSector( track, side, sector );
 		if( nullptr == sectorData )
 		{
 			return false;
@@ -114,6 +118,7 @@ bool CDOS68_FS::Load(IDiskImageInterface* _disk)
 
 			if( !fib.name.empty() )
 			{
+				mNameIndex.Add( fib.fullName, mDirectory.size() );
 				mDirectory.push_back( fib );
 			}
 		}
@@ -186,25 +191,52 @@ size_t CDOS68_FS::GetFreeSize() const
 
 bool CDOS68_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned char>& _dst, bool _withBinaryHeader ) const
 {
-	if( nullptr == mDisk )
+	std::vector<SFileSegment> segments;
+	std::vector<unsigned char> buffer;
+	if( !ExtractFileSegments( _fileName, segments, buffer, _withBinaryHeader ) )
 	{
 		return false;
 	}
 
-	auto predicate = [_fileName](const SDOS68_FileInfoBlock& _fib){ return 0 == _fib.fullName.compare(_fileName); };
+	for( const SFileSegment& segment : segments )
+	{
+		_dst.insert( _dst.end(), segment.data, segment.data + segment.size );
+	}
+
+	return true;
+}
 
-	auto result = std::find_if(mDirectory.begin(), mDirectory.end(), predicate);
-	if( result != mDirectory.end() )
+// Every sector starts with the link to the next one, so there's one segment per sector.
+bool CDOS68_FS::ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const
+{
+	_segments.clear();
+	_buffer.clear();
+
+	if( nullptr == mDisk )
 	{
+		return false;
+	}
+
+	size_t fileIdx = mNameIndex.Find( _fileName );
+	if( fileIdx != CFileNameIndex::npos )
+	{
+		auto result = mDirectory.begin() + fileIdx;
 		uint8_t trackId = result->firstTrack;
 		uint8_t sectorId = result->firstSector;
 		uint16_t sectorsNum = (result->sectorsNumHigh << 8) | result->sectorsNumLow;
 
+		const IDiskImageInterface* disk = mDisk;
+		_segments.reserve( sectorsNum );
 		for( uint16_t sector = 0; sector < sectorsNum; ++sector )
 		{
-			const unsigned char* sectorData = mDisk->GetSector( trackId, 0, sectorId );
+			const unsigned char* sectorData = disk->GetSector( trackId, 0, sectorId );
+			if( nullptr == sectorData )
+			{
+				_segments.clear();
+				return false;
+			}
 
-			_dst.insert( _dst.end(), sectorData + 4, sectorData + DOS68_SECTOR_SIZE );
+			_segments.push_back( { sectorData + 4, DOS68_SECTOR_SIZE - 4 } );
 
 			trackId = sectorData[0] & DOS68_TRACK_ID_MASK;
 			sectorId = sectorData[1] & DOS68_SECTOR_ID_MASK;
@@ -213,9 +245,19 @@ bool CDOS68_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned
 		// Remove trailing zeroes if file is an ASCII file.
 		if( result->type == DOS68_FILE_TYPE_SEQ_ASCII )
 		{
-			while( 0 == _dst.back() )
+			while( !_segments.empty() )
 			{
-				_dst.pop_back();
+				SFileSegment& last = _segments.back();
+				while( last.size > 0 && 0 == last.data[last.size - 1] )
+				{
+					--last.size;
+				}
+
+				if( last.size > 0 )
+				{
+					break;
+				}
+				_segments.pop_back();
 			}
 		}
 
@@ -339,7 +381,9 @@ bool CDOS68_FS::InsertFile( const std::string& _fileName, const std::vector<unsi
 	}
 
 	SDOS68_FileInfoBlock newFib;
-	fibData = mDisk->GetSector( track, 0, sector );
+	unsigned char fibTrack  = track;
+	unsigned char fibSector = sector;
+	fibData = mDisk->GetSector( fibTrack, 0, fibSector );
 	offset = 8 + (fibSlot * DOS68_FIB_SIZE);
 	uint16_t fileSectors = (uint16_t)(_src.size() / DOS68_SECTOR_DATA_SIZE);
 	if( (_src.size() % DOS68_SECTOR_DATA_SIZE) )
@@ -416,6 +460,13 @@ bool CDOS68_FS::InsertFile( const std::string& _fileName, const std::vector<unsi
 	offset +=6;
 	fibData[offset] = 0xAA;
 
+	newFib.fullName        = newFib.name + "." + newFib.ext;
+	newFib.directoryTrack  = fibTrack;
+	newFib.directorySector = fibSector;
+	newFib.directoryIndex  = fibSlot;
+	mNameIndex.Add( newFib.fullName, mDirectory.size() );
+	mDirectory.push_back( newFib );
+
 	UpdateDiskInformationBlock();
 	
 	return true;
@@ -428,11 +479,10 @@ bool CDOS68_FS::DeleteFile( const std::string& _fileName )
 		return false;
 	}
 
-	auto predicate = [_fileName](SDOS68_FileInfoBlock& _fib){ return 0 == _fib.fullName.compare(_fileName); };
-
-	auto result = std::find_if(mDirectory.begin(), mDirectory.end(), predicate);
-	if( result != mDirectory.end() )
+	size_t fileIdx = mNameIndex.Find( _fileName );
+	if( fileIdx != CFileNameIndex::npos )
 	{
+		auto result = mDirectory.begin() + fileIdx;
 		uint8_t trackId      = result->firstTrack  & DOS68_TRACK_ID_MASK;
 		uint8_t sectorId     = result->firstSector & DOS68_SECTOR_ID_MASK;
 		uint8_t sectorParams[4];
@@ -471,8 +521,6 @@ bool CDOS68_FS::DeleteFile( const std::string& _fileName )
 
 		SetAvailableSectorsNum( freeSectorCount );
 
-		mDirectory.erase( result );
-		
 		sectorData = mDisk->GetSector( result->directoryTrack, 0, result->directorySector );
 		if( nullptr == sectorData )
 		{
@@ -480,6 +528,14 @@ bool CDOS68_FS::DeleteFile( const std::string& _fileName )
 		}
 		memset( sectorData + 8 + (result->directoryIndex * DOS68_FIB_SIZE), 0, DOS68_FIB_SIZE );
 
+		// Files after the deleted one move down a position.
+		mDirectory.erase( result );
+		mNameIndex.Clear();
+		for( size_t idx = 0; idx < mDirectory.size(); ++idx )
+		{
+			mNameIndex.Add( mDirectory[idx].fullName, idx );
+		}
+
 		UpdateDiskInformationBlock();
 
 		return true;
@@ -636,3 +692,40 @@ IFileSystemInterface* CDOS68_FS::NewFileSystem()
 {
 	return new CDOS68_FS;
 }
+
+// Follows the directory block chain, checking that every link points inside the disk
+// and that it ends before visiting more blocks than the disk has sectors.
+int CDOS68_FS::Probe( const IDiskImageInterface* _disk ) const
+{
+	if( nullptr == _disk || DOS68_SECTORS_PER_TRACK != _disk->GetSectorsNum() )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	size_t tracksNum  = (size_t)_disk->GetTracksNum();
+	size_t maxBlocks  = tracksNum * DOS68_SECTORS_PER_TRACK;
+	size_t blocksRead = 0;
+
+	unsigned char track  = DOS68_DIR_START_TRACK;
+	unsigned char sector = DOS68_DIR_START_SECTOR;
+
+	do
+	{
+		if( track >= tracksNum || sector > DOS68_MAX_SECTOR_ID || ++blocksRead > maxBlocks )
+		{
+			return FILE_SYSTEM_PROBE_NO;
+		}
+
+		const unsigned char* sectorData = _disk->GetSector( track, DOS68_DIR_START_SIDE, sector );
+		SSectorInfo sectorInfo = _disk->GetSectorInfo( track, DOS68_DIR_START_SIDE, sector );
+		if( nullptr == sectorData || (sectorInfo.isValid && sectorInfo.dataSize < DOS68_SECTOR_SIZE) )
+		{
+			return FILE_SYSTEM_PROBE_NO;
+		}
+
+		track  = sectorData[0] & DOS68_TRACK_ID_MASK;
+		sector = sectorData[1] & DOS68_SECTOR_ID_MASK;
+	} while( 0 != track );
+
+	return FILE_SYSTEM_PROBE_LIKELY;
+}
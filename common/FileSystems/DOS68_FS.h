@@ -17,6 +17,7 @@
 
 #include "DiskImageInterface.h"
 #include "FileSystemInterface.h"
+#include "FS_Utils.h"
 #include <vector>
 #include <string>
 
@@ -104,6 +105,7 @@ public:
 	const CDirectoryEntryWrapper& GetFSRoot() const;
 
 	bool ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const;
+	bool ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const;
 	bool InsertFile ( const std::string& _fileName, const std::vector<unsigned char>& src, bool _binaryFile );
 	bool DeleteFile ( const std::string& _fileName );
 
@@ -112,6 +114,8 @@ public:
 	bool InitDisk( IDiskImageInterface* _disk );
 
 	IFileSystemInterface* NewFileSystem();
+
+	int Probe( const IDiskImageInterface* _disk ) const;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
     uint8_t  GetDiskType();
@@ -131,6 +135,7 @@ private:
 
     IDiskImageInterface* mDisk = nullptr;
     std::vector<SDOS68_FileInfoBlock> mDirectory;
+    CFileNameIndex mNameIndex; // File name to position in mDirectory
     CDirectoryEntryWrapper mDummyDirEntryWrapper;
 
     uint8_t mDiskType = 0;
@@ -58,20 +58,125 @@
 #define _stricmp strcasecmp
 #endif
 
-uint8_t count_ones (uint8_t byte)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Number of set bits in a 64 bit bitmap word
+static inline unsigned int CountOnes( uint64_t _value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned int)__builtin_popcountll( _value );
+#else
+	_value = _value - ((_value >> 1) & 0x5555555555555555ULL);
+	_value = (_value & 0x3333333333333333ULL) + ((_value >> 2) & 0x3333333333333333ULL);
+	_value = (_value + (_value >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	return (unsigned int)((_value * 0x0101010101010101ULL) >> 56);
+#endif
+}
+
+// Position of the lowest set bit in a 64 bit bitmap word, which can't be 0
+static inline unsigned int CountTrailingZeros( uint64_t _value )
+{
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned int)__builtin_ctzll( _value );
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+	unsigned long index = 0;
+	_BitScanForward64( &index, _value );
+	return (unsigned int)index;
+#else
+	unsigned int retVal = 0;
+	while( 0 == (_value & 1) )
+	{
+		_value >>= 1;
+		++retVal;
+	}
+	return retVal;
+#endif
+}
+
+// Run of free sectors on the sector bitmap
+struct SDGNDosFreeRun
+{
+	size_t firstLSN;
+	size_t sectorsNum;
+};
+
+// Lists the runs of free sectors in a bitmap read by CDragonDOS_FS::ReadBitmap, in LSN order.
+// Whole words are skipped at a time, so the cost depends on the number of words and runs
+// rather than on the number of sectors.
+static void FindFreeRuns( const std::vector<uint64_t>& _bitmap, std::vector<SDGNDosFreeRun>& _runs )
+{
+	_runs.clear();
+
+	size_t lsnNum = _bitmap.size() * 64;
+	size_t lsn = 0;
+
+	while( lsn < lsnNum )
+	{
+		// Find the start of the next run
+		uint64_t freeBits = _bitmap[lsn / 64] >> (lsn % 64);
+		if( 0 == freeBits )
+		{
+			lsn = (lsn / 64 + 1) * 64;
+			continue;
+		}
+		lsn += CountTrailingZeros( freeBits );
+
+		// And its end. Bits past the end of the disk are always clear, so every run ends within the bitmap.
+		size_t firstLSN = lsn;
+		while( lsn < lsnNum )
+		{
+			uint64_t usedBits = ~_bitmap[lsn / 64] >> (lsn % 64);
+			if( 0 == usedBits )
+			{
+				lsn = (lsn / 64 + 1) * 64;
+				continue;
+			}
+			lsn += CountTrailingZeros( usedBits );
+			break;
+		}
+
+		_runs.push_back( { firstLSN, lsn - firstLSN } );
+	}
+}
+
+// Number of directory entries needed to hold _fabsNum FABs
+static size_t GetDirEntriesNeeded( size_t _fabsNum )
 {
-	static const uint8_t NIBBLE_LOOKUP [16] =
+	if( _fabsNum <= DRAGONDOS_HEADER_FABS )
 	{
-		0, 1, 1, 2, 1, 2, 2, 3, 
-		1, 2, 2, 3, 2, 3, 3, 4
-	};
+		return 1;
+	}
 
-	return NIBBLE_LOOKUP[byte & 0x0F] + NIBBLE_LOOKUP[byte >> 4];
+	return 1 + (_fabsNum - DRAGONDOS_HEADER_FABS + DRAGONDOS_CONTINUATION_FABS - 1) / DRAGONDOS_CONTINUATION_FABS;
 }
 
-// Get file data
+// Stores as many of a file's FABs as fit into a header or continuation entry, starting at _fabIdx.
+static void SetDirEntryFABs( unsigned char* _entryPtr, bool _header, const std::vector<SDGNDosFAB>& _fabs, size_t& _fabIdx )
+{
+	size_t         fabsNum = _header ? DRAGONDOS_HEADER_FABS : DRAGONDOS_CONTINUATION_FABS;
+	unsigned char* fabPtr  = _entryPtr + (_header ? 0x0C : 0x01);
+
+	for( size_t fab = 0; fab < fabsNum && _fabIdx < _fabs.size(); ++fab, ++_fabIdx )
+	{
+		fabPtr[0] = (unsigned char)(_fabs[_fabIdx].LSN >> 8);
+		fabPtr[1] = (unsigned char)(_fabs[_fabIdx].LSN & 0xFF);
+		fabPtr[2] = _fabs[_fabIdx].numSectors;
+		fabPtr += 3;
+	}
+}
+
+// Get file data, reading it from the disk on first access
 void CDGNDosFile::GetFileData( std::vector<unsigned char>& dst ) const
 {
+	if( !dataLoaded && nullptr != owner )
+	{
+		data.clear();
+		owner->ExtractEntry( dirEntry, data, true );
+		dataLoaded = true;
+	}
+
 	dst.clear();
 	dst.insert( dst.begin(), data.begin(), data.end() );
 }
@@ -81,6 +186,7 @@ void CDGNDosFile::SetFileData( const std::vector<unsigned char>& src )
 {
 	data.clear();
 	data.insert( data.begin(), src.begin(), src.end() );
+	dataLoaded = true;
 }
 
 // Set file data
@@ -88,6 +194,17 @@ void CDGNDosFile::SetFileData( const unsigned char* src, size_t size )
 {
 	data.clear();
 	data.insert( data.begin(), src, src + size );
+	dataLoaded = true;
+}
+
+// Set where to read the file data from when it's requested
+void CDGNDosFile::SetFileSource( const CDragonDOS_FS* _owner, unsigned short int _dirEntry, size_t _fileSize )
+{
+	owner      = _owner;
+	dirEntry   = _dirEntry;
+	fileSize   = _fileSize;
+	dataLoaded = false;
+	data.clear();
 }
 
 // Constructor
@@ -110,22 +227,26 @@ CDragonDOS_FS::~CDragonDOS_FS()
 bool CDragonDOS_FS::SetDisk( IDiskImageInterface* _disk )
 {
 	disk = _disk;
+	geometry.SetDisk( _disk );
 
 	if( DRAGONDOS_SECTORSPERTRACK != disk->GetSectorsNum() )
 	{
 		disk = NULL;
+		geometry.SetDisk( NULL );
 		return false;
 	}
 
 	if( false == ParseDirectory() )
 	{
 		disk = NULL;
+		geometry.SetDisk( NULL );
 		return false;
 	}
 
 	if( false == ParseFiles() )
 	{
 		disk = NULL;
+		geometry.SetDisk( NULL );
 		return false;
 	}
 
@@ -135,43 +256,34 @@ bool CDragonDOS_FS::SetDisk( IDiskImageInterface* _disk )
 // Returns a file's index based on its name
 unsigned short int CDragonDOS_FS::GetFileIdx( std::string _fileName ) const
 {
-	unsigned short int retVal = DRAGONDOS_INVALID;
-
-	unsigned short int fileIdx = 0;
-	while( retVal == DRAGONDOS_INVALID && fileIdx < files.size() )
-	{
-		if( 0 == _stricmp(_fileName.c_str(),files[fileIdx].GetFileName().c_str()) )
-		{
-			retVal = fileIdx;
-		}
-
-		++fileIdx;
-	}
+	size_t fileIdx = fileIndex.Find( _fileName );
 
-	return retVal;
+	return (fileIdx == CFileNameIndex::npos) ? DRAGONDOS_INVALID : (unsigned short int)fileIdx;
 }
 
 // Returns a file's first directory entry based on its name
 unsigned short int CDragonDOS_FS::GetFileEntry( std::string _fileName ) const
 {
-	unsigned short int retVal = DRAGONDOS_INVALID;
+	unsigned short int fileIdx = GetFileIdx( _fileName );
 
-	unsigned short int fileIdx = 0;
-	while( retVal == DRAGONDOS_INVALID && fileIdx < directory.size() )
-	{
-		if( 0 == _stricmp(_fileName.c_str(),directory[fileIdx].fileBlock.fileName.c_str()) )
-		{
-			retVal = fileIdx;
-		}
+	return (fileIdx == DRAGONDOS_INVALID) ? DRAGONDOS_INVALID : files[fileIdx].GetDirEntry();
+}
 
-		++fileIdx;
+// Extracts file from the DragonDOS file system to a specified location
+bool CDragonDOS_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned char>& _dst, bool _withBinaryHeader ) const
+{
+	unsigned short int fileIdx = GetFileEntry( _fileName );
+
+	if( fileIdx == DRAGONDOS_INVALID )
+	{
+		return false;
 	}
 
-	return retVal;
+	return ExtractEntry( fileIdx, _dst, _withBinaryHeader );
 }
 
-// Extracts file from the DragonDOS file system to a specified location
-bool CDragonDOS_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned char>& _dst, bool _withBinaryHeader ) const
+// Describes the file data without copying it
+bool CDragonDOS_FS::ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const
 {
 	unsigned short int fileIdx = GetFileEntry( _fileName );
 
@@ -180,7 +292,40 @@ bool CDragonDOS_FS::ExtractFile( const std::string& _fileName, std::vector<unsig
 		return false;
 	}
 
-	SDGNDosDirectoryEntry entry = directory[fileIdx];
+	_buffer.clear();
+	return GetEntrySegments( fileIdx, _segments, _withBinaryHeader );
+}
+
+// Extracts the file starting at the specified directory entry
+bool CDragonDOS_FS::ExtractEntry( unsigned short int _entry, std::vector<unsigned char>& _dst, bool _withBinaryHeader ) const
+{
+	std::vector<SFileSegment> segments;
+	if( !GetEntrySegments( _entry, segments, _withBinaryHeader ) )
+	{
+		return false;
+	}
+
+	_dst.reserve( _dst.size() + GetSegmentsSize( segments ) );
+	for( const SFileSegment& segment : segments )
+	{
+		_dst.insert( _dst.end(), segment.data, segment.data + segment.size );
+	}
+
+	return true;
+}
+
+// Lists where the data of the file starting at the specified directory entry lies on the disk.
+// Header skipping and last sector trimming are applied to the segments.
+bool CDragonDOS_FS::GetEntrySegments( unsigned short int _entry, std::vector<SFileSegment>& _segments, bool _withBinaryHeader ) const
+{
+	_segments.clear();
+
+	if( nullptr == disk || _entry >= directory.size() )
+	{
+		return false;
+	}
+
+	SDGNDosDirectoryEntry entry = directory[_entry];
 
 	// Skip file types BIN and BAS' header.
 	bool skipHeader = false;
@@ -191,45 +336,54 @@ bool CDragonDOS_FS::ExtractFile( const std::string& _fileName, std::vector<unsig
 		default:skipHeader = false; break;
 	}
 
+	std::vector<SSectorSpan> spans;
+
 	bool finished = false;
 	while( !finished )
 	{
 		size_t fabNum = entry.fileBlock.FABs.size();
 		for( size_t fab = 0; fab < fabNum; ++fab )
 		{
-			unsigned short int LSN = entry.fileBlock.FABs[fab].LSN;
 			unsigned short int sectorsNum = entry.fileBlock.FABs[fab].numSectors;
+			if( 0 == sectorsNum )
+			{
+				continue;
+			}
 
-			for( unsigned short int sector = 0; sector < sectorsNum; ++sector )
+			// Consecutive sectors of the FAB usually come back as a single span.
+			if( !geometry.GetSpans( entry.fileBlock.FABs[fab].LSN, sectorsNum, spans ) )
 			{
-				unsigned short int tmpLSN = LSN+sector;
+				_segments.clear();
+				return false;
+			}
 
-				const unsigned char* data = disk->GetSector(LSNTrack(*disk,tmpLSN),LSNHead(*disk,tmpLSN),LSNSector(*disk,tmpLSN));
+			size_t begin = 0;
+			size_t end   = sectorsNum * DRAGONDOS_SECTOR_SIZE;
 
-				if( skipHeader )
-				{
-					if( sectorsNum == 1 )
-					{
-						_dst.insert( _dst.end(), data + DRAGONDOS_FILEHEADER_SIZE, data + entry.lastSectorSize );
-					}
-					else
-					{
-						_dst.insert( _dst.end(), data + DRAGONDOS_FILEHEADER_SIZE, data + DRAGONDOS_SECTOR_SIZE );
-					}
-					skipHeader = false; // Only need to skip header once.
-				}
-				else if( !entry.bContinued && fab == fabNum - 1 && sector == sectorsNum - 1) // extract the right number of bytes from last sector
-				{
-					_dst.insert( _dst.end(), data, data + entry.lastSectorSize );
-				}
-				else
+			if( skipHeader )
+			{
+				begin = DRAGONDOS_FILEHEADER_SIZE;
+				skipHeader = false; // Only need to skip header once.
+
+				if( sectorsNum == 1 )
 				{
-					_dst.insert( _dst.end(), data, data + DRAGONDOS_SECTOR_SIZE );
+					end = entry.lastSectorSize;
 				}
-			}      
+			}
+
+			// extract the right number of bytes from last sector
+			if( !entry.bContinued && fab == fabNum - 1 )
+			{
+				end = ((sectorsNum - 1) * DRAGONDOS_SECTOR_SIZE) + entry.lastSectorSize;
+			}
+
+			if( end > begin )
+			{
+				AppendSpanSegments( spans, begin, end, _segments );
+			}
 		}
 
-		if( entry.bContinued )
+		if( entry.bContinued && entry.nextBlock < directory.size() )
 		{
 			entry = directory[entry.nextBlock];
 		}
@@ -242,149 +396,168 @@ bool CDragonDOS_FS::ExtractFile( const std::string& _fileName, std::vector<unsig
 	return true;
 }
 
-// Inserts a file into the DragonDOS file system
-bool CDragonDOS_FS::InsertFile( const std::string& _fileName, const std::vector<unsigned char>& _data, bool _binaryFile )
+// Returns the number of bytes ExtractEntry would produce, walking
+// the FAB chain without reading any sector.
+size_t CDragonDOS_FS::GetEntryDataSize( unsigned short int _entry, bool _withBinaryHeader ) const
 {
-	// TODO: Maybe should add the type to the parameters and add the header data here...
-	if( nullptr == disk || _fileName.empty() || _data.size() > DRAGONDOS_MAX_FILE_SIZE )
+	if( _entry >= directory.size() )
 	{
-		return false;
+		return 0;
 	}
 
-	size_t freeSize = GetFreeSize();
+	const SDGNDosDirectoryEntry* entry = &directory[_entry];
 
-	// Check file size
-	if( _data.size() > freeSize )
+	bool skipHeader = false;
+	switch( entry->fileType )
 	{
-		return false;
+		case DRAGONDOS_FILETYPE_BASIC :skipHeader = true; break;
+		case DRAGONDOS_FILETYPE_BINARY:skipHeader = !_withBinaryHeader; break;
+		default:skipHeader = false; break;
 	}
 
-	// Look for a deleted or unused directory entry
-	unsigned char* entryPtr = nullptr;
-
-	for( unsigned int sectorIdx = DRAGONDOS_DIR_START_SECTOR; sectorIdx < DRAGONDOS_SECTORSPERTRACK; ++sectorIdx )
+	size_t retVal = 0;
+	bool finished = false;
+	while( !finished )
 	{
-		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, sectorIdx );
-		if( nullptr == sector )
+		size_t fabNum = entry->fileBlock.FABs.size();
+		for( size_t fab = 0; fab < fabNum; ++fab )
 		{
-			return false;
-		}
+			size_t sectorsNum = entry->fileBlock.FABs[fab].numSectors;
+			if( 0 == sectorsNum )
+			{
+				continue;
+			}
 
-		for( unsigned int entry = 0; entry < DRAGONDOS_DIR_ENTRIES_PER_SECT; ++entry )
-		{
-			entryPtr = sector + (entry * DRAGONDOS_DIR_ENTRY_SIZE);
+			size_t lastSectorBytes = DRAGONDOS_SECTOR_SIZE;
+			if( !entry->bContinued && fab == fabNum - 1 )
+			{
+				lastSectorBytes = entry->lastSectorSize;
+			}
+
+			if( skipHeader )
+			{
+				// Same rules as ExtractEntry: the header sector is trimmed to
+				// lastSectorSize only when its FAB has a single sector.
+				size_t headerSectorBytes = (sectorsNum == 1) ? entry->lastSectorSize : DRAGONDOS_SECTOR_SIZE;
+				if( headerSectorBytes > DRAGONDOS_FILEHEADER_SIZE )
+				{
+					retVal += headerSectorBytes - DRAGONDOS_FILEHEADER_SIZE;
+				}
+				skipHeader = false;
 
-			if( 0 != (*entryPtr & DRAGONDOS_FLAG_DELETED) ) // Usable Entry found
+				if( sectorsNum > 1 )
+				{
+					retVal += (sectorsNum - 2) * DRAGONDOS_SECTOR_SIZE + lastSectorBytes;
+				}
+			}
+			else
 			{
-				entry = DRAGONDOS_DIR_ENTRIES_PER_SECT;
-				sectorIdx = DRAGONDOS_SECTORSPERTRACK;
+				retVal += (sectorsNum - 1) * DRAGONDOS_SECTOR_SIZE + lastSectorBytes;
 			}
 		}
+
+		if( entry->bContinued && entry->nextBlock < directory.size() )
+		{
+			entry = &directory[entry->nextBlock];
+		}
+		else
+		{
+			finished = true;
+		}
 	}
 
-	*entryPtr = 0; // Clear all flags
+	return retVal;
+}
 
-	// Set name and extension
-	std::string fileNameUpper = _fileName;
-	transform( fileNameUpper.begin(), fileNameUpper.end(), fileNameUpper.begin(), ::toupper );
-	std::filesystem::path filePath( fileNameUpper );
+// Inserts a file into the DragonDOS file system
+bool CDragonDOS_FS::InsertFile( const std::string& _fileName, const std::vector<unsigned char>& _data, bool _binaryFile )
+{
+	// TODO: Maybe should add the type to the parameters and add the header data here...
+	std::vector<SDGNDosNewFile> files( 1 );
+	files[0].fileName = _fileName;
+	files[0].data     = _data;
 
-	std::string name = filePath.stem().string();
-	std::string extension = filePath.extension().string();
-	if( name.length() > DRAGONDOS_MAX_FILE_NAME_LEN ) // TODO:Create a sanitize name and ext functions and add padding
+	return InsertFiles( files );
+}
+
+// Inserts several files into the DragonDOS file system in one pass.
+// Sectors and directory entries for all of them are planned before writing anything,
+// so the disk is left untouched if any of the files doesn't fit. The bitmap is written,
+// and the directory track backed up, once for the whole batch.
+bool CDragonDOS_FS::InsertFiles( const std::vector<SDGNDosNewFile>& _files )
+{
+	if( nullptr == disk )
 	{
-		name = name.substr( 0, DRAGONDOS_MAX_FILE_NAME_LEN );
+		return false;
 	}
-	if( extension[0] == '.' )
+
+	for( const SDGNDosNewFile& file : _files )
 	{
-		extension = extension.substr(1);
+		if( file.fileName.empty() || file.data.size() > DRAGONDOS_MAX_FILE_SIZE )
+		{
+			return false;
+		}
 	}
-	if( extension.length() > DRAGONDOS_MAX_FILE_EXT_LEN )
+
+	std::vector<uint64_t> bitmap;
+	if( 0 == ReadBitmap( bitmap ) )
 	{
-		extension = extension.substr( 0, DRAGONDOS_MAX_FILE_EXT_LEN );
+		return false;
 	}
 
-	memset( entryPtr + 1, 0                , DRAGONDOS_MAX_FILE_NAME_LEN );
-	memcpy( entryPtr + 1, name.c_str()     , name.length()               );
-	memset( entryPtr + 9, 0                , DRAGONDOS_MAX_FILE_EXT_LEN  );
-	memcpy( entryPtr + 9, extension.c_str(), extension.length()          );
-
-	// Allocate sectors;
-	size_t maxSectorNumPerSide = disk->GetTracksNum() * DRAGONDOS_SECTORSPERTRACK;
-	unsigned short int sectorsNeeded = (unsigned short int)(_data.size()/DRAGONDOS_SECTOR_SIZE);
-	sectorsNeeded += (_data.size()%DRAGONDOS_SECTOR_SIZE) ? 1 : 0;
-	size_t bitmapSectorNum = (disk->GetTracksNum() > 40 && disk->GetSidesNum() > 1) ? 2 : 1;
-	std::vector<size_t> freeLSNs;
-
-	size_t bitmapBytesNeeded = (sectorsNeeded / 8) + ((sectorsNeeded % 8) != 0 ? 1 : 0);
-	bool bFound = false;
-	size_t firstBitmapByte = 0;
-	size_t bitmapSector = 0;
-	unsigned char* bitmapSectorPtr = nullptr;
-	for( size_t bmpSec = 0; ((bmpSec < bitmapSectorNum) && !bFound); bmpSec++ )
+	// Allocate the biggest files first, so they get the largest free runs.
+	std::vector<size_t> allocationOrder( _files.size() );
+	for( size_t fileIdx = 0; fileIdx < _files.size(); ++fileIdx )
 	{
-		bitmapSectorPtr = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, (unsigned int)bmpSec );
+		allocationOrder[fileIdx] = fileIdx;
+	}
+	std::stable_sort( allocationOrder.begin(), allocationOrder.end(), [&_files]( size_t _a, size_t _b ) { return _files[_a].data.size() > _files[_b].data.size(); } );
 
-		for( size_t bitmapByte = 0; ((bitmapByte < DRAGONDOS_BITMAPSIZE - bitmapBytesNeeded) && !bFound); ++bitmapByte )
+	std::vector< std::vector<SDGNDosFAB> > fabs( _files.size() );
+	for( size_t fileIdx : allocationOrder )
+	{
+		size_t sectorsNeeded = (_files[fileIdx].data.size() + DRAGONDOS_SECTOR_SIZE - 1) / DRAGONDOS_SECTOR_SIZE;
+		if( !AllocateSectors( bitmap, sectorsNeeded, fabs[fileIdx] ) )
 		{
-			bFound = true;
-			for( size_t curByte = 0; curByte < bitmapBytesNeeded; ++curByte )
-			{
-				if( bitmapSectorPtr[bitmapByte + curByte] != 0xFF )
-				{
-					bFound = false;
-				}
-			}
-
-			if( bFound )
-			{
-				firstBitmapByte = bitmapByte;
-				bitmapSector = bmpSec;
-				break;
-			}
+			return false;
 		}
 	}
 
-	if( !bFound )
+	size_t entriesNeeded = 0;
+	for( const std::vector<SDGNDosFAB>& fileFABs : fabs )
 	{
-		return false;
+		entriesNeeded += GetDirEntriesNeeded( fileFABs.size() );
 	}
 
-	size_t startLSN = ((bitmapSector * DRAGONDOS_BITMAPSIZE) + firstBitmapByte) * 8;
-	size_t endLSN = startLSN + sectorsNeeded;
-	unsigned short int fabLSN = (unsigned short int)startLSN;
-	const unsigned char* data = _data.data();
-	size_t dataSize = _data.size();
-
-	unsigned char* dstSector = nullptr;
-	for( ; startLSN < endLSN; ++startLSN )
+	std::vector<unsigned int> entries;
+	if( !FindFreeEntries( entriesNeeded, entries ) )
 	{
-		dstSector = disk->GetSector( LSNTrack(*disk,(unsigned short int)startLSN),  LSNHead(*disk,(unsigned short int)startLSN), LSNSector(*disk,(unsigned short int)startLSN) );
-		MarkBitmapLSNUsed( disk, startLSN );
+		return false;
+	}
 
-		memcpy( dstSector, data, std::min( (size_t)DRAGONDOS_SECTOR_SIZE, dataSize) );
-		data += DRAGONDOS_SECTOR_SIZE;
+	// Directory entries are handed out in the order the files were given, which is the order they'll be listed in.
+	size_t firstEntry = 0;
+	for( size_t fileIdx = 0; fileIdx < _files.size(); ++fileIdx )
+	{
+		size_t fileEntriesNum = GetDirEntriesNeeded( fabs[fileIdx].size() );
+		std::vector<unsigned int> fileEntries( entries.begin() + firstEntry, entries.begin() + firstEntry + fileEntriesNum );
+		firstEntry += fileEntriesNum;
 
-		if( dataSize >= DRAGONDOS_SECTOR_SIZE )
+		if( !WriteFileData( fabs[fileIdx], _files[fileIdx].data ) || !WriteFileEntries( fileEntries, _files[fileIdx].fileName, fabs[fileIdx], _files[fileIdx].data.size() ) )
 		{
-			dataSize -= DRAGONDOS_SECTOR_SIZE;
-		}
-		else // needed?
-		{
-			break;
+			return false;
 		}
 	}
 
-	// Set flags and sector data
-	entryPtr[0x00] = 0;
-	entryPtr[0x0C] = (fabLSN >> 8);
-	entryPtr[0x0D] = (fabLSN & 0xFF);
-	entryPtr[0x0E] = (sectorsNeeded & 0xFF);
-	entryPtr[0x18] = (unsigned char)(_data.size() % DRAGONDOS_SECTOR_SIZE);
+	if( !WriteBitmap( bitmap ) )
+	{
+		return false;
+	}
 
 	BackUpDirTrack( disk );
 
-	return true;
+	// Keep the directory, the file list and the name index in step with the disk.
+	return ParseDirectory() && ParseFiles();
 }
 
 // Deletes a file from the DragonDOS file system
@@ -398,59 +571,57 @@ bool CDragonDOS_FS::DeleteFile( const std::string& _fileName )
 	}
 
 	// Go through all File Allocation Blocks (FABs) belonging
-	// to this file mark them as deleted/free and mark the 
-	// associated sectors as free on the bitmap.
-	unsigned int entrySector = directory[entry].sector;
-	unsigned int entryIndex  = directory[entry].entry;
-
-	// On directory table, entry's flag is set to 0x81. Deleted/free + continuation.
-	// On the bitmap, sectors belongimg to this files have their bits set (1).
-	unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, entrySector );
-	if( nullptr == sector )
+	// to this file, following its continuation entries, mark
+	// the entries as deleted/free and mark the associated
+	// sectors as free on the bitmap.
+	std::vector<uint64_t> bitmap;
+	if( 0 == ReadBitmap( bitmap ) )
 	{
 		return false;
 	}
 
-	sector[entryIndex * DRAGONDOS_DIR_ENTRY_SIZE] = (DRAGONDOS_FLAG_DELETED | DRAGONDOS_FLAG_CONTINUATION);
+	size_t lsnNum = bitmap.size() * 64;
+	size_t entriesNum = 0;
+	unsigned short int curEntry = entry;
 
-	// Track 20, sector 1. Sector bitmap and disk geometry.
-	sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, 0 );
-	if( nullptr == sector )
+	while( curEntry < directory.size() && entriesNum++ < DRAGONDOS_DIR_MAX_ENTRIES )
 	{
-		return false;
-	}
+		const SDGNDosDirectoryEntry& dirEntry = directory[curEntry];
 
-	unsigned short int bitmapPos = 0;
-	unsigned short int bytePos = 0;
-	unsigned short int lsn = 0;
-	
-	for( auto fab : directory[entry].fileBlock.FABs )
-	{
-		// Check for LSNs 0x5a0 - 0xb3f (80 Track, DS only), which are in sector 1
-		lsn = fab.LSN;
-		if( lsn > DRAGONDOS_SECTORSPERBITMAPSECTOR )
+		// On directory table, entry's flag is set to 0x81. Deleted/free + continuation.
+		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, dirEntry.sector );
+		if( nullptr == sector )
 		{
-			lsn -= DRAGONDOS_SECTORSPERBITMAPSECTOR;
-			sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, 1 );
+			return false;
 		}
-		else
+
+		sector[dirEntry.entry * DRAGONDOS_DIR_ENTRY_SIZE] = (DRAGONDOS_FLAG_DELETED | DRAGONDOS_FLAG_CONTINUATION);
+
+		// On the bitmap, sectors belonging to this file have their bits set (1).
+		for( const SDGNDosFAB& fab : dirEntry.fileBlock.FABs )
 		{
-			sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, 0 );
+			for( size_t lsn = fab.LSN; lsn < (size_t)fab.LSN + fab.numSectors && lsn < lsnNum; ++lsn )
+			{
+				bitmap[lsn / 64] |= (uint64_t)1 << (lsn % 64);
+			}
 		}
 
-		// Mark sectors as free
-		for( size_t contSector = 0; contSector < fab.numSectors; ++contSector )
+		if( !dirEntry.bContinued )
 		{
-			bitmapPos = (unsigned short int)((lsn + contSector) / 8);
-			bytePos   = (lsn + contSector) % 8;
-
-			sector[bitmapPos] |= (1 << bytePos);
+			break;
 		}
+		curEntry = dirEntry.nextBlock;
+	}
+
+	if( !WriteBitmap( bitmap ) )
+	{
+		return false;
 	}
 
 	BackUpDirTrack( disk );
 
-	return true;
+	// Keep the directory, the file list and the name index in step with the disk.
+	return ParseDirectory() && ParseFiles();
 }
 
 // Analyzes the disk image and decodes the DragonDOS directory information.
@@ -466,7 +637,11 @@ bool CDragonDOS_FS::ParseDirectory()
 	rootDir.SetIsDirectory( true );
 	rootDir.SetName( GetVolumeLabel() );
 
-	const unsigned char* sector = disk->GetSector(DRAGONDOS_DIR_TRACK,0,0);
+	// Read only through the const interfaces, so parsing doesn't mark the image as modified.
+	const IDiskImageInterface* constDisk = disk;
+	const CDiskGeometry& constGeometry = geometry;
+
+	const unsigned char* sector = constDisk->GetSector(DRAGONDOS_DIR_TRACK,0,0);
 	if( !sector )
 	{
 		return false;
@@ -495,7 +670,11 @@ bool CDragonDOS_FS::ParseDirectory()
 
 	while( !bEndOfDir && dirSector < DRAGONDOS_SECTORSPERTRACK )
 	{
-		sector = disk->GetSector(DRAGONDOS_DIR_TRACK,0,dirSector);
+		sector = constDisk->GetSector(DRAGONDOS_DIR_TRACK,0,dirSector);
+		if( !sector )
+		{
+			return false;
+		}
 
 		// 10 directory entries per sector
 		unsigned int entry = 0;
@@ -581,12 +760,12 @@ bool CDragonDOS_FS::ParseDirectory()
 					const SDGNDosFAB& fab = dirEntry.fileBlock.FABs[0];
 					if( fab.numSectors != 0 ) // check for empty file
 					{
-						const unsigned char* fileInfoSec = disk->GetSector(LSNTrack(*disk,fab.LSN),LSNHead(*disk,fab.LSN),LSNSector(*disk,fab.LSN));
+						const unsigned char* fileInfoSec = constGeometry.GetSector( fab.LSN );
 						unsigned short int firstByte  = 0;
 						unsigned short int secondByte = 0;
 
 						// Standard BAS or BIN file
-						if( fileInfoSec[0x0] == 0x55 || fileInfoSec[0x08] == 0xAA )
+						if( nullptr != fileInfoSec && (fileInfoSec[0x0] == 0x55 || fileInfoSec[0x08] == 0xAA) )
 						{
 							// File Type
 							dirEntry.fileType = fileInfoSec[0x01];
@@ -658,28 +837,29 @@ bool CDragonDOS_FS::ParseDirectory()
 	return true;
 }
 
-// Analyzes the disk image directory and extract files
+// Analyzes the disk image directory and builds the file list.
+// File data is not read here, see CDGNDosFile::GetFileData.
 bool CDragonDOS_FS::ParseFiles()
 {
 	files.clear();
+	fileIndex.Clear();
 
-	std::vector<SDGNDosDirectoryEntry>::const_iterator entryIter;
-	for( entryIter = directory.begin(); entryIter != directory.end(); ++entryIter )
+	for( size_t entryIdx = 0; entryIdx < directory.size(); ++entryIdx )
 	{
-		if( !entryIter->bDeleted && !entryIter->bContinuation )
+		const SDGNDosDirectoryEntry& entry = directory[entryIdx];
+
+		if( !entry.bDeleted && !entry.bContinuation )
 		{
 			CDGNDosFile file;
-			std::vector<unsigned char> fileData;
 
-			ExtractFile( entryIter->fileBlock.fileName, fileData, true );
-
-			file.SetFileName      ( entryIter->fileBlock.fileName );
-			file.SetFileData      ( fileData                      );
-			file.SetFileProtected ( entryIter->bProtected         );
-			file.SetFileType      ( entryIter->fileType           );
-			file.SetLoadAddress   ( entryIter->loadAddress        );
-			file.SetExecAddress   ( entryIter->execAddress        );
+			file.SetFileName      ( entry.fileBlock.fileName );
+			file.SetFileSource    ( this, (unsigned short int)entryIdx, GetEntryDataSize( (unsigned short int)entryIdx, true ) );
+			file.SetFileProtected ( entry.bProtected         );
+			file.SetFileType      ( entry.fileType           );
+			file.SetLoadAddress   ( entry.loadAddress        );
+			file.SetExecAddress   ( entry.execAddress        );
 
+			fileIndex.Add( entry.fileBlock.fileName, files.size() );
 			files.push_back(file);
 		}
 	}
@@ -736,21 +916,16 @@ size_t CDragonDOS_FS::GetFreeSize() const
 		return 0;
 	}
 	
-	size_t retVal = 0;
+	std::vector<uint64_t> bitmap;
 	size_t freeSectors = 0;
 
-	for( size_t side = 0; side < disk->GetSidesNum(); ++side )
+	ReadBitmap( bitmap );
+	for( uint64_t word : bitmap )
 	{
-		unsigned char* pSector = disk->GetSector(DRAGONDOS_DIR_TRACK, 0, (unsigned int)side);
-		for( int byte=0; byte < 0xB4; ++byte )
-		{
-			freeSectors += count_ones( pSector[byte] );
-		}
+		freeSectors += CountOnes( word );
 	}
 
-	retVal = freeSectors * DRAGONDOS_SECTOR_SIZE;
-
-	return retVal;
+	return freeSectors * DRAGONDOS_SECTOR_SIZE;
 }
 
 std::string CDragonDOS_FS::GetFSName() const
@@ -814,7 +989,8 @@ bool CDragonDOS_FS::InitDisk( IDiskImageInterface* _disk )
 
 	// Mark tracks 16 and 20 as in use. Track 16 is used as a temporary storage for file system 
 	// changes which are then copied over to track 20.
-	unsigned short int lsn = 0;
+	CDiskGeometry newGeometry( _disk );
+	uint32_t lsn = 0;
 	unsigned short int bitmapPos = 0;
 	unsigned short int bytePos = 0;
 
@@ -822,7 +998,7 @@ bool CDragonDOS_FS::InitDisk( IDiskImageInterface* _disk )
 	{
 		for( unsigned short int sectorNum = 0; sectorNum < DRAGONDOS_SECTORSPERTRACK; ++sectorNum )
 		{
-			lsn = LSN( *_disk, trackNum, 0, sectorNum );
+			lsn = newGeometry.LSN( trackNum, 0, sectorNum );
 
 			MarkBitmapLSNUsed( _disk, lsn );
 		}
@@ -896,61 +1072,797 @@ bool CDragonDOS_FS::BackUpDirTrack( IDiskImageInterface* _disk )
 		return false;
 	}
 
+	// Only the backup track is written to, so only it is marked as modified.
+	const IDiskImageInterface* constDisk = _disk;
 	for( size_t sectorNum = 0; sectorNum < DRAGONDOS_SECTORSPERTRACK; ++sectorNum )
 	{
-		memcpy( _disk->GetSector(DRAGONDOS_TEMP_DIR_TRACK,0,(unsigned int)sectorNum), _disk->GetSector(DRAGONDOS_DIR_TRACK,0,(unsigned int)sectorNum), DRAGONDOS_SECTOR_SIZE );
+		memcpy( _disk->GetSector(DRAGONDOS_TEMP_DIR_TRACK,0,(unsigned int)sectorNum), constDisk->GetSector(DRAGONDOS_DIR_TRACK,0,(unsigned int)sectorNum), DRAGONDOS_SECTOR_SIZE );
 	}
 
 	return true;
 }
 
-unsigned char CDragonDOS_FS::GetMaxContiguousFreeSectorsInBitmapByte( unsigned char _bitmapByte )
+// Reads the sector bitmap into 64 bit words, LSN n being bit n%64 of word n/64.
+// The bitmap bytes of track 20 sectors 0 and 1 follow each other in LSN order, so they're
+// just packed together. Bits past the end of the disk are cleared.
+// Returns the number of LSNs covered, or 0 on error.
+size_t CDragonDOS_FS::ReadBitmap( std::vector<uint64_t>& _bitmap ) const
 {
-	unsigned char byteMask = 0;
-	unsigned char retVal = 0;
-	unsigned char count = 0;
+	_bitmap.clear();
 
-	for( unsigned char bit = 0; bit < 8; ++bit )
+	if( nullptr == disk )
 	{
-		byteMask = (1 << bit);
+		return 0;
+	}
+
+	size_t lsnNum = std::min( (size_t)geometry.GetLSNNum(), (size_t)DRAGONDOS_SECTORSPERBITMAPSECTOR * 2 );
+	_bitmap.assign( (lsnNum + 63) / 64, 0 );
 
-		if( _bitmapByte & byteMask )
+	const IDiskImageInterface* constDisk = disk;
+	for( size_t firstLSN = 0; firstLSN < lsnNum; firstLSN += DRAGONDOS_SECTORSPERBITMAPSECTOR )
+	{
+		const unsigned char* sector = constDisk->GetSector( DRAGONDOS_DIR_TRACK, 0, (unsigned int)(firstLSN / DRAGONDOS_SECTORSPERBITMAPSECTOR) );
+		if( nullptr == sector )
 		{
-			++count;
+			_bitmap.clear();
+			return 0;
 		}
-		else
+
+		size_t bytesNum = std::min( (size_t)DRAGONDOS_BITMAPSIZE, (lsnNum - firstLSN + 7) / 8 );
+		for( size_t byte = 0; byte < bytesNum; ++byte )
 		{
-			if( count > retVal )
-			{
-				retVal = count;
-			}
-			count = 0;
+			size_t lsn = firstLSN + byte * 8;
+			_bitmap[lsn / 64] |= (uint64_t)sector[byte] << (lsn % 64);
 		}
 	}
 
-	if( count > retVal )
+	if( 0 != (lsnNum % 64) )
 	{
-		retVal = count;
+		_bitmap.back() &= ((uint64_t)1 << (lsnNum % 64)) - 1;
 	}
 
-	return retVal;
+	return lsnNum;
 }
 
-bool CDragonDOS_FS::IsBitmapLSNFree( IDiskImageInterface* _disk, size_t _LSN )
+// Writes a bitmap read by ReadBitmap back to the disk.
+bool CDragonDOS_FS::WriteBitmap( const std::vector<uint64_t>& _bitmap )
 {
-	if( nullptr == _disk || _LSN >= (DRAGONDOS_SECTORSPERBITMAPSECTOR * 2) )
+	if( nullptr == disk )
 	{
 		return false;
 	}
 
-	size_t sectorIdx = (_LSN / DRAGONDOS_SECTORSPERBITMAPSECTOR);
-
-	if( _LSN >= DRAGONDOS_SECTORSPERBITMAPSECTOR )
+	size_t lsnNum = std::min( (size_t)geometry.GetLSNNum(), (size_t)DRAGONDOS_SECTORSPERBITMAPSECTOR * 2 );
+	if( _bitmap.size() * 64 < lsnNum )
 	{
-		_LSN -= DRAGONDOS_SECTORSPERBITMAPSECTOR;
+		return false;
+	}
+
+	for( size_t firstLSN = 0; firstLSN < lsnNum; firstLSN += DRAGONDOS_SECTORSPERBITMAPSECTOR )
+	{
+		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, (unsigned int)(firstLSN / DRAGONDOS_SECTORSPERBITMAPSECTOR) );
+		if( nullptr == sector )
+		{
+			return false;
+		}
+
+		size_t bytesNum = std::min( (size_t)DRAGONDOS_BITMAPSIZE, (lsnNum - firstLSN + 7) / 8 );
+		for( size_t byte = 0; byte < bytesNum; ++byte )
+		{
+			size_t lsn = firstLSN + byte * 8;
+			unsigned char value = (unsigned char)(_bitmap[lsn / 64] >> (lsn % 64));
+
+			// Leave alone the bits of a last partial byte that are past the end of the disk.
+			unsigned char mask = (lsnNum - lsn >= 8) ? 0xFF : (unsigned char)((1 << (lsnNum - lsn)) - 1);
+			sector[byte] = (sector[byte] & ~mask) | (value & mask);
+		}
+	}
+
+	return true;
+}
+
+// Picks the sectors for a file of _sectorsNum sectors and marks them as used on _bitmap.
+// Free runs are found at bit level. If one run can hold the whole file, the smallest such run
+// is used (best fit). Otherwise the largest runs are taken whole until the rest fits in one,
+// which keeps the number of FABs, and of continuation entries, as low as possible.
+// Fails only if there aren't enough free sectors.
+bool CDragonDOS_FS::AllocateSectors( std::vector<uint64_t>& _bitmap, size_t _sectorsNum, std::vector<SDGNDosFAB>& _fabs ) const
+{
+	_fabs.clear();
+
+	if( 0 == _sectorsNum )
+	{
+		return true;
+	}
+
+	size_t freeSectors = 0;
+	for( uint64_t word : _bitmap )
+	{
+		freeSectors += CountOnes( word );
+	}
+
+	if( freeSectors < _sectorsNum )
+	{
+		return false;
+	}
+
+	std::vector<SDGNDosFreeRun> runs;
+	FindFreeRuns( _bitmap, runs );
+
+	// Smaller runs first, lower LSNs first among runs of the same size.
+	std::stable_sort( runs.begin(), runs.end(), []( const SDGNDosFreeRun& _a, const SDGNDosFreeRun& _b ) { return _a.sectorsNum < _b.sectorsNum; } );
+
+	std::vector<SDGNDosFreeRun> chosen;
+	size_t sectorsLeft = _sectorsNum;
+
+	while( sectorsLeft > 0 && !runs.empty() )
+	{
+		auto fit = std::lower_bound( runs.begin(), runs.end(), sectorsLeft, []( const SDGNDosFreeRun& _run, size_t _size ) { return _run.sectorsNum < _size; } );
+		if( fit != runs.end() )
+		{
+			chosen.push_back( { fit->firstLSN, sectorsLeft } );
+			sectorsLeft = 0;
+		}
+		else
+		{
+			chosen.push_back( runs.back() );
+			sectorsLeft -= runs.back().sectorsNum;
+			runs.pop_back();
+		}
+	}
+
+	if( sectorsLeft > 0 )
+	{
+		return false;
+	}
+
+	// Lay the file out in LSN order, in FABs of up to 255 sectors.
+	std::sort( chosen.begin(), chosen.end(), []( const SDGNDosFreeRun& _a, const SDGNDosFreeRun& _b ) { return _a.firstLSN < _b.firstLSN; } );
+
+	for( const SDGNDosFreeRun& run : chosen )
+	{
+		for( size_t lsn = run.firstLSN; lsn < run.firstLSN + run.sectorsNum; ++lsn )
+		{
+			_bitmap[lsn / 64] &= ~((uint64_t)1 << (lsn % 64));
+		}
+
+		for( size_t offset = 0; offset < run.sectorsNum; offset += DRAGONDOS_MAX_FAB_SECTORS )
+		{
+			SDGNDosFAB fab;
+			fab.LSN        = (unsigned short int)(run.firstLSN + offset);
+			fab.numSectors = (unsigned char)std::min( (size_t)DRAGONDOS_MAX_FAB_SECTORS, run.sectorsNum - offset );
+			_fabs.push_back( fab );
+		}
+	}
+
+	return true;
+}
+
+// Lists the first _entriesNum directory entries that can be used for a new file, in directory
+// order. Those are deleted entries and every entry from the end of directory mark on.
+bool CDragonDOS_FS::FindFreeEntries( size_t _entriesNum, std::vector<unsigned int>& _entries ) const
+{
+	_entries.clear();
+
+	if( nullptr == disk )
+	{
+		return false;
+	}
+
+	const IDiskImageInterface* constDisk = disk;
+	bool bEndOfDir = false;
+
+	for( unsigned int entryIdx = 0; entryIdx < DRAGONDOS_DIR_MAX_ENTRIES && _entries.size() < _entriesNum; ++entryIdx )
+	{
+		const unsigned char* sector = constDisk->GetSector( DRAGONDOS_DIR_TRACK, 0, DRAGONDOS_DIR_START_SECTOR + (entryIdx / DRAGONDOS_DIR_ENTRIES_PER_SECT) );
+		if( nullptr == sector )
+		{
+			return false;
+		}
+
+		unsigned char flag = sector[(entryIdx % DRAGONDOS_DIR_ENTRIES_PER_SECT) * DRAGONDOS_DIR_ENTRY_SIZE];
+		bEndOfDir = bEndOfDir || (0 != (flag & DRAGONDOS_FLAG_ENDOFDIR));
+
+		if( bEndOfDir || 0 != (flag & DRAGONDOS_FLAG_DELETED) )
+		{
+			_entries.push_back( entryIdx );
+		}
+	}
+
+	return _entries.size() == _entriesNum;
+}
+
+// Copies a file's data into the sectors of its FABs.
+bool CDragonDOS_FS::WriteFileData( const std::vector<SDGNDosFAB>& _fabs, const std::vector<unsigned char>& _data )
+{
+	// Get all the sectors first, so nothing is written if any of them is missing.
+	std::vector<unsigned char*> dstSectors;
+	std::vector<unsigned char*> fabSectors;
+	for( const SDGNDosFAB& fab : _fabs )
+	{
+		if( !geometry.GetSectors( fab.LSN, fab.numSectors, fabSectors ) )
+		{
+			return false;
+		}
+		dstSectors.insert( dstSectors.end(), fabSectors.begin(), fabSectors.end() );
+	}
+
+	if( dstSectors.size() * DRAGONDOS_SECTOR_SIZE < _data.size() )
+	{
+		return false;
+	}
+
+	const unsigned char* data = _data.data();
+	size_t dataSize = _data.size();
+
+	for( unsigned char* dstSector : dstSectors )
+	{
+		size_t copySize = std::min( (size_t)DRAGONDOS_SECTOR_SIZE, dataSize );
+		memcpy( dstSector, data, copySize );
+		data     += copySize;
+		dataSize -= copySize;
+	}
+
+	return true;
+}
+
+// Writes the header entry of a file, plus the continuation entries its FABs need,
+// into the directory entries returned by FindFreeEntries.
+bool CDragonDOS_FS::WriteFileEntries( const std::vector<unsigned int>& _entries, const std::string& _fileName, const std::vector<SDGNDosFAB>& _fabs, size_t _fileSize )
+{
+	if( nullptr == disk || _entries.size() != GetDirEntriesNeeded( _fabs.size() ) )
+	{
+		return false;
+	}
+
+	// Get the entries first, so nothing is written if any of them is missing.
+	std::vector<unsigned char*> entryPtrs;
+	unsigned int lastEntry = 0;
+	bool bEndOfDirUsed = false;
+
+	for( unsigned int entryIdx : _entries )
+	{
+		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, DRAGONDOS_DIR_START_SECTOR + (entryIdx / DRAGONDOS_DIR_ENTRIES_PER_SECT) );
+		if( nullptr == sector || entryIdx >= DRAGONDOS_DIR_MAX_ENTRIES )
+		{
+			return false;
+		}
+
+		entryPtrs.push_back( sector + (entryIdx % DRAGONDOS_DIR_ENTRIES_PER_SECT) * DRAGONDOS_DIR_ENTRY_SIZE );
+		bEndOfDirUsed = bEndOfDirUsed || (0 != (entryPtrs.back()[0] & DRAGONDOS_FLAG_ENDOFDIR));
+		lastEntry = std::max( lastEntry, entryIdx );
+	}
+
+	unsigned char* endOfDirPtr = nullptr;
+	if( bEndOfDirUsed && lastEntry + 1 < DRAGONDOS_DIR_MAX_ENTRIES )
+	{
+		unsigned int endOfDirEntry = lastEntry + 1;
+		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, DRAGONDOS_DIR_START_SECTOR + (endOfDirEntry / DRAGONDOS_DIR_ENTRIES_PER_SECT) );
+		if( nullptr == sector )
+		{
+			return false;
+		}
+		endOfDirPtr = sector + (endOfDirEntry % DRAGONDOS_DIR_ENTRIES_PER_SECT) * DRAGONDOS_DIR_ENTRY_SIZE;
+	}
+
+	// Set name and extension
+	std::string fileNameUpper = _fileName;
+	transform( fileNameUpper.begin(), fileNameUpper.end(), fileNameUpper.begin(), ::toupper );
+	std::filesystem::path filePath( fileNameUpper );
+
+	std::string name = filePath.stem().string();
+	std::string extension = filePath.extension().string();
+	if( name.length() > DRAGONDOS_MAX_FILE_NAME_LEN ) // TODO:Create a sanitize name and ext functions and add padding
+	{
+		name = name.substr( 0, DRAGONDOS_MAX_FILE_NAME_LEN );
+	}
+	if( !extension.empty() && extension[0] == '.' )
+	{
+		extension = extension.substr(1);
+	}
+	if( extension.length() > DRAGONDOS_MAX_FILE_EXT_LEN )
+	{
+		extension = extension.substr( 0, DRAGONDOS_MAX_FILE_EXT_LEN );
+	}
+
+	size_t fabIdx = 0;
+	for( size_t entry = 0; entry < entryPtrs.size(); ++entry )
+	{
+		unsigned char* entryPtr = entryPtrs[entry];
+		bool           bHeader    = (0 == entry);
+		bool           bContinued = (entry + 1 < entryPtrs.size());
+
+		memset( entryPtr, 0, DRAGONDOS_DIR_ENTRY_SIZE );
+
+		// Set flags
+		entryPtr[0x00] = (bHeader ? 0 : DRAGONDOS_FLAG_CONTINUATION) | (bContinued ? DRAGONDOS_FLAG_CONTINUED : 0);
+
+		if( bHeader )
+		{
+			memcpy( entryPtr + 1, name.c_str()     , name.length()      );
+			memcpy( entryPtr + 9, extension.c_str(), extension.length() );
+		}
+
+		// Set sector data
+		SetDirEntryFABs( entryPtr, bHeader, _fabs, fabIdx );
+
+		// Next entry of the file or size of its last sector
+		entryPtr[0x18] = bContinued ? (unsigned char)_entries[entry + 1] : (unsigned char)(_fileSize % DRAGONDOS_SECTOR_SIZE);
+	}
+
+	// Entries past the end of directory mark have been used, so move it after them.
+	if( nullptr != endOfDirPtr )
+	{
+		endOfDirPtr[0] = DRAGONDOS_FLAG_DELETED | DRAGONDOS_FLAG_ENDOFDIR | DRAGONDOS_FLAG_CONTINUATION;
+	}
+
+	return true;
+}
+
+// Gathers the FABs of the file starting at the specified directory entry, following its continuation entries.
+bool CDragonDOS_FS::GetEntryChain( unsigned short int _entry, std::vector<SDGNDosFAB>& _fabs, size_t& _entriesNum, unsigned char& _lastSectorSize ) const
+{
+	_fabs.clear();
+	_entriesNum = 0;
+	_lastSectorSize = 0;
+
+	unsigned short int curEntry = _entry;
+	while( curEntry < directory.size() && _entriesNum < DRAGONDOS_DIR_MAX_ENTRIES )
+	{
+		const SDGNDosDirectoryEntry& dirEntry = directory[curEntry];
+		++_entriesNum;
+
+		_fabs.insert( _fabs.end(), dirEntry.fileBlock.FABs.begin(), dirEntry.fileBlock.FABs.end() );
+
+		if( !dirEntry.bContinued )
+		{
+			_lastSectorSize = (unsigned char)(dirEntry.lastSectorSize & 0xFF);
+			return true;
+		}
+		curEntry = dirEntry.nextBlock;
+	}
+
+	// Broken or circular chain
+	return false;
+}
+
+// Fills in a fragmentation report for files laid out as _fileFABs on a disk with the sector bitmap _bitmap.
+// Continuation entries are left for the caller to count.
+void CDragonDOS_FS::MeasureFragmentation( const std::vector< std::vector<SDGNDosFAB> >& _fileFABs, const std::vector<uint64_t>& _bitmap, SDGNDosFragmentationInfo& _info ) const
+{
+	_info = SDGNDosFragmentationInfo();
+	_info.filesNum = _fileFABs.size();
+
+	size_t dataFilesNum = 0;
+	size_t sectorsNum = 0;
+	double distanceSum = 0.0;
+
+	for( const std::vector<SDGNDosFAB>& fabs : _fileFABs )
+	{
+		size_t extentsNum = 0;
+		size_t nextLSN = 0;
+
+		for( const SDGNDosFAB& fab : fabs )
+		{
+			if( 0 == fab.numSectors )
+			{
+				continue;
+			}
+
+			// FABs that follow on from the previous one are part of the same run
+			if( 0 == extentsNum || fab.LSN != nextLSN )
+			{
+				++extentsNum;
+			}
+			nextLSN = (size_t)fab.LSN + fab.numSectors;
+
+			for( size_t lsn = fab.LSN; lsn < nextLSN; ++lsn )
+			{
+				int track = (int)geometry.LSNTrack( (uint32_t)lsn );
+				distanceSum += (double)std::abs( track - DRAGONDOS_DIR_TRACK );
+			}
+			sectorsNum += fab.numSectors;
+		}
+
+		dataFilesNum             += (extentsNum > 0) ? 1 : 0;
+		_info.fragmentedFilesNum += (extentsNum > 1) ? 1 : 0;
+		_info.extentsNum         += extentsNum;
+	}
+
+	std::vector<SDGNDosFreeRun> runs;
+	FindFreeRuns( _bitmap, runs );
+
+	_info.freeRunsNum = runs.size();
+	for( const SDGNDosFreeRun& run : runs )
+	{
+		_info.freeSectorsNum += run.sectorsNum;
+		_info.largestFreeRun  = std::max( _info.largestFreeRun, run.sectorsNum );
+	}
+
+	// The score is the share of the places where a file could be split that actually are.
+	_info.averageDirDistance = (sectorsNum > 0) ? distanceSum / sectorsNum : 0.0;
+	_info.score = (sectorsNum > dataFilesNum) ? (unsigned int)(((_info.extentsNum - dataFilesNum) * 100) / (sectorsNum - dataFilesNum)) : 0;
+}
+
+bool CDragonDOS_FS::GetFragmentationInfo( SDGNDosFragmentationInfo& _info ) const
+{
+	_info = SDGNDosFragmentationInfo();
+
+	std::vector<uint64_t> bitmap;
+	if( 0 == ReadBitmap( bitmap ) )
+	{
+		return false;
+	}
+
+	std::vector< std::vector<SDGNDosFAB> > fileFABs( files.size() );
+	size_t continuationEntriesNum = 0;
+
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		size_t entriesNum = 0;
+		unsigned char lastSectorSize = 0;
+		if( !GetEntryChain( files[fileIdx].GetDirEntry(), fileFABs[fileIdx], entriesNum, lastSectorSize ) )
+		{
+			return false;
+		}
+		continuationEntriesNum += entriesNum - 1;
+	}
+
+	MeasureFragmentation( fileFABs, bitmap, _info );
+	_info.continuationEntriesNum = continuationEntriesNum;
+
+	return true;
+}
+
+bool CDragonDOS_FS::DefragmentGains( const SDGNDosFragmentationInfo& _current, const SDGNDosFragmentationInfo& _planned )
+{
+	return _planned.extentsNum             < _current.extentsNum             ||
+		   _planned.continuationEntriesNum < _current.continuationEntriesNum ||
+		   _planned.largestFreeRun         > _current.largestFreeRun;
+}
+
+// Places each file, in _order, in a single run of sectors packed against the directory track and
+// the files placed before it. With _bDown set, the free runs before track 20 are tried first,
+// nearest first and filled from their end, and the ones after it only when a file doesn't fit.
+// Otherwise it's the other way round, filling the runs after track 20 from their start.
+// A file that can't be kept in one run anywhere falls back to AllocateSectors.
+bool CDragonDOS_FS::PlanLayout( const std::vector<size_t>& _order, const std::vector<size_t>& _sectorsNums, bool _bDown, std::vector<uint64_t>& _bitmap, std::vector< std::vector<SDGNDosFAB> >& _fabs ) const
+{
+	size_t dirFirstLSN = geometry.LSN( DRAGONDOS_DIR_TRACK, 0, 0 );
+	size_t dirEndLSN   = dirFirstLSN + DRAGONDOS_SECTORSPERTRACK;
+
+	_fabs.assign( _sectorsNums.size(), std::vector<SDGNDosFAB>() );
+	std::vector<SDGNDosFreeRun> runs;
+
+	for( size_t fileIdx : _order )
+	{
+		size_t sectorsNum = _sectorsNums[fileIdx];
+		if( 0 == sectorsNum )
+		{
+			continue;
+		}
+
+		FindFreeRuns( _bitmap, runs );
+
+		bool   bFound       = false;
+		bool   bBestSide    = false;
+		size_t bestLSN      = 0;
+		size_t bestDistance = 0;
+		for( const SDGNDosFreeRun& run : runs )
+		{
+			size_t runEnd = run.firstLSN + run.sectorsNum;
+			if( run.sectorsNum < sectorsNum || (run.firstLSN < dirEndLSN && runEnd > dirFirstLSN) )
+			{
+				continue;
+			}
+
+			bool   bBelow    = (runEnd <= dirFirstLSN);
+			bool   bSide     = (bBelow == _bDown);
+			size_t lsn       = bBelow ? runEnd - sectorsNum : run.firstLSN;
+			size_t distance  = bBelow ? dirFirstLSN - runEnd : run.firstLSN - dirEndLSN;
+			if( !bFound || (bSide && !bBestSide) || (bSide == bBestSide && distance < bestDistance) )
+			{
+				bFound       = true;
+				bBestSide    = bSide;
+				bestLSN      = lsn;
+				bestDistance = distance;
+			}
+		}
+
+		if( !bFound )
+		{
+			if( !AllocateSectors( _bitmap, sectorsNum, _fabs[fileIdx] ) )
+			{
+				return false;
+			}
+			continue;
+		}
+
+		for( size_t lsn = bestLSN; lsn < bestLSN + sectorsNum; ++lsn )
+		{
+			_bitmap[lsn / 64] &= ~((uint64_t)1 << (lsn % 64));
+		}
+
+		for( size_t offset = 0; offset < sectorsNum; offset += DRAGONDOS_MAX_FAB_SECTORS )
+		{
+			SDGNDosFAB fab;
+			fab.LSN        = (unsigned short int)(bestLSN + offset);
+			fab.numSectors = (unsigned char)std::min( (size_t)DRAGONDOS_MAX_FAB_SECTORS, sectorsNum - offset );
+			_fabs[fileIdx].push_back( fab );
+		}
+	}
+
+	return true;
+}
+
+// Relocates every file to a single run of sectors as close to the directory track as possible,
+// to cut down head movement on real drives, and rewrites the directory without gaps.
+//
+// The new layout is planned on a copy of the bitmap with the files' sectors released, once packing
+// the files down from track 20 and once packing them up from it (see PlanLayout). Packing on a
+// single side keeps the free space on the other one in one piece, so the plan that leaves the
+// largest free run is kept, or the one closer to the directory track if both leave the same.
+// Sectors in use that belong to no file, like the directory and backup tracks, stay as they are.
+//
+// If the plan gains nothing over the current layout (see DefragmentGains), the disk is left as it
+// is and _result describes the current layout.
+//
+// Nothing is written until the whole plan has been checked. The file data is then moved
+// through a copy in memory, so overlapping old and new locations don't matter, and the directory
+// and bitmap are replaced in one go and backed up to track 16.
+bool CDragonDOS_FS::Defragment( bool _planOnly, SDGNDosFragmentationInfo& _result )
+{
+	_result = SDGNDosFragmentationInfo();
+
+	if( nullptr == disk )
+	{
+		return false;
+	}
+
+	std::vector<uint64_t> bitmap;
+	size_t lsnNum = ReadBitmap( bitmap );
+	if( 0 == lsnNum )
+	{
+		return false;
+	}
+
+	// Current layout, with the sectors of every file released on the bitmap
+	std::vector< std::vector<SDGNDosFAB> > oldFABs( files.size() );
+	std::vector<unsigned char>             lastSectorSizes( files.size() );
+	std::vector<size_t>                    sectorsNums( files.size(), 0 );
+
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		size_t entriesNum = 0;
+		if( !GetEntryChain( files[fileIdx].GetDirEntry(), oldFABs[fileIdx], entriesNum, lastSectorSizes[fileIdx] ) )
+		{
+			return false;
+		}
+
+		for( const SDGNDosFAB& fab : oldFABs[fileIdx] )
+		{
+			if( (size_t)fab.LSN + fab.numSectors > lsnNum )
+			{
+				return false;
+			}
+
+			for( size_t lsn = fab.LSN; lsn < (size_t)fab.LSN + fab.numSectors; ++lsn )
+			{
+				bitmap[lsn / 64] |= (uint64_t)1 << (lsn % 64);
+			}
+			sectorsNums[fileIdx] += fab.numSectors;
+		}
+	}
+
+	// Never hand out the directory or its backup, whatever the bitmap says.
+	size_t dirFirstLSN = geometry.LSN( DRAGONDOS_DIR_TRACK, 0, 0 );
+	size_t tmpFirstLSN = geometry.LSN( DRAGONDOS_TEMP_DIR_TRACK, 0, 0 );
+
+	for( size_t sector = 0; sector < DRAGONDOS_SECTORSPERTRACK; ++sector )
+	{
+		if( dirFirstLSN + sector < lsnNum )
+		{
+			bitmap[(dirFirstLSN + sector) / 64] &= ~((uint64_t)1 << ((dirFirstLSN + sector) % 64));
+		}
+		if( tmpFirstLSN + sector < lsnNum )
+		{
+			bitmap[(tmpFirstLSN + sector) / 64] &= ~((uint64_t)1 << ((tmpFirstLSN + sector) % 64));
+		}
+	}
+
+	// Plan the new layout both ways and keep the best one
+	std::vector<size_t> placementOrder( files.size() );
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		placementOrder[fileIdx] = fileIdx;
+	}
+	std::stable_sort( placementOrder.begin(), placementOrder.end(), [&sectorsNums]( size_t _a, size_t _b ) { return sectorsNums[_a] > sectorsNums[_b]; } );
+
+	std::vector<uint64_t> upBitmap = bitmap;
+	std::vector< std::vector<SDGNDosFAB> > newFABs;
+	std::vector< std::vector<SDGNDosFAB> > upFABs;
+
+	if( !PlanLayout( placementOrder, sectorsNums, true, bitmap, newFABs ) || !PlanLayout( placementOrder, sectorsNums, false, upBitmap, upFABs ) )
+	{
+		return false;
+	}
+
+	SDGNDosFragmentationInfo downInfo;
+	SDGNDosFragmentationInfo upInfo;
+	MeasureFragmentation( newFABs, bitmap, downInfo );
+	MeasureFragmentation( upFABs, upBitmap, upInfo );
+
+	if( upInfo.extentsNum < downInfo.extentsNum ||
+		(upInfo.extentsNum == downInfo.extentsNum && (upInfo.largestFreeRun > downInfo.largestFreeRun ||
+		(upInfo.largestFreeRun == downInfo.largestFreeRun && upInfo.averageDirDistance < downInfo.averageDirDistance))) )
+	{
+		bitmap.swap( upBitmap );
+		newFABs.swap( upFABs );
+	}
+
+	size_t entriesNum = 0;
+	for( const std::vector<SDGNDosFAB>& fabs : newFABs )
+	{
+		entriesNum += GetDirEntriesNeeded( fabs.size() );
+	}
+
+	if( entriesNum > DRAGONDOS_DIR_MAX_ENTRIES )
+	{
+		return false;
+	}
+
+	MeasureFragmentation( newFABs, bitmap, _result );
+	_result.continuationEntriesNum = entriesNum - files.size();
+
+	// Don't rewrite the disk for nothing
+	SDGNDosFragmentationInfo current;
+	if( !GetFragmentationInfo( current ) )
+	{
+		return false;
+	}
+
+	if( !DefragmentGains( current, _result ) )
+	{
+		_result = current;
+		return true;
+	}
+
+	if( _planOnly )
+	{
+		return true;
+	}
+
+	// Copy the file data out of the old sectors and find the new ones before changing anything.
+	std::vector< std::vector<unsigned char> > fileData( files.size() );
+	std::vector< std::vector<unsigned char*> > dstSectors( files.size() );
+	const IDiskImageInterface* constDisk = disk;
+	std::vector<const unsigned char*> srcSectors;
+	std::vector<unsigned char*> fabSectors;
+
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		for( const SDGNDosFAB& fab : oldFABs[fileIdx] )
+		{
+			if( !geometry.GetSectors( fab.LSN, fab.numSectors, srcSectors ) )
+			{
+				return false;
+			}
+
+			for( const unsigned char* srcSector : srcSectors )
+			{
+				fileData[fileIdx].insert( fileData[fileIdx].end(), srcSector, srcSector + DRAGONDOS_SECTOR_SIZE );
+			}
+		}
+
+		for( const SDGNDosFAB& fab : newFABs[fileIdx] )
+		{
+			if( !geometry.GetSectors( fab.LSN, fab.numSectors, fabSectors ) )
+			{
+				return false;
+			}
+			dstSectors[fileIdx].insert( dstSectors[fileIdx].end(), fabSectors.begin(), fabSectors.end() );
+		}
+	}
+
+	// Build the new directory, keeping names, protection and last sector sizes.
+	std::vector<unsigned char*> dirSectors;
+	for( unsigned int sectorIdx = DRAGONDOS_DIR_START_SECTOR; sectorIdx < DRAGONDOS_SECTORSPERTRACK; ++sectorIdx )
+	{
+		unsigned char* sector = disk->GetSector( DRAGONDOS_DIR_TRACK, 0, sectorIdx );
+		if( nullptr == sector )
+		{
+			return false;
+		}
+		dirSectors.push_back( sector );
+	}
+
+	std::vector<unsigned char> newDir( DRAGONDOS_DIR_MAX_ENTRIES * DRAGONDOS_DIR_ENTRY_SIZE, 0 );
+	for( unsigned int entryIdx = 0; entryIdx < DRAGONDOS_DIR_MAX_ENTRIES; ++entryIdx )
+	{
+		newDir[entryIdx * DRAGONDOS_DIR_ENTRY_SIZE] = DRAGONDOS_FLAG_DELETED | DRAGONDOS_FLAG_ENDOFDIR | DRAGONDOS_FLAG_CONTINUATION;
+	}
+
+	unsigned int nextEntry = 0;
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		const SDGNDosDirectoryEntry& header = directory[files[fileIdx].GetDirEntry()];
+		const unsigned char* oldEntryPtr = constDisk->GetSector( DRAGONDOS_DIR_TRACK, 0, header.sector ) + header.entry * DRAGONDOS_DIR_ENTRY_SIZE;
+
+		size_t fileEntriesNum = GetDirEntriesNeeded( newFABs[fileIdx].size() );
+		size_t fabIdx = 0;
+
+		for( size_t entry = 0; entry < fileEntriesNum; ++entry, ++nextEntry )
+		{
+			unsigned char* entryPtr   = &newDir[nextEntry * DRAGONDOS_DIR_ENTRY_SIZE];
+			bool           bHeader    = (0 == entry);
+			bool           bContinued = (entry + 1 < fileEntriesNum);
+
+			memset( entryPtr, 0, DRAGONDOS_DIR_ENTRY_SIZE );
+
+			if( bHeader )
+			{
+				entryPtr[0x00] = header.bProtected ? DRAGONDOS_FLAG_PROTECTED : 0;
+				memcpy( entryPtr + 1, oldEntryPtr + 1, DRAGONDOS_MAX_FILE_NAME_LEN + DRAGONDOS_MAX_FILE_EXT_LEN );
+			}
+			else
+			{
+				entryPtr[0x00] = DRAGONDOS_FLAG_CONTINUATION;
+			}
+			entryPtr[0x00] |= bContinued ? DRAGONDOS_FLAG_CONTINUED : 0;
+
+			SetDirEntryFABs( entryPtr, bHeader, newFABs[fileIdx], fabIdx );
+
+			entryPtr[0x18] = bContinued ? (unsigned char)(nextEntry + 1) : lastSectorSizes[fileIdx];
+		}
+	}
+
+	// Everything is in place, so write it all.
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		const unsigned char* data = fileData[fileIdx].data();
+		for( unsigned char* dstSector : dstSectors[fileIdx] )
+		{
+			memcpy( dstSector, data, DRAGONDOS_SECTOR_SIZE );
+			data += DRAGONDOS_SECTOR_SIZE;
+		}
+	}
+
+	for( size_t sectorIdx = 0; sectorIdx < dirSectors.size(); ++sectorIdx )
+	{
+		memcpy( dirSectors[sectorIdx], &newDir[sectorIdx * DRAGONDOS_DIR_ENTRIES_PER_SECT * DRAGONDOS_DIR_ENTRY_SIZE], DRAGONDOS_DIR_ENTRIES_PER_SECT * DRAGONDOS_DIR_ENTRY_SIZE );
+	}
+
+	if( !WriteBitmap( bitmap ) )
+	{
+		return false;
+	}
+
+	BackUpDirTrack( disk );
+
+	// Keep the directory, the file list and the name index in step with the disk.
+	return ParseDirectory() && ParseFiles();
+}
+
+bool CDragonDOS_FS::IsBitmapLSNFree( const IDiskImageInterface* _disk, size_t _LSN ) const
+{
+	if( nullptr == _disk || _LSN >= (DRAGONDOS_SECTORSPERBITMAPSECTOR * 2) )
+	{
+		return false;
+	}
+
+	size_t sectorIdx = (_LSN / DRAGONDOS_SECTORSPERBITMAPSECTOR);
+
+	if( _LSN >= DRAGONDOS_SECTORSPERBITMAPSECTOR )
+	{
+		_LSN -= DRAGONDOS_SECTORSPERBITMAPSECTOR;
+	}
+
+	const unsigned char* sectorPtr = _disk->GetSector( DRAGONDOS_DIR_TRACK, 0, (unsigned int)sectorIdx );
+	if( nullptr == sectorPtr )
+	{
+		return false;
 	}
 
-	unsigned char* sectorPtr = _disk->GetSector( DRAGONDOS_DIR_TRACK, 0, (unsigned int)sectorIdx );
 	size_t sectorOffset = _LSN / 8;
 	size_t bitOffset    = _LSN % 8;
 
@@ -1021,3 +1933,35 @@ IFileSystemInterface* CDragonDOS_FS::NewFileSystem()
 {
 	return new CDragonDOS_FS;
 }
+
+// Checks the disk geometry bytes at the end of the first directory sector,
+// which are stored along with their complements.
+int CDragonDOS_FS::Probe( const IDiskImageInterface* _disk ) const
+{
+	if( nullptr == _disk || DRAGONDOS_SECTORSPERTRACK != _disk->GetSectorsNum() )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	// Not every image format reports sector sizes, so only reject the ones known to be too small.
+	const unsigned char* sector = _disk->GetSector( DRAGONDOS_DIR_TRACK, 0, 0 );
+	SSectorInfo sectorInfo = _disk->GetSectorInfo( DRAGONDOS_DIR_TRACK, 0, 0 );
+	if( nullptr == sector || (sectorInfo.isValid && sectorInfo.dataSize < DRAGONDOS_SECTOR_SIZE) )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	unsigned char numTracks    = sector[0xFC];
+	unsigned char secsPerTrack = sector[0xFD];
+
+	if( sector[0xFE] != (~numTracks & 0xFF) || sector[0xFF] != (~secsPerTrack & 0xFF) )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+	if( secsPerTrack != DRAGONDOS_SECTORSPERTRACK * _disk->GetSidesNum() )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	return ( numTracks == _disk->GetTracksNum() ) ? FILE_SYSTEM_PROBE_CERTAIN : FILE_SYSTEM_PROBE_LIKELY;
+}
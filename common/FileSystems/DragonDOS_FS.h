@@ -18,6 +18,7 @@
 
 #include "../DiskImages/DiskImageInterface.h"
 #include "FileSystemInterface.h"
+#include "../FS_Utils.h"
 #include <vector>
 #include <string>
 
@@ -50,6 +51,9 @@
 #define DRAGONDOS_FILE_HEADER_END           0xAA
 #define DRAGONDOS_BITMAPSIZE                180    // 180 bytes * 8 sectors per byte = 1440 sectors.
 #define DRAGONDOS_HALFBITMAPSIZE			90
+#define DRAGONDOS_MAX_FAB_SECTORS           255  // Sectors a single FAB can hold
+#define DRAGONDOS_HEADER_FABS               4    // FABs in a file header entry
+#define DRAGONDOS_CONTINUATION_FABS         7    // FABs in a continuation entry
 
 #define DRAGONDOS_INVALID                   0xFFFF // To signal invalid indices. DragonDOS can only have 160 entries max.
 
@@ -104,11 +108,49 @@ struct SDGNDosDirectoryEntry
     }
 };
 
+// File to be inserted by CDragonDOS_FS::InsertFiles
+struct SDGNDosNewFile
+{
+    std::string                 fileName;
+    std::vector<unsigned char>  data;
+};
+
+// Fragmentation report, see CDragonDOS_FS::GetFragmentationInfo
+struct SDGNDosFragmentationInfo
+{
+    size_t       filesNum;
+    size_t       fragmentedFilesNum;     // Files stored in more than one run of sectors
+    size_t       extentsNum;             // Runs of sectors holding file data
+    size_t       continuationEntriesNum; // Directory entries holding FABs that didn't fit in the header entries
+    size_t       freeSectorsNum;
+    size_t       freeRunsNum;
+    size_t       largestFreeRun;         // In sectors
+    double       averageDirDistance;     // Mean distance in tracks from file sectors to the directory track
+    unsigned int score;                  // 0 if every file is contiguous, 100 if no two sectors of a file are
+
+    SDGNDosFragmentationInfo()
+    {
+        filesNum               = 0;
+        fragmentedFilesNum     = 0;
+        extentsNum             = 0;
+        continuationEntriesNum = 0;
+        freeSectorsNum         = 0;
+        freeRunsNum            = 0;
+        largestFreeRun         = 0;
+        averageDirDistance     = 0.0;
+        score                  = 0;
+    }
+};
+
+class CDragonDOS_FS;
+
 // DragonDOS File
+// Only the directory information is kept. The file data is read from the
+// disk through its FAB chain the first time it's requested.
 class CDGNDosFile
 {
 public:
-    CDGNDosFile() {}
+    CDGNDosFile() : owner(nullptr), dirEntry(DRAGONDOS_INVALID), fileSize(0), bProtected(false), fileType(0), loadAddress(0), execAddress(0), dataLoaded(false) {}
     ~CDGNDosFile() {}
 
     std::string        GetFileName      () const                                    { return fileName;      }
@@ -116,7 +158,9 @@ public:
     void               GetFileData      ( std::vector<unsigned char>& dst ) const;
     void               SetFileData      ( const std::vector<unsigned char>& src );
     void               SetFileData      ( const unsigned char* src, size_t size );
-    size_t             GetFileSize      () const                                    { return data.size(); }
+    void               SetFileSource    ( const CDragonDOS_FS* _owner, unsigned short int _dirEntry, size_t _fileSize );
+    unsigned short int GetDirEntry      () const                                    { return dirEntry; }
+    size_t             GetFileSize      () const                                    { return dataLoaded ? data.size() : fileSize; }
     bool               GetFileProtected () const                                    { return bProtected; }
     void               SetFileProtected ( bool _protected )                         { bProtected = _protected; }
     unsigned char      GetFileType      () const                                    { return fileType; }
@@ -128,11 +172,16 @@ public:
 
 private:
     std::string                fileName;
-    std::vector<unsigned char> data;
+    const CDragonDOS_FS*  owner;       // File system holding the file data
+    unsigned short int    dirEntry;    // First directory entry of the file
+    size_t                fileSize;
     bool                  bProtected;
     unsigned char         fileType;
     unsigned short int    loadAddress;
     unsigned short int    execAddress;
+
+    mutable std::vector<unsigned char> data;
+    mutable bool                       dataLoaded;
 };
 
 // DragonDOS File system
@@ -142,6 +191,10 @@ public:
     CDragonDOS_FS();
     virtual ~CDragonDOS_FS();
 
+    // Files point back to the file system they read their data from, so it stays put.
+    CDragonDOS_FS( const CDragonDOS_FS& ) = delete;
+    CDragonDOS_FS& operator=( const CDragonDOS_FS& ) = delete;
+
     bool                  SetDisk         ( IDiskImageInterface* _disk );
     IDiskImageInterface*  GetDisk         ()                              { return disk; }
     unsigned short int    GetNumberOfFiles() const                        { return (unsigned short int)files.size(); }
@@ -153,6 +206,21 @@ public:
 
     const std::vector<SDGNDosDirectoryEntry>& GetDirectory() { return directory; }
 
+    // Inserts all the files or none of them, writing the directory and bitmap only once.
+    bool InsertFiles( const std::vector<SDGNDosNewFile>& _files );
+
+    // Reports how fragmented the files and the free space are.
+    bool GetFragmentationInfo( SDGNDosFragmentationInfo& _info ) const;
+
+    // Moves every file to a contiguous run as close as possible to the directory track, keeping
+    // the free space together, and compacts the directory. _result describes the disk after the
+    // move. With _planOnly set, or if there's nothing to gain, the disk is left as it is.
+    bool Defragment( bool _planOnly, SDGNDosFragmentationInfo& _result );
+
+    // True if the _planned layout has fewer runs of file sectors or continuation entries
+    // than the _current one, or a larger free run.
+    static bool DefragmentGains( const SDGNDosFragmentationInfo& _current, const SDGNDosFragmentationInfo& _planned );
+
 	// IFileSystemInterface //////////////////////////////////////////////////////////////////////////////////
 	bool Load(IDiskImageInterface* _disk);
 	bool Save(const std::string& _filename);
@@ -172,6 +240,7 @@ public:
 	const CDirectoryEntryWrapper& GetFSRoot() const;
 
 	virtual bool ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const;
+	virtual bool ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const;
 	virtual bool InsertFile ( const std::string& _fileName, const std::vector<unsigned char>& src, bool _binaryFile );
 	virtual bool DeleteFile ( const std::string& _fileName );
 
@@ -180,12 +249,18 @@ public:
 	bool InitDisk( IDiskImageInterface* _disk );
 
 	IFileSystemInterface* NewFileSystem();
+
+	int Probe( const IDiskImageInterface* _disk ) const;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 private:
+    friend class CDGNDosFile;
+
     IDiskImageInterface*           disk;
+    CDiskGeometry                  geometry;
     std::vector<SDGNDosDirectoryEntry>  directory;
     std::vector<CDGNDosFile>            files;
+    CFileNameIndex                      fileIndex;   // File name to position in files
 
     CDGNDosFile                    emptyFile;
 
@@ -193,10 +268,22 @@ private:
 
     bool                ParseDirectory();
     bool                ParseFiles    ();
+    bool                ExtractEntry  ( unsigned short int _entry, std::vector<unsigned char>& _dst, bool _withBinaryHeader ) const;
+    bool                GetEntrySegments( unsigned short int _entry, std::vector<SFileSegment>& _segments, bool _withBinaryHeader ) const;
+    size_t              GetEntryDataSize( unsigned short int _entry, bool _withBinaryHeader ) const;
     bool                BackUpDirTrack( IDiskImageInterface* _disk );
 
-    unsigned char GetMaxContiguousFreeSectorsInBitmapByte( unsigned char _bitmapByte );
-    bool          IsBitmapLSNFree  ( IDiskImageInterface* _disk, size_t _LSN );
+    size_t        ReadBitmap       ( std::vector<uint64_t>& _bitmap ) const;
+    bool          WriteBitmap      ( const std::vector<uint64_t>& _bitmap );
+    bool          AllocateSectors  ( std::vector<uint64_t>& _bitmap, size_t _sectorsNum, std::vector<SDGNDosFAB>& _fabs ) const;
+    bool          FindFreeEntries  ( size_t _entriesNum, std::vector<unsigned int>& _entries ) const;
+    bool          WriteFileData    ( const std::vector<SDGNDosFAB>& _fabs, const std::vector<unsigned char>& _data );
+    bool          WriteFileEntries ( const std::vector<unsigned int>& _entries, const std::string& _fileName, const std::vector<SDGNDosFAB>& _fabs, size_t _fileSize );
+    bool          GetEntryChain    ( unsigned short int _entry, std::vector<SDGNDosFAB>& _fabs, size_t& _entriesNum, unsigned char& _lastSectorSize ) const;
+    bool          PlanLayout       ( const std::vector<size_t>& _order, const std::vector<size_t>& _sectorsNums, bool _bDown, std::vector<uint64_t>& _bitmap, std::vector< std::vector<SDGNDosFAB> >& _fabs ) const;
+    void          MeasureFragmentation( const std::vector< std::vector<SDGNDosFAB> >& _fileFABs, const std::vector<uint64_t>& _bitmap, SDGNDosFragmentationInfo& _info ) const;
+
+    bool          IsBitmapLSNFree  ( const IDiskImageInterface* _disk, size_t _LSN ) const;
     void          MarkBitmapLSNFree( IDiskImageInterface* _disk, size_t _LSN );
     void          MarkBitmapLSNUsed( IDiskImageInterface* _disk, size_t _LSN );
 };
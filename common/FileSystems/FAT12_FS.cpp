@@ -34,8 +34,13 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 	// Check if disk has the right sector size
 	// if( _disk->GetSectorSize() == 512 )
 	disk = _disk;
+	geometry.SetDisk( _disk );
 
-	const unsigned char* bootSec = _disk->GetSector(0,0,0);
+	// Const views of the disk, so reading the boot sector and directories leaves the image clean.
+	const IDiskImageInterface* constDisk = _disk;
+	const CDiskGeometry& constGeometry = geometry;
+
+	const unsigned char* bootSec = constDisk->GetSector(0,0,0);
 	if( !bootSec )
 		return false;
 
@@ -78,10 +83,9 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 	//
 	// There are 2 12-bit entries packed every 3 bytes.
 	size_t packedFatSize = 512 * bs.sectorsPerFAT;
-	size_t sector = 1;
-	size_t side = 0;
-	size_t track = sector / bs.sectorsPerTrack;
+	size_t sector = bs.reservedSectorsNum;
 	const unsigned char* sec = NULL;
+	std::vector<const unsigned char*> fatSectors;
 	unsigned short int val0 = 0;
 	unsigned short int val1 = 0;
 	unsigned short int val2 = 0;
@@ -93,19 +97,17 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 		unsigned char* packedFat = new unsigned char[packedFatSize];
 
 		// Copy packed FAT data
-		for( size_t secsPerFAT = 0; secsPerFAT < bs.sectorsPerFAT; ++secsPerFAT )
+		if( !geometry.GetSectors( (uint32_t)sector, bs.sectorsPerFAT, fatSectors ) )
 		{
-			const unsigned char* sec = _disk->GetSector(track,0,sector);
-
-			memcpy( &packedFat[512*secsPerFAT], sec, 512 );
+			delete[] packedFat;
+			return false;
+		}
 
-			++sector;
-			if(sector >= bs.sectorsPerTrack)
-			{
-				++track;
-				sector -= bs.sectorsPerTrack;
-			}
+		for( size_t secsPerFAT = 0; secsPerFAT < bs.sectorsPerFAT; ++secsPerFAT )
+		{
+			memcpy( &packedFat[512*secsPerFAT], fatSectors[secsPerFAT], 512 );
 		}
+		sector += bs.sectorsPerFAT;
 
 		// Unpack FAT data
 		for( size_t cnt = 0; cnt < packedFatSize; cnt += 3 )
@@ -135,9 +137,8 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 	if( disk->GetSectorsNum() > 18 )
 		sector *= 2; // Dirty hack for reading DMF root directories! More info needed!
                      // May be actually that clusters are 4 sectors wide, check against docs.
-	track = LSNTrack(*disk,sector);
 
-	sec = _disk->GetSector(LSNTrack(*disk,sector),LSNHead(*disk,sector),LSNSector(*disk,sector));
+	sec = constGeometry.GetSector( (uint32_t)sector );
 	if( !sec )
 		return false;
 	
@@ -184,7 +185,7 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 
 			++sector;
 
-			sec = _disk->GetSector(LSNHead(*disk,sector),LSNTrack(*disk,sector),LSNSector(*disk,sector));
+			sec = constGeometry.GetSector( (uint32_t)sector );
 			if( !sec )
 				return false;
 		}
@@ -198,6 +199,14 @@ bool CFAT12_FS::Load(IDiskImageInterface* _disk)
 		ExploreDirectory(directory[dirIter]);
 	}
 
+	// The tree is complete, so pointers to its entries stay valid from here on.
+	files.clear();
+	pathIndex.Clear();
+	for( const SFAT12_Directory& entry : directory )
+	{
+		IndexDirectoryEntry( entry, "" );
+	}
+
     ExportHierarchy();
 
 	return true;
@@ -213,7 +222,8 @@ void CFAT12_FS::ExploreDirectory( SFAT12_Directory& _dir )
 	{
 		sector = _dir.firstLogicalCluster + 33 - 2; // TODO:Check this against FAT
 
-		const unsigned char* sec = disk->GetSector(LSNTrack(*disk,sector),LSNHead(*disk,sector),LSNSector(*disk,sector));
+		const CDiskGeometry& constGeometry = geometry;
+		const unsigned char* sec = constGeometry.GetSector( (uint32_t)sector );
 		if( !sec )
 			return;
 
@@ -373,35 +383,26 @@ bool CFAT12_FS::IsDirectory( const SFAT12_Directory& _entry ) const
     return ((_entry.attributes & SFAT12Attribute_Subdir) == SFAT12Attribute_Subdir);
 }
 
-void CFAT12_FS::FAT12_FindDirectoryEntry( const SFAT12_Directory& 	_parent, 
-                                          std::vector<std::string>& _tokens, 
-                                          size_t                  	_curToken, 
-                                          SFAT12_Directory&       	_dst ) const
+void CFAT12_FS::IndexDirectoryEntry( const SFAT12_Directory& _entry, const std::string& _parentPath )
 {
-    if( _curToken >= _tokens.size() )
-    {
-        return;
-    }
+    std::string path = _parentPath;
+    path += (char*)_entry.name;
+    path += ".";
+    path += (char*)_entry.ext;
 
-    std::string fullName = (char*)_parent.name;
-    fullName += ".";
-    fullName += (char*)_parent.ext;
-
-    if( 0 == _stricmp(_tokens[_curToken].c_str(), fullName.c_str()) )
+    if( IsDirectory(_entry) )
     {
-        if( IsDirectory(_parent) )
+        path += "/";
+        for( const SFAT12_Directory& child : _entry.children )
         {
-            for( auto child : _parent.children )
-            {
-                FAT12_FindDirectoryEntry( child, _tokens, _curToken+1, _dst );
-            }
-        }
-        else
-        {
-            _dst = _parent;
-            return;
+            IndexDirectoryEntry( child, path );
         }
     }
+    else
+    {
+        pathIndex.Add( path, files.size() );
+        files.push_back( &_entry );
+    }
 }
 
 bool CFAT12_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const
@@ -412,37 +413,47 @@ bool CFAT12_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned
         return false;
     }
 
-    // Tokenize file name
-    std::vector<std::string> strings;
-    std::istringstream f(_fileName);
-    std::string s;    
-    while (getline(f, s,'/')) {
-        strings.push_back(s);
+    // File names start with the volume name, which isn't part of the indexed path.
+    size_t pathStart = _fileName.find( '/' );
+    if( pathStart == std::string::npos )
+    {
+        return false;
     }
 
-    SFAT12_Directory fileEntry;
-    fileEntry.attributes = SFAT12Attribute_Invalid;
-    
-    for( auto entry : directory )
+    std::string path = _fileName.substr( pathStart + 1 );
+    if( !path.empty() && path.back() == '/' )
     {
-        FAT12_FindDirectoryEntry( entry, strings, 1, fileEntry );
+        path.pop_back();
     }
 
-    if( fileEntry.attributes != SFAT12Attribute_Invalid )
+    size_t fileIdx = pathIndex.Find( path );
+    if( fileIdx != CFileNameIndex::npos )
     {
+        const SFAT12_Directory& fileEntry = *files[fileIdx];
+
         unsigned short int rootDirSectors = ((bs.maxRootDirEntries * 32) + (bs.bytesPerSector - 1)) / bs.bytesPerSector;
         unsigned short int base = bs.reservedSectorsNum + (bs.numberOfFATs * bs.sectorsPerFAT) + rootDirSectors;
         unsigned short int currentCluster = fileEntry.firstLogicalCluster;
 
         size_t currentSize = 0;
+        std::vector<SSectorSpan> spans;
         while( currentCluster < 0xFF0 && currentSize <= fileEntry.fileSize )
         {
-            const unsigned char* data = disk->GetSector( LSNTrack (*disk,base + currentCluster - 2),
-                                                         LSNHead  (*disk,base + currentCluster - 2),
-                                                         LSNSector(*disk,base + currentCluster - 2));
-            dst.insert( dst.end(), data, data + bs.bytesPerSector );
-            currentCluster = fats[0][currentCluster];
-            currentSize += bs.bytesPerSector;
+            // Follow the chain while clusters are consecutive, so the whole run is read in one go.
+            unsigned short int firstCluster = currentCluster;
+            unsigned short int clustersNum  = 0;
+            do
+            {
+                currentCluster = fats[0][currentCluster];
+                currentSize += bs.bytesPerSector;
+                ++clustersNum;
+            } while( currentCluster < 0xFF0 && currentCluster == firstCluster + clustersNum && currentSize <= fileEntry.fileSize );
+
+            if( !geometry.GetSpans( base + firstCluster - 2, clustersNum, spans ) )
+            {
+                return false;
+            }
+            AppendSpans( spans, 0, (size_t)clustersNum * bs.bytesPerSector, dst );
         }
 
         dst.resize(fileEntry.fileSize);
@@ -477,3 +488,43 @@ IFileSystemInterface* CFAT12_FS::NewFileSystem()
 {
 	return new CFAT12_FS;
 }
+
+// Checks the BIOS parameter block in the boot sector.
+int CFAT12_FS::Probe( const IDiskImageInterface* _disk ) const
+{
+	if( nullptr == _disk )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	const unsigned char* bootSec = _disk->GetSector(0,0,0);
+	SSectorInfo sectorInfo = _disk->GetSectorInfo(0,0,0);
+	if( nullptr == bootSec || (sectorInfo.isValid && sectorInfo.dataSize < 512) )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	unsigned short int bytesPerSector     = bootSec[11] | (bootSec[12] << 8);
+	unsigned char      sectorsPerCluster  = bootSec[13];
+	unsigned short int reservedSectorsNum = bootSec[14] | (bootSec[15] << 8);
+	unsigned char      numberOfFATs       = bootSec[16];
+	unsigned short int maxRootDirEntries  = bootSec[17] | (bootSec[18] << 8);
+	unsigned short int sectorsPerFAT      = bootSec[22] | (bootSec[23] << 8);
+	unsigned short int sectorsPerTrack    = bootSec[24] | (bootSec[25] << 8);
+	unsigned short int numberOfHeads      = bootSec[26] | (bootSec[27] << 8);
+
+	// Same checks as Load, plus the fields it needs to find the FATs and root directory.
+	if( bytesPerSector != 512 || sectorsPerCluster < 1 || numberOfHeads != _disk->GetSidesNum() )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+	if( reservedSectorsNum < 1 || numberOfFATs < 1 || numberOfFATs > 2 || sectorsPerFAT < 1 || maxRootDirEntries < 1 )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	// A boot sector starts with a jump over the BPB.
+	bool bootJump = (bootSec[0] == 0xEB && bootSec[2] == 0x90) || bootSec[0] == 0xE9;
+
+	return ( bootJump && sectorsPerTrack == _disk->GetSectorsNum() ) ? FILE_SYSTEM_PROBE_CERTAIN : FILE_SYSTEM_PROBE_LIKELY;
+}
@@ -18,6 +18,7 @@
 ///////////////////////////////////////////////////////////////////////
 
 #include "FileSystemInterface.h"
+#include "FS_Utils.h"
 #include <vector>
 #include <string>
 
@@ -103,6 +104,8 @@ public:
 	bool InitDisk( IDiskImageInterface* _disk );
 
 	IFileSystemInterface* NewFileSystem();
+
+	int Probe( const IDiskImageInterface* _disk ) const;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 private:
@@ -112,15 +115,15 @@ private:
     void ExportDirectoryEntry( const SFAT12_Directory& _source , CDirectoryEntryWrapper* _target );
     bool IsDirectory( const SFAT12_Directory& _entry ) const;
 
-    void FAT12_FindDirectoryEntry(	const SFAT12_Directory& 	_parent, 
-                                	std::vector<std::string>&   _tokens, 
-                                	size_t                  	_curToken, 
-                                	SFAT12_Directory&       	_dst ) const;
+    void IndexDirectoryEntry( const SFAT12_Directory& _entry, const std::string& _parentPath );
 
 	IDiskImageInterface* 							disk;
+	CDiskGeometry									geometry;
 	SFAT12_BootSector                   			bs;
 	std::vector<SFAT12_Directory>            		directory;
 	std::vector<std::vector<unsigned short int> >	fats;
+	std::vector<const SFAT12_Directory*>			files;		// Every file in the tree, indexed by pathIndex
+	CFileNameIndex									pathIndex;	// Path below the root, "DIR.EXT/FILE.EXT", to position in files
 
     CDirectoryEntryWrapper         rootDir;
 };
@@ -1,4 +1,5 @@
 #include "FileSystemFactory.h"
+#include <algorithm>
 
 void FileSystemFactory::RegisterFileSystem( IFileSystemInterface* _fileSystemInterface )
 {
@@ -7,9 +8,28 @@ void FileSystemFactory::RegisterFileSystem( IFileSystemInterface* _fileSystemInt
 
 IFileSystemInterface* FileSystemFactory::LoadFileSystem( IDiskImageInterface* _disk )
 {
+	if( nullptr == _disk )
+	{
+		return nullptr;
+	}
+
+	// Let every file system score the disk from its signature sectors.
+	std::vector< std::pair<int, IFileSystemInterface*> > candidates;
 	for( auto FileSystem: m_FileSystems )
 	{
-		IFileSystemInterface* retVal = FileSystem->NewFileSystem();
+		int score = FileSystem->Probe( _disk );
+		if( FILE_SYSTEM_PROBE_NO != score )
+		{
+			candidates.push_back( std::make_pair( score, FileSystem ) );
+		}
+	}
+
+	// Best scores first. Ties keep the registration order.
+	std::stable_sort( candidates.begin(), candidates.end(), []( const std::pair<int, IFileSystemInterface*>& _a, const std::pair<int, IFileSystemInterface*>& _b ) { return _a.first > _b.first; } );
+
+	for( auto& candidate: candidates )
+	{
+		IFileSystemInterface* retVal = candidate.second->NewFileSystem();
 		if( retVal->Load( _disk ) )
 		{
 			return retVal;
@@ -19,10 +19,17 @@
 #include <string>
 #include <vector>
 #include "../DiskImages/DiskImageInterface.h"
+#include "../FileSegments.h"
 
 #define FA_DIRECTORY (1 << 0)
 #define FA_PROTECTED (1 << 1)
 
+// Probe scores. See IFileSystemInterface::Probe.
+#define FILE_SYSTEM_PROBE_NO      0   // The disk is not in this file system
+#define FILE_SYSTEM_PROBE_UNKNOWN 10  // File system can't tell without loading
+#define FILE_SYSTEM_PROBE_LIKELY  50  // Layout is consistent with the file system
+#define FILE_SYSTEM_PROBE_CERTAIN 100 // Signature matches
+
 struct SFileInfo
 {
 	std::string	        name;
@@ -36,7 +43,7 @@ struct SFileInfo
 class CDirectoryEntryWrapper
 {
 public:
-	CDirectoryEntryWrapper() { isDirectory = false; }
+	CDirectoryEntryWrapper() { isDirectory = false; childrenLoaded = true; }
 	virtual	~CDirectoryEntryWrapper() {}
 
 	std::string GetName() const { return name; }
@@ -45,15 +52,31 @@ public:
 	bool IsDirectory() const { return isDirectory; }
 	void SetIsDirectory( bool _isDirectory ) { isDirectory = _isDirectory; }
 
-	const std::vector<CDirectoryEntryWrapper*>& GetChildren() const { return children; }
+	// Directories flagged with SetChildrenLoaded(false) get their children
+	// from LoadChildren() the first time they're requested.
+	const std::vector<CDirectoryEntryWrapper*>& GetChildren() const
+	{
+		if( !childrenLoaded )
+		{
+			CDirectoryEntryWrapper* self = const_cast<CDirectoryEntryWrapper*>(this);
+			self->childrenLoaded = true;
+			self->LoadChildren();
+		}
+		return children;
+	}
 
 	void AddChild( CDirectoryEntryWrapper* _child ) { children.push_back(_child); }
 
-	void Clear() { isDirectory = false; children.clear(); }
+	void Clear() { isDirectory = false; childrenLoaded = true; children.clear(); }
+
+protected:
+	virtual void LoadChildren() {}
+	void SetChildrenLoaded( bool _loaded ) { childrenLoaded = _loaded; }
 
 private:
 	std::string name;
 	bool isDirectory;
+	bool childrenLoaded;
 
 	std::vector<CDirectoryEntryWrapper*> children;
 };
@@ -83,6 +106,29 @@ public:
 	virtual const CDirectoryEntryWrapper& GetFSRoot() const = 0;
 
 	virtual bool ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const = 0;
+
+	// Describes the contents of a file as a list of segments, in order, without copying them.
+	// Segments point into the disk image where possible and stay valid until it's modified or
+	// _buffer is changed. The default implementation extracts the file into _buffer and returns
+	// it as a single segment.
+	virtual bool ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const
+	{
+		_segments.clear();
+		_buffer.clear();
+
+		if( !ExtractFile( _fileName, _buffer, _withBinaryHeader ) )
+		{
+			return false;
+		}
+
+		if( !_buffer.empty() )
+		{
+			_segments.push_back( { _buffer.data(), _buffer.size() } );
+		}
+
+		return true;
+	}
+
 	virtual bool InsertFile ( const std::string& _fileName, const std::vector<unsigned char>& src, bool _binaryFile ) = 0;
 	virtual bool DeleteFile ( const std::string& _fileName ) = 0;
 
@@ -91,6 +137,10 @@ public:
 	virtual bool InitDisk( IDiskImageInterface* _disk ) = 0;
 
 	virtual IFileSystemInterface* NewFileSystem() = 0;
+
+	// Scores how likely a disk is to hold this file system by looking only at a few
+	// signature sectors. FileSystemFactory only loads the file systems with the highest scores.
+	virtual int Probe( const IDiskImageInterface* _disk ) const { return FILE_SYSTEM_PROBE_UNKNOWN; }
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 	// Copy and uncomment the block below into your derived class' header file.
@@ -114,6 +164,7 @@ public:
 	// const CDirectoryEntryWrapper& GetFSRoot() const;
 
 	// bool ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const;
+	// bool ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const;
 	// bool InsertFile ( const std::string& _fileName, const std::vector<unsigned char>& src, bool _binaryFile );
 	// bool DeleteFile ( const std::string& _fileName );
 
@@ -122,6 +173,8 @@ public:
 	// bool InitDisk( IDiskImageInterface* _disk );
 
 	// IFileSystemInterface* NewFileSystem();
+
+	// int Probe( const IDiskImageInterface* _disk ) const;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 };
 
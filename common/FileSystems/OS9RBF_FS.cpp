@@ -11,6 +11,7 @@
 //
 //
 ////////////////////////////////////////////////////////////////////
+#include <algorithm>
 #include <string.h> // for strcasecmp
 #include <sstream>
 #include "OS9RBF_FS.h"
@@ -24,6 +25,7 @@
 COS9RBF_FS::COS9RBF_FS()
 {
 	disk = NULL;
+	mFilesParsed = false;
 }
 
 // Destructor
@@ -40,6 +42,7 @@ COS9RBF_FS::~COS9RBF_FS()
 bool COS9RBF_FS::SetDisk( IDiskImageInterface* _disk )
 {
 	disk = _disk;
+	geometry.SetDisk( _disk );
 
 	/* if( DRAGONDOS_SECTORSPERTRACK != disk->GetSectorsNum() )
 	{
@@ -50,15 +53,13 @@ bool COS9RBF_FS::SetDisk( IDiskImageInterface* _disk )
 	if( false == ParseDirectory() )
 	{
 		disk = NULL;
+		geometry.SetDisk( NULL );
 		return false;
 	}
 
-	ParseFiles();
-/*  if( false == ParseFiles() )
-	{
-		disk = NULL;
-		return false;
-	}*/
+	// Files are enumerated on demand, see ParseFiles.
+	mFiles.clear();
+	mFilesParsed = false;
 
 	return true;
 }
@@ -70,7 +71,8 @@ bool COS9RBF_FS::ParseDirectory()
 		return false;
 
 	// Get Id Sector
-	const unsigned char* sector = disk->GetSector(0,0,0);
+	const IDiskImageInterface* constDisk = disk;
+	const unsigned char* sector = constDisk->GetSector(0,0,0);
 	if( !sector )
 		return false;
 
@@ -115,17 +117,27 @@ bool COS9RBF_FS::ParseDirectory()
 	//size_t mediaSize = (idSector.DD_LSNSize * 256) + 256;
 	root.Clear();
 	root.SetName(GetVolumeLabel());
-	root.Load( disk, idSector.DD_DIR, idSector.DD_LSNSize );
 
-	return true;
+	// Only the root descriptor is read here. Subdirectories are read when browsed.
+	size_t sectorSize = (0 == idSector.DD_LSNSize) ? 256 : idSector.DD_LSNSize;
+	return root.Load( geometry, idSector.DD_DIR, sectorSize );
 }
 
-void COS9RBF_FS::ParseFiles()
+// Builds the list of files, expanding every directory of the tree.
+// File data stays on the disk until ExtractFile is called.
+void COS9RBF_FS::ParseFiles() const
 {
+	if( mFilesParsed )
+	{
+		return;
+	}
+
+	mFiles.clear();
 	ParseFileNode( GetFSRoot(), "" );
+	mFilesParsed = true;
 }
 
-void COS9RBF_FS::ParseFileNode( const CDirectoryEntryWrapper& _entry, const std::string& _parentName )
+void COS9RBF_FS::ParseFileNode( const CDirectoryEntryWrapper& _entry, const std::string& _parentName ) const
 {
 	if( _entry.IsDirectory() )
 	{
@@ -150,10 +162,7 @@ void COS9RBF_FS::ParseFileNode( const CDirectoryEntryWrapper& _entry, const std:
 		SOS9RBFFile file;
 		file.name = _parentName;
 		file.name += _entry.GetName();
-		
-		ExtractFile( file.name, file.data, false );
-		
-		//printf("%s (%zu bytes)\n", file.name.c_str(), file.data.size());
+		file.descriptor = (const CFileDescriptor*)&_entry;
 
 		mFiles.push_back( file );
 	}
@@ -172,6 +181,8 @@ bool COS9RBF_FS::Save(const std::string& _filename)
 
 size_t COS9RBF_FS::GetFilesNum() const
 {
+	ParseFiles();
+
 	return mFiles.size();
 }
 
@@ -189,7 +200,17 @@ size_t COS9RBF_FS::GetFileSize( size_t _fileIdx ) const
 {
 	if( _fileIdx < GetFilesNum() )
 	{
-		return mFiles[_fileIdx].data.size();
+		// Same amount ExtractFile returns: the descriptor size, limited
+		// to what the segments can hold.
+		const CFileDescriptor* fd = mFiles[_fileIdx].descriptor;
+
+		size_t segmentsSize = 0;
+		for( auto segment : fd->GetFileSegments() )
+		{
+			segmentsSize += segment.size * disk->GetSectorSize();
+		}
+
+		return std::min( (size_t)fd->GetFileSize(), segmentsSize );
 	}
 
 	return 0;
@@ -232,13 +253,16 @@ SFileInfo COS9RBF_FS::GetFileInfo(size_t _fileIdx) const
 	return retVal;
 }
 
-void CFileDescriptor::Load( IDiskImageInterface* _disk, unsigned long int _lsn, size_t _sectorSize )
+bool CFileDescriptor::Load( const CDiskGeometry& _geometry, unsigned long int _lsn, size_t _sectorSize )
 {
-	unsigned short int head   = LSNHead(*_disk, _lsn);
-	unsigned short int track  = LSNTrack(*_disk, _lsn);
-	unsigned short int sector = LSNSector(*_disk, _lsn);
+	const unsigned char* _data = _geometry.GetSector( (uint32_t)_lsn );
+	if( !_data )
+	{
+		return false;
+	}
 
-	const unsigned char* _data = _disk->GetSector(track, head, sector);
+	geometry   = &_geometry;
+	sectorSize = _sectorSize;
 
 	FD_ATT =  _data[OFF_FD_ATT];
 	FD_OWN = (_data[OFF_FD_OWN]*256)+_data[OFF_FD_OWN+1];
@@ -251,6 +275,7 @@ void CFileDescriptor::Load( IDiskImageInterface* _disk, unsigned long int _lsn,
 	memcpy( FD_CREAT, &_data[OFF_FD_CREAT], 3 );
 	
 	// Process Segments
+	segments.clear();
 	unsigned long int segOffset = OFF_FD_SEG;
 	while( segOffset < _sectorSize )
 	{
@@ -266,73 +291,79 @@ void CFileDescriptor::Load( IDiskImageInterface* _disk, unsigned long int _lsn,
 		segOffset += FD_SEG_SIZE;
 	}
 
-	// Process directory entries
-	if( IsDirectory() )
+	// Directory entries are read by LoadChildren when first requested.
+	SetChildrenLoaded( !IsDirectory() );
+
+	return true;
+}
+
+void CFileDescriptor::LoadChildren()
+{
+	if( nullptr == geometry )
+	{
+		return;
+	}
+
+	// For every segment, every sector of segment...
+	std::vector<const unsigned char*> sectors;
+	for( auto curSegment : segments )
 	{
-		// For every segment, every sector of segment...
-		for( auto curSegment : segments )
+		if( !geometry->GetSectors( (uint32_t)curSegment.LSN, curSegment.size, sectors ) )
 		{
-			unsigned long int sectorLSN = curSegment.LSN;
+			// TODO:Mark in some way that this descriptor is invalid or flag problem.
+			return;
+		}
 
-			for( unsigned short int uSector = 0; uSector < curSegment.size; ++uSector )
+		for( const unsigned char* _data : sectors )
+		{
+			// Get directory entries
+			size_t offset = 0;
+			while( offset < sectorSize )
 			{
-				// Get sector data
-				head   = (sectorLSN % (_disk->GetSectorsNum() * _disk->GetSidesNum()) / _disk->GetSectorsNum());
-				track  = (sectorLSN/(_disk->GetSidesNum() * _disk->GetSectorsNum()));
-				sector = (sectorLSN % (_disk->GetSectorsNum() * _disk->GetSidesNum()) % _disk->GetSectorsNum());
-				++sectorLSN;
-
-				//++sector;
-				_data = _disk->GetSector(track, head, sector);
-				if( !_data )
+				// Check EOF
+				if( _data[offset] == 0xE5 )
 				{
-					// TODO:Mark in some way that this descriptor is invalid or flag problem.
-					return;
+					offset = sectorSize;
+					continue;
 				}
 
-				// Get directory entries
-				size_t offset = 0;
-				while( offset < _sectorSize )
+				// Read name
+				if( _data[offset] == 0 ) // Deleted or unused entry
 				{
-					// Check EOF
-					if( _data[offset] == 0xE5 )
-					{
-						offset = _sectorSize;
-						continue;
-					}
-					CFileDescriptor* tmpDir = new CFileDescriptor;
-					std::string entryName;
+					offset += FD_DIR_SIZE;
+					continue;
+				}
 
-					// Read name
-					if( _data[offset] == 0 ) // Deleted or unused entry
+				std::string entryName;
+				unsigned char nameOffset = 0;
+				while( nameOffset < FD_DIR_NAME_SIZE )
+				{
+					if( _data[offset+nameOffset] != 0 )
 					{
-						offset += FD_DIR_SIZE;
-						continue;
+						entryName += _data[offset+nameOffset] & 127;
 					}
+					++nameOffset;
+				}
 
-					unsigned char nameOffset = 0;
-					while( nameOffset < FD_DIR_NAME_SIZE )
-					{
-						if( _data[offset+nameOffset] != 0 )
-						{
-							entryName += _data[offset+nameOffset] & 127;
-						}
-						++nameOffset;
-					}
-					tmpDir->SetName( entryName );
+				// Load new directory
+				if( entryName.compare(0,1,".",1) != 0 && entryName.compare(0,2,"..",2) != 0 )
+				{
+					size_t lsnOffset = offset + OFF_FD_DIR_LSN;
+					unsigned long int dirLSN = (_data[lsnOffset]*65536)+(_data[lsnOffset+1]*256)+_data[lsnOffset+2];
 
-					// Load new directory
-					if( entryName.compare(0,1,".",1) != 0 && entryName.compare(0,2,"..",2) != 0 )
+					CFileDescriptor* tmpDir = new CFileDescriptor;
+					tmpDir->SetName( entryName );
+					if( tmpDir->Load( *geometry, dirLSN, sectorSize ) )
 					{
-						size_t lsnOffset = offset + OFF_FD_DIR_LSN;
-						unsigned long int dirLSN = (_data[lsnOffset]*65536)+(_data[lsnOffset+1]*256)+_data[lsnOffset+2];
-						tmpDir->Load( _disk, dirLSN, _sectorSize );
-						//entries.push_back( tmpDir );
 						AddChild( tmpDir );
 					}
-
-					offset += FD_DIR_SIZE;
+					else
+					{
+						delete tmpDir;
+					}
 				}
+
+				offset += FD_DIR_SIZE;
 			}
 		}
 	}
@@ -345,6 +376,27 @@ const CDirectoryEntryWrapper& COS9RBF_FS::GetFSRoot() const
 
 bool COS9RBF_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const
 {
+	std::vector<SFileSegment> segments;
+	std::vector<unsigned char> buffer;
+	if( !ExtractFileSegments( _fileName, segments, buffer, _withBinaryHeader ) )
+	{
+		return false;
+	}
+
+	dst.reserve( dst.size() + GetSegmentsSize( segments ) );
+	for( const SFileSegment& segment : segments )
+	{
+		dst.insert( dst.end(), segment.data, segment.data + segment.size );
+	}
+
+	return true;
+}
+
+bool COS9RBF_FS::ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const
+{
+	_segments.clear();
+	_buffer.clear();
+
 	// Tokenize file name
 	std::vector<std::string> strings;
 	std::istringstream f(_fileName);
@@ -362,26 +414,19 @@ bool COS9RBF_FS::ExtractFile( const std::string& _fileName, std::vector<unsigned
 
 		size_t remaining = fd->GetFileSize();
 
-		unsigned char t,h,s;
-		size_t dataSize;
-
+		std::vector<SSectorSpan> spans;
 		for( auto segment : fd->GetFileSegments() )
 		{
-			for( auto sectorNum = segment.LSN; sectorNum < segment.LSN+segment.size; ++sectorNum )
-			{
-				t = LSNTrack (*disk, sectorNum);
-				h = LSNHead  (*disk, sectorNum);
-				s = LSNSector(*disk, sectorNum);
-
-				const unsigned char* sector = disk->GetSector(t,h,s);
-				if( !sector )
-					return false;
-
-				dataSize = std::min(remaining,disk->GetSectorSize(t,h,s));
-				dst.insert( dst.end(), sector, sector + dataSize );
+			if( 0 == remaining )
+				break;
 
-				remaining -= dataSize;
+			if( !geometry.GetSpans( (uint32_t)segment.LSN, segment.size, spans ) )
+			{
+				_segments.clear();
+				return false;
 			}
+
+			remaining -= AppendSpanSegments( spans, 0, remaining, _segments );
 		}
 
 		return true;
@@ -409,3 +454,41 @@ IFileSystemInterface* COS9RBF_FS::NewFileSystem()
 {
 	return new COS9RBF_FS;
 }
+
+// Checks the disk size and sectors per track stored in the ID sector (LSN 0)
+// against the disk image geometry, the same way ParseDirectory does.
+int COS9RBF_FS::Probe( const IDiskImageInterface* _disk ) const
+{
+	if( nullptr == _disk )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	const unsigned char* sector = _disk->GetSector(0,0,0);
+	SSectorInfo sectorInfo = _disk->GetSectorInfo(0,0,0);
+	if( nullptr == sector || (sectorInfo.isValid && sectorInfo.dataSize <= OFF_DD_DSK) )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	size_t DD_TOT = (sector[OFF_DD_TOT]*65536)+(sector[OFF_DD_TOT+1]*256)+sector[OFF_DD_TOT+2];
+	size_t DD_TKS =  sector[OFF_DD_TKS];
+	size_t DD_DIR = (sector[OFF_DD_DIR]*65536)+(sector[OFF_DD_DIR+1]*256)+sector[OFF_DD_DIR+2];
+
+	if( DD_TOT != (size_t)(_disk->GetSidesNum()*_disk->GetTracksNum()*_disk->GetSectorsNum()) )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+	if( DD_TKS != (size_t)_disk->GetSectorsNum() )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	// The root directory descriptor can't be the ID sector or lie past the end of the disk.
+	if( 0 == DD_DIR || DD_DIR >= DD_TOT )
+	{
+		return FILE_SYSTEM_PROBE_NO;
+	}
+
+	return FILE_SYSTEM_PROBE_CERTAIN;
+}
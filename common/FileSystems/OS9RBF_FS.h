@@ -16,6 +16,7 @@
 
 #include "DiskImageInterface.h"
 #include "FileSystemInterface.h"
+#include "FS_Utils.h"
 #include <vector>
 #include <string>
 
@@ -103,18 +104,28 @@ struct SFileDescriptorSegment
     unsigned short int size;
 };
 
+// File descriptor. Directory entries are read from the disk the first
+// time GetChildren() is called on it.
 class CFileDescriptor : public CDirectoryEntryWrapper
 {
 public:
-    CFileDescriptor() {}
+    CFileDescriptor() { geometry = nullptr; sectorSize = 0; }
     ~CFileDescriptor() {}
 
-    void Load( IDiskImageInterface* _disk, unsigned long int _lsn, size_t _sectorSize );
+    // _geometry must outlive the descriptor, it's used to read the directory entries later on.
+    bool Load( const CDiskGeometry& _geometry, unsigned long int _lsn, size_t _sectorSize );
 
     unsigned long int GetFileSize() const { return FD_SIZ; }
     const std::vector<SFileDescriptorSegment>& GetFileSegments() const { return segments; }
 
+protected:
+    void LoadChildren() override;
+
 private:
+    const CDiskGeometry* geometry;
+    size_t             sectorSize;
+
+
     unsigned char      FD_ATT;      //  File Attributes: D S PE PW PR E W R
                                     //        D - file is a directory
                                     //        E - only owner can execute
@@ -135,7 +146,7 @@ private:
 struct SOS9RBFFile
 {
     std::string                name;
-    std::vector<unsigned char> data;
+    const CFileDescriptor*     descriptor;
 };
 
 // OS-9 RBF File system
@@ -167,6 +178,7 @@ public:
 	const CDirectoryEntryWrapper& GetFSRoot() const;
 
 	bool ExtractFile( const std::string& _fileName, std::vector<unsigned char>& dst, bool _withBinaryHeader ) const;
+	bool ExtractFileSegments( const std::string& _fileName, std::vector<SFileSegment>& _segments, std::vector<unsigned char>& _buffer, bool _withBinaryHeader ) const;
 	bool InsertFile ( const std::string& _fileName, const std::vector<unsigned char>& src, bool _binaryFile );
 	bool DeleteFile ( const std::string& _fileName );
 
@@ -175,20 +187,25 @@ public:
 	bool InitDisk( IDiskImageInterface* _disk );
 
 	IFileSystemInterface* NewFileSystem();
+
+	int Probe( const IDiskImageInterface* _disk ) const;
 	//////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 private:
     IDiskImageInterface*    disk;
+    CDiskGeometry           geometry;
     SIdSector               idSector;
 
     CFileDescriptor         root;
 
     bool                    ParseDirectory();
-    void                    ParseFiles    ();
-    void                    ParseFileNode ( const CDirectoryEntryWrapper& _entry, const std::string& _parentName );
+    void                    ParseFiles    () const;
+    void                    ParseFileNode ( const CDirectoryEntryWrapper& _entry, const std::string& _parentName ) const;
     unsigned short int      GetFileEntry  ( std::string _fileName );
 
-    std::vector<SOS9RBFFile> mFiles;
+    // The file list walks the whole tree, so it's only built when needed.
+    mutable std::vector<SOS9RBFFile> mFiles;
+    mutable bool                     mFilesParsed;
 };
 
 #endif
\ No newline at end of file
@@ -4,15 +4,42 @@
 
 #include "crc.h"
 
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define CRC32_PCLMUL
+#define CRC32_PCLMUL_TARGET __attribute__((target("pclmul,sse4.1")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define CRC32_PCLMUL
+#define CRC32_PCLMUL_TARGET
+#include <intrin.h>
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#define CRC32_ARMV8
+#define CRC32_ARMV8_TARGET
+#include <arm_acle.h>
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+// Generic aarch64 builds: the CRC32 instructions are optional before ARMv8.1,
+// so they're only used if the kernel reports them.
+#define CRC32_ARMV8
+#define CRC32_ARMV8_HWCAP
+#if defined(__clang__)
+#define CRC32_ARMV8_TARGET __attribute__((target("crc")))
+#else
+#define CRC32_ARMV8_TARGET __attribute__((target("+crc")))
+#endif
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#include <sys/auxv.h>
+#endif
+
 namespace crc 
 {
     // Most significant bit first (big-endian)
     // x^16+x^12+x^5+1 = (1) 0001 0000 0010 0001 = 0x1021
-    unsigned short int CRC16_MSB( const unsigned char* _data, unsigned short int _datasize, unsigned short int _poly, unsigned short int _start )
+    unsigned short int CRC16_MSB( const unsigned char* _data, size_t _datasize, unsigned short int _poly, unsigned short int _start )
     {
         unsigned int rem = _start;
         // A popular variant complements rem here
-        for( int i = 0; i < _datasize; ++i )
+        for( size_t i = 0; i < _datasize; ++i )
         {
             unsigned int byte = _data[i];
             rem = rem ^ (byte << 8);   // n = 16 in this example
@@ -36,12 +63,12 @@ namespace crc
 
     // Least significant bit first (little-endian)
     // x^16+x^12+x^5+1 = 1000 0100 0000 1000 (1) = 0x8408
-    unsigned short int CRC16_LSB( const unsigned char* _data, unsigned short int _datasize, unsigned short int _poly, unsigned short int _start )
+    unsigned short int CRC16_LSB( const unsigned char* _data, size_t _datasize, unsigned short int _poly, unsigned short int _start )
     {
         unsigned int rem = _start;
 
         // A popular variant complements rem here
-        for( int i = 0; i < _datasize; ++i )
+        for( size_t i = 0; i < _datasize; ++i )
         {
             unsigned int data = _data[i];
 
@@ -61,4 +88,212 @@ namespace crc
         // A popular variant complements rem here
         return (unsigned short int)rem;
     }
+
+    // CRC32 ////////////////////////////////////////////////////////////////////////////
+
+    // table[n][x] is the CRC of byte x followed by n zero bytes.
+    struct SCRC32Tables
+    {
+        uint32_t table[16][256];
+
+        SCRC32Tables()
+        {
+            for( uint32_t byte = 0; byte < 256; ++byte )
+            {
+                uint32_t rem = byte;
+                for( int j = 0; j < 8; ++j )
+                {
+                    rem = (rem & 1) ? (rem >> 1) ^ 0xEDB88320 : rem >> 1;
+                }
+                table[0][byte] = rem;
+            }
+
+            for( int n = 1; n < 16; ++n )
+            {
+                for( uint32_t byte = 0; byte < 256; ++byte )
+                {
+                    uint32_t prev = table[n - 1][byte];
+                    table[n][byte] = (prev >> 8) ^ table[0][prev & 0xFF];
+                }
+            }
+        }
+    };
+
+    // Works on the raw remainder, without the initial and final inversion.
+    static uint32_t CRC32_Slice16( const unsigned char* _data, size_t _datasize, uint32_t _rem )
+    {
+        static const SCRC32Tables tables;
+        const uint32_t (*t)[256] = tables.table;
+
+        for( ; _datasize >= 16; _datasize -= 16, _data += 16 )
+        {
+            uint32_t word = _rem ^ ( (uint32_t)_data[0] | ((uint32_t)_data[1] << 8) | ((uint32_t)_data[2] << 16) | ((uint32_t)_data[3] << 24) );
+            _rem = t[15][word & 0xFF]     ^ t[14][(word >> 8) & 0xFF] ^ t[13][(word >> 16) & 0xFF] ^ t[12][word >> 24] ^
+                   t[11][_data[4]]        ^ t[10][_data[5]]           ^ t[9][_data[6]]             ^ t[8][_data[7]]   ^
+                   t[7][_data[8]]         ^ t[6][_data[9]]            ^ t[5][_data[10]]            ^ t[4][_data[11]]  ^
+                   t[3][_data[12]]        ^ t[2][_data[13]]           ^ t[1][_data[14]]            ^ t[0][_data[15]];
+        }
+
+        for( ; _datasize > 0; --_datasize, ++_data )
+        {
+            _rem = (_rem >> 8) ^ t[0][(_rem ^ *_data) & 0xFF];
+        }
+
+        return _rem;
+    }
+
+#if defined(CRC32_PCLMUL)
+    static bool CPUHasPCLMUL()
+    {
+#if defined(_MSC_VER)
+        int info[4];
+        __cpuid( info, 1 );
+        return (info[2] & (1 << 1)) && (info[2] & (1 << 19)); // PCLMULQDQ and SSE4.1
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports( "pclmul" ) && __builtin_cpu_supports( "sse4.1" );
+#endif
+    }
+
+    // Folds the buffer 64 bytes at a time with carry-less multiplications, then reduces
+    // the result with Barrett reduction. _datasize must be at least 64 and a multiple of 16.
+    // Constants from "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ
+    // Instruction", V. Gopal, E. Ozturk et al., Intel, 2009.
+    CRC32_PCLMUL_TARGET static uint32_t CRC32_PCLMUL_Fold( const unsigned char* _data, size_t _datasize, uint32_t _rem )
+    {
+        const __m128i k1k2 = _mm_set_epi64x( 0x01c6e41596, 0x0154442bd4 );
+        const __m128i k3k4 = _mm_set_epi64x( 0x00ccaa009e, 0x01751997d0 );
+        const __m128i k5k0 = _mm_set_epi64x( 0x0000000000, 0x0163cd6124 );
+        const __m128i poly = _mm_set_epi64x( 0x01f7011641, 0x01db710641 );
+        const __m128i mask = _mm_setr_epi32( ~0, 0, ~0, 0 );
+
+        __m128i x1 = _mm_loadu_si128( (const __m128i*)(_data + 0x00) );
+        __m128i x2 = _mm_loadu_si128( (const __m128i*)(_data + 0x10) );
+        __m128i x3 = _mm_loadu_si128( (const __m128i*)(_data + 0x20) );
+        __m128i x4 = _mm_loadu_si128( (const __m128i*)(_data + 0x30) );
+        __m128i x5;
+
+        x1 = _mm_xor_si128( x1, _mm_cvtsi32_si128( (int)_rem ) );
+        _data += 64;
+        _datasize -= 64;
+
+        // Fold four 128 bit lanes in parallel
+        while( _datasize >= 64 )
+        {
+            __m128i x6, x7, x8;
+            x5 = _mm_clmulepi64_si128( x1, k1k2, 0x00 );
+            x6 = _mm_clmulepi64_si128( x2, k1k2, 0x00 );
+            x7 = _mm_clmulepi64_si128( x3, k1k2, 0x00 );
+            x8 = _mm_clmulepi64_si128( x4, k1k2, 0x00 );
+
+            x1 = _mm_clmulepi64_si128( x1, k1k2, 0x11 );
+            x2 = _mm_clmulepi64_si128( x2, k1k2, 0x11 );
+            x3 = _mm_clmulepi64_si128( x3, k1k2, 0x11 );
+            x4 = _mm_clmulepi64_si128( x4, k1k2, 0x11 );
+
+            x1 = _mm_xor_si128( _mm_xor_si128( x1, x5 ), _mm_loadu_si128( (const __m128i*)(_data + 0x00) ) );
+            x2 = _mm_xor_si128( _mm_xor_si128( x2, x6 ), _mm_loadu_si128( (const __m128i*)(_data + 0x10) ) );
+            x3 = _mm_xor_si128( _mm_xor_si128( x3, x7 ), _mm_loadu_si128( (const __m128i*)(_data + 0x20) ) );
+            x4 = _mm_xor_si128( _mm_xor_si128( x4, x8 ), _mm_loadu_si128( (const __m128i*)(_data + 0x30) ) );
+
+            _data += 64;
+            _datasize -= 64;
+        }
+
+        // Fold the four lanes into one
+        x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128( x1, x2 ), x5 );
+
+        x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128( x1, x3 ), x5 );
+
+        x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+        x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+        x1 = _mm_xor_si128( _mm_xor_si128( x1, x4 ), x5 );
+
+        // Remaining 16 byte blocks
+        while( _datasize >= 16 )
+        {
+            x5 = _mm_clmulepi64_si128( x1, k3k4, 0x00 );
+            x1 = _mm_clmulepi64_si128( x1, k3k4, 0x11 );
+            x1 = _mm_xor_si128( _mm_xor_si128( x1, _mm_loadu_si128( (const __m128i*)_data ) ), x5 );
+
+            _data += 16;
+            _datasize -= 16;
+        }
+
+        // 128 bits to 64
+        x2 = _mm_clmulepi64_si128( x1, k3k4, 0x10 );
+        x1 = _mm_xor_si128( _mm_srli_si128( x1, 8 ), x2 );
+
+        x2 = _mm_srli_si128( x1, 4 );
+        x1 = _mm_and_si128( x1, mask );
+        x1 = _mm_clmulepi64_si128( x1, k5k0, 0x00 );
+        x1 = _mm_xor_si128( x1, x2 );
+
+        // Barrett reduction to 32 bits
+        x2 = _mm_and_si128( x1, mask );
+        x2 = _mm_clmulepi64_si128( x2, poly, 0x10 );
+        x2 = _mm_and_si128( x2, mask );
+        x2 = _mm_clmulepi64_si128( x2, poly, 0x00 );
+        x1 = _mm_xor_si128( x1, x2 );
+
+        return (uint32_t)_mm_extract_epi32( x1, 1 );
+    }
+#endif
+
+#if defined(CRC32_ARMV8)
+    static bool CPUHasARMv8CRC32()
+    {
+#if defined(CRC32_ARMV8_HWCAP)
+        return 0 != (getauxval( AT_HWCAP ) & HWCAP_CRC32);
+#else
+        return true;
+#endif
+    }
+
+    CRC32_ARMV8_TARGET static uint32_t CRC32_ARMv8( const unsigned char* _data, size_t _datasize, uint32_t _rem )
+    {
+        for( ; _datasize >= 8; _datasize -= 8, _data += 8 )
+        {
+            uint64_t word = (uint64_t)_data[0]         | ((uint64_t)_data[1] << 8)  | ((uint64_t)_data[2] << 16) | ((uint64_t)_data[3] << 24) |
+                            ((uint64_t)_data[4] << 32) | ((uint64_t)_data[5] << 40) | ((uint64_t)_data[6] << 48) | ((uint64_t)_data[7] << 56);
+            _rem = __crc32d( _rem, word );
+        }
+
+        for( ; _datasize > 0; --_datasize, ++_data )
+        {
+            _rem = __crc32b( _rem, *_data );
+        }
+
+        return _rem;
+    }
+#endif
+
+    uint32_t CRC32( const unsigned char* _data, size_t _datasize, uint32_t _crc )
+    {
+        uint32_t rem = ~_crc;
+
+#if defined(CRC32_PCLMUL)
+        static const bool hasPCLMUL = CPUHasPCLMUL();
+        if( hasPCLMUL && _datasize >= 64 )
+        {
+            size_t foldSize = _datasize & ~(size_t)15;
+            rem = CRC32_PCLMUL_Fold( _data, foldSize, rem );
+            _data += foldSize;
+            _datasize -= foldSize;
+        }
+#elif defined(CRC32_ARMV8)
+        static const bool hasCRC32 = CPUHasARMv8CRC32();
+        if( hasCRC32 )
+        {
+            rem = CRC32_ARMv8( _data, _datasize, rem );
+            _datasize = 0;
+        }
+#endif
+
+        return ~CRC32_Slice16( _data, _datasize, rem );
+    }
 }
@@ -6,12 +6,122 @@
 #ifndef __CRC_H__
 #define __CRC_H__
 
-namespace crc 
+#include <stddef.h>
+#include <stdint.h>
+
+namespace crc
 {
     const unsigned short int CRC16_CCITT_POLY = 0x8408;
-	
-    unsigned short int CRC16_MSB( const unsigned char* _data, unsigned short int _datasize, unsigned short int _poly, unsigned short int _start );
-    unsigned short int CRC16_LSB( const unsigned char* _data, unsigned short int _datasize, unsigned short int _poly, unsigned short int _start );
+
+    // Bit by bit versions, for polynomials only known at run time.
+    unsigned short int CRC16_MSB( const unsigned char* _data, size_t _datasize, unsigned short int _poly, unsigned short int _start );
+    unsigned short int CRC16_LSB( const unsigned char* _data, size_t _datasize, unsigned short int _poly, unsigned short int _start );
+
+    // CRC-32 as used by zip, zlib and PNG (reflected polynomial 0xEDB88320).
+    // Pass the result of a previous call as _crc to checksum data in several pieces.
+    // Uses PCLMULQDQ folding on x86 CPUs that support it, the ARMv8 CRC32 instructions
+    // on aarch64 CPUs that have them, and slicing-by-16 tables otherwise. Support is
+    // checked at run time, unless the build already targets CPUs that have it.
+    uint32_t CRC32( const unsigned char* _data, size_t _datasize, uint32_t _crc = 0 );
+
+    // Table driven CRC16 for a polynomial fixed at compile time.
+    // TMSBFirst selects the same bit order as CRC16_MSB, otherwise it matches CRC16_LSB.
+    //
+    // Each instantiation builds its own 8 x 256 entry tables on first use. Buffers are
+    // processed 8 bytes at a time (slice-by-8), with a byte at a time loop for the tail.
+    //
+    // Can be used in one go:
+    //     crc::CCRC16<crc::CRC16_CCITT_POLY>::Compute( data, size, 0xFFFF );
+    // or fed incrementally:
+    //     crc::CCRC16<crc::CRC16_CCITT_POLY> crc( 0xFFFF );
+    //     crc.Update( header, headerSize );
+    //     crc.Update( data, dataSize );
+    //     crc.GetValue();
+    template< unsigned short int TPoly, bool TMSBFirst = true >
+    class CCRC16
+    {
+    public:
+        explicit CCRC16( unsigned short int _start = 0xFFFF ) : mValue( _start ) {}
+
+        void               Reset   ( unsigned short int _start = 0xFFFF ) { mValue = _start; }
+        void               Update  ( const unsigned char* _data, size_t _datasize ) { mValue = Compute( _data, _datasize, mValue ); }
+        unsigned short int GetValue() const { return mValue; }
+
+        static unsigned short int Compute( const unsigned char* _data, size_t _datasize, unsigned short int _start )
+        {
+            const STables& tables = GetTables();
+            unsigned int rem = _start;
+
+            if( TMSBFirst )
+            {
+                for( ; _datasize >= 8; _datasize -= 8, _data += 8 )
+                {
+                    rem ^= (_data[0] << 8) | _data[1];
+                    rem = tables.slice[7][rem >> 8]   ^ tables.slice[6][rem & 0xFF] ^
+                          tables.slice[5][_data[2]]   ^ tables.slice[4][_data[3]]   ^
+                          tables.slice[3][_data[4]]   ^ tables.slice[2][_data[5]]   ^
+                          tables.slice[1][_data[6]]   ^ tables.slice[0][_data[7]];
+                }
+
+                for( ; _datasize > 0; --_datasize, ++_data )
+                {
+                    rem = ((rem << 8) & 0xFFFF) ^ tables.slice[0][(rem >> 8) ^ *_data];
+                }
+            }
+            else
+            {
+                for( ; _datasize >= 8; _datasize -= 8, _data += 8 )
+                {
+                    rem ^= _data[0] | (_data[1] << 8);
+                    rem = tables.slice[7][rem & 0xFF] ^ tables.slice[6][rem >> 8] ^
+                          tables.slice[5][_data[2]]   ^ tables.slice[4][_data[3]] ^
+                          tables.slice[3][_data[4]]   ^ tables.slice[2][_data[5]] ^
+                          tables.slice[1][_data[6]]   ^ tables.slice[0][_data[7]];
+                }
+
+                for( ; _datasize > 0; --_datasize, ++_data )
+                {
+                    rem = (rem >> 8) ^ tables.slice[0][(rem ^ *_data) & 0xFF];
+                }
+            }
+
+            return (unsigned short int)rem;
+        }
+
+    private:
+        // slice[n][x] is the CRC of byte x followed by n zero bytes.
+        struct STables
+        {
+            unsigned short int slice[8][256];
+
+            STables()
+            {
+                for( unsigned int byte = 0; byte < 256; ++byte )
+                {
+                    unsigned char data = (unsigned char)byte;
+                    slice[0][byte] = TMSBFirst ? CRC16_MSB( &data, 1, TPoly, 0 ) : CRC16_LSB( &data, 1, TPoly, 0 );
+                }
+
+                for( unsigned int n = 1; n < 8; ++n )
+                {
+                    for( unsigned int byte = 0; byte < 256; ++byte )
+                    {
+                        unsigned int prev = slice[n - 1][byte];
+                        slice[n][byte] = TMSBFirst ? (unsigned short int)(((prev << 8) & 0xFFFF) ^ slice[0][prev >> 8])
+                                                   : (unsigned short int)((prev >> 8) ^ slice[0][prev & 0xFF]);
+                    }
+                }
+            }
+        };
+
+        static const STables& GetTables()
+        {
+            static const STables tables;
+            return tables;
+        }
+
+        unsigned short int mValue;
+    };
 }
 
-#endif // __CRC_H__
\ No newline at end of file
+#endif // __CRC_H__
@@ -0,0 +1,110 @@
+///////////////////////////////////////////////
+// crcbench.cpp - Checks the table driven CRC
+//                functions against the bit by
+//                bit ones and measures their
+//                throughput.
+//
+// Usage: crcbench [passes]
+///////////////////////////////////////////////
+
+#include "crc.h"
+
+#include <chrono>
+#include <random>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#define CRCBENCH_BUFFER_SIZE    (1024 * 1024)
+#define CRCBENCH_DEFAULT_PASSES 64
+#define CRCBENCH_CHECKS         5000
+
+typedef unsigned short int (*CRC16Function)( const unsigned char* _data, size_t _datasize, unsigned short int _start );
+
+static unsigned short int BitwiseMSB( const unsigned char* _data, size_t _datasize, unsigned short int _start )
+{
+    return crc::CRC16_MSB( _data, _datasize, 0x1021, _start );
+}
+
+static unsigned short int BitwiseLSB( const unsigned char* _data, size_t _datasize, unsigned short int _start )
+{
+    return crc::CRC16_LSB( _data, _datasize, crc::CRC16_CCITT_POLY, _start );
+}
+
+static unsigned short int TableMSB( const unsigned char* _data, size_t _datasize, unsigned short int _start )
+{
+    return crc::CCRC16<0x1021>::Compute( _data, _datasize, _start );
+}
+
+static unsigned short int TableLSB( const unsigned char* _data, size_t _datasize, unsigned short int _start )
+{
+    return crc::CCRC16<crc::CRC16_CCITT_POLY, false>::Compute( _data, _datasize, _start );
+}
+
+// Checksums the whole buffer _passes times, in pieces of _chunkSize bytes, and returns MB/s.
+static double Throughput( CRC16Function _function, const std::vector<unsigned char>& _buffer, size_t _chunkSize, int _passes, unsigned long& _checksum )
+{
+    auto start = std::chrono::steady_clock::now();
+
+    for( int pass = 0; pass < _passes; ++pass )
+    {
+        for( size_t offset = 0; offset + _chunkSize <= _buffer.size(); offset += _chunkSize )
+        {
+            _checksum += _function( &_buffer[offset], _chunkSize, 0xFFFF );
+        }
+    }
+
+    double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+    return (double)_buffer.size() * _passes / (1024.0 * 1024.0) / seconds;
+}
+
+int main( int argc, char** argv )
+{
+    int passes = argc > 1 ? atoi( argv[1] ) : CRCBENCH_DEFAULT_PASSES;
+    if( passes <= 0 )
+    {
+        passes = CRCBENCH_DEFAULT_PASSES;
+    }
+
+    std::mt19937 rng( 1234 );
+    std::vector<unsigned char> buffer( CRCBENCH_BUFFER_SIZE );
+    for( unsigned char& byte : buffer )
+    {
+        byte = (unsigned char)rng();
+    }
+
+    // Random offsets, lengths and start values must give the same result both ways.
+    int mismatches = 0;
+    for( int check = 0; check < CRCBENCH_CHECKS; ++check )
+    {
+        size_t             offset = rng() % 1000;
+        size_t             length = rng() % 3000;
+        unsigned short int start  = (unsigned short int)rng();
+
+        mismatches += (BitwiseMSB( &buffer[offset], length, start ) != TableMSB( &buffer[offset], length, start )) ? 1 : 0;
+        mismatches += (BitwiseLSB( &buffer[offset], length, start ) != TableLSB( &buffer[offset], length, start )) ? 1 : 0;
+    }
+
+    printf( "Mismatches: %d of %d checks\n", mismatches, CRCBENCH_CHECKS * 2 );
+    printf( "MB/s, %d passes over %d KiB\n", passes, CRCBENCH_BUFFER_SIZE / 1024 );
+    printf( "%9s %9s %9s %7s     %9s %9s\n", "chunk", "CRC16_MSB", "CCRC16", "", "CRC16_LSB", "CCRC16" );
+    printf( "%9s %9s %9s %7s     %9s %9s\n", "", "", "<0x1021>", "", "", "<0x8408,false>" );
+
+    unsigned long checksum = 0;
+    const size_t chunkSizes[] = { 256, 512, CRCBENCH_BUFFER_SIZE };
+
+    for( size_t chunkSize : chunkSizes )
+    {
+        double bitwiseMSB = Throughput( BitwiseMSB, buffer, chunkSize, passes, checksum );
+        double tableMSB   = Throughput( TableMSB,   buffer, chunkSize, passes, checksum );
+        double bitwiseLSB = Throughput( BitwiseLSB, buffer, chunkSize, passes, checksum );
+        double tableLSB   = Throughput( TableLSB,   buffer, chunkSize, passes, checksum );
+
+        printf( "%7zu B %9.1f %9.1f (x%4.1f)     %9.1f %9.1f (x%4.1f)\n", chunkSize,
+                bitwiseMSB, tableMSB, tableMSB / bitwiseMSB, bitwiseLSB, tableLSB, tableLSB / bitwiseLSB );
+    }
+
+    printf( "Checksum: %lu\n", checksum );
+
+    return (0 == mismatches) ? 0 : -1;
+}
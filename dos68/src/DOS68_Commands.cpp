@@ -128,12 +128,15 @@ bool ExtractCommand( const vector<string>& _args )
         return false;
     }
 
+    vector<SFileSegment> segments;
+    vector<unsigned char> fileData;
+
     for( size_t fileIdx = start; fileIdx < end; ++fileIdx )
     {
-        vector<unsigned char> fileData;
         SFileInfo fi = fs.GetFileInfo( fileIdx );
 
-        if( !fs.ExtractFile( fi.name, fileData ) )
+        // The file data is written straight from the disk image.
+        if( !fs.ExtractFileSegments( fi.name, segments, fileData ) )
         {
             cout << "The requested file couldn't be found. The disk image may be damaged or corrupted." << endl;
             return false;
@@ -146,16 +149,25 @@ bool ExtractCommand( const vector<string>& _args )
             return false;
         }
 
-        size_t bytesWritten = fwrite( fileData.data(), 1, fileData.size(), pOut );
-        fclose( pOut );
+        size_t dataSize = 0;
+        for( const SFileSegment& segment : segments )
+        {
+            dataSize += segment.size;
+        }
+
+        size_t bytesWritten = WriteFileSegments( pOut, segments );
+        if( 0 != fclose( pOut ) )
+        {
+            bytesWritten = 0;
+        }
 
-        if( bytesWritten != fileData.size() )
+        if( bytesWritten != dataSize )
         {
-            cout << "Error writing file " << fi.name << " " << bytesWritten << " of " << fileData.size() << " bytes written." << endl;
+            cout << "Error writing file " << fi.name << " " << bytesWritten << " of " << dataSize << " bytes written." << endl;
             return false;
         }
 
-        cout << fileIdx << "\t" << PadFilename(fi.name) << "\t" << bytesWritten << " of " << fileData.size() << " bytes written." << endl;
+        cout << fileIdx << "\t" << PadFilename(fi.name) << "\t" << bytesWritten << " of " << dataSize << " bytes written." << endl;
     }
 
     return true;
@@ -183,6 +183,27 @@ SFileInfo CDOS68_FS::GetFileInfo(size_t _fileIdx)
 
 bool CDOS68_FS::ExtractFile( string _fileName, vector<unsigned char>& _dst )
 {
+    vector<SFileSegment> segments;
+    vector<unsigned char> buffer;
+    if( !ExtractFileSegments( _fileName, segments, buffer ) )
+    {
+        return false;
+    }
+
+    for( const SFileSegment& segment : segments )
+    {
+        _dst.insert( _dst.end(), segment.data, segment.data + segment.size );
+    }
+
+    return true;
+}
+
+// Every sector starts with the link to the next one, so there's one segment per sector.
+bool CDOS68_FS::ExtractFileSegments( string _fileName, vector<SFileSegment>& _segments, vector<unsigned char>& _buffer )
+{
+    _segments.clear();
+    _buffer.clear();
+
     if( nullptr == mDisk )
     {
         return false;
@@ -197,11 +218,18 @@ bool CDOS68_FS::ExtractFile( string _fileName, vector<unsigned char>& _dst )
         uint8_t sectorId = result->firstSector;
         uint16_t sectorsNum = (result->sectorsNumHigh << 8) | result->sectorsNumLow;
 
+        const IDiskImageInterface* disk = mDisk;
+        _segments.reserve( sectorsNum );
         for( uint16_t sector = 0; sector < sectorsNum; ++sector )
         {
-            const unsigned char* sectorData = mDisk->GetSector( trackId, 0, sectorId );
+            const unsigned char* sectorData = disk->GetSector( trackId, 0, sectorId );
+            if( nullptr == sectorData )
+            {
+                _segments.clear();
+                return false;
+            }
 
-            _dst.insert( _dst.end(), sectorData + 4, sectorData + DOS68_SECTOR_SIZE );
+            _segments.push_back( { sectorData + 4, DOS68_SECTOR_SIZE - 4 } );
 
             trackId = sectorData[0] & DOS68_TRACK_ID_MASK;
             sectorId = sectorData[1] & DOS68_SECTOR_ID_MASK;
@@ -210,9 +238,19 @@ bool CDOS68_FS::ExtractFile( string _fileName, vector<unsigned char>& _dst )
         // Remove trailing zeroes if file is an ASCII file.
         if( result->type == DOS68_FILE_TYPE_SEQ_ASCII )
         {
-            while( 0 == _dst.back() )
+            while( !_segments.empty() )
             {
-                _dst.pop_back();
+                SFileSegment& last = _segments.back();
+                while( last.size > 0 && 0 == last.data[last.size - 1] )
+                {
+                    --last.size;
+                }
+
+                if( last.size > 0 )
+                {
+                    break;
+                }
+                _segments.pop_back();
             }
         }
 
@@ -99,6 +99,7 @@ public:
     SFileInfo GetFileInfo( size_t _fileIdx );
 
     bool ExtractFile( string _fileName, vector<unsigned char>& _dst );
+    bool ExtractFileSegments( string _fileName, vector<SFileSegment>& _segments, vector<unsigned char>& _buffer );
     bool InsertFile ( string _fileName, const vector<unsigned char>& src, bool _binaryFile );
     bool RemoveFile ( string _fileName );
 
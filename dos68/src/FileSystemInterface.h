@@ -23,6 +23,7 @@
 #include <string>
 #include <vector>
 #include "DiskImageInterface.h"
+#include "../../common/FileSegments.h"
 
 using namespace std;
 
@@ -86,6 +87,26 @@ public:
     virtual const CDirectoryEntryWrapper& GetFSRoot() const = 0;
 
     virtual bool ExtractFile( string _fileName, vector<unsigned char>& dst )       { return false; }
+    // Describes the contents of a file as a list of segments, in order, without copying them.
+    // Segments point into the disk image where possible and stay valid until it's modified or
+    // _buffer is changed. By default the file is extracted into _buffer as a single segment.
+    virtual bool ExtractFileSegments( string _fileName, vector<SFileSegment>& _segments, vector<unsigned char>& _buffer )
+    {
+        _segments.clear();
+        _buffer.clear();
+
+        if( !ExtractFile( _fileName, _buffer ) )
+        {
+            return false;
+        }
+
+        if( !_buffer.empty() )
+        {
+            _segments.push_back( { _buffer.data(), _buffer.size() } );
+        }
+
+        return true;
+    }
     virtual bool InsertFile ( string _fileName, const vector<unsigned char>& src ) { return false; }
 
     virtual bool NeedManualSetup() { return false; }
@@ -79,6 +79,18 @@ bool HelpCommand()
 	std::cout << "\t  Inserts a binary file into the requested disk image." << std::endl << std::endl;
 	std::cout << "\tinsertData <image filename> <filename to insert>" << std::endl;
 	std::cout << "\t  Inserts a data file into the requested disk image." << std::endl << std::endl;
+	std::cout << "\tinsert <image filename> [--many] <filename to insert> [<filename to insert> ...]" << std::endl;
+	std::cout << "\t  Inserts files into the requested disk image, picking the type from the extension:" << std::endl;
+	std::cout << "\t  .BAS files are tokenized, .BIN files keep their DragonDOS header and anything" << std::endl;
+	std::cout << "\t  else is inserted as data. A .BIN file without a header needs its addresses" << std::endl;
+	std::cout << "\t  after the filename, as file.bin@load,exec, which also override a header." << std::endl;
+	std::cout << "\t  With --many, all the files are inserted in a single pass, and only if all" << std::endl;
+	std::cout << "\t  of them fit." << std::endl << std::endl;
+	std::cout << "\tdefrag <image filename> [-plan]" << std::endl;
+	std::cout << "\t  Moves every file to a contiguous run of sectors near the directory track" << std::endl;
+	std::cout << "\t  and compacts the directory, reporting the fragmentation before and after." << std::endl;
+	std::cout << "\t  With -plan, only the report is shown and the disk image is not modified." << std::endl;
+	std::cout << "\t  A backup copy of the disk image will be created." << std::endl << std::endl;
 	std::cout << "\tlistimages" << std::endl;
 	std::cout << "\t  Displays a list of the available disk image formats and their" << std::endl;
 	std::cout << "\t  indices, to be used with the commands that require them." << std::endl << std::endl;
@@ -112,7 +124,7 @@ bool ListCommand( const std::vector<std::string>& _args, DiskImageFactory& _disk
 	// Display file list
 	for( size_t fileIdx = 0; fileIdx < fs.GetFilesNum(); ++fileIdx )
 	{
-		CDGNDosFile ddosFile = fs.GetFile((unsigned short int)fileIdx);
+		const CDGNDosFile& ddosFile = fs.GetFile((unsigned short int)fileIdx);
 		SFileInfo fi = fs.GetFileInfo( fileIdx );
 		std::cout << fileIdx << "\t" << PadFilename(fi.name) << "\t" <<  fs.GetFileSize(fileIdx) << std::hex;
 		std::cout << "\tLoad: 0x" << ddosFile.GetLoadAddress() << "\tExec: 0x" << ddosFile.GetExecAddress() << std::dec << std::endl;
@@ -182,12 +194,15 @@ bool ExtractCommand( const std::vector<std::string>& _args, DiskImageFactory& _d
 		return false;
 	}
 
+	std::vector<SFileSegment> segments;
+	std::vector<unsigned char> fileData;
+
 	for( size_t fileIdx = start; fileIdx < end; ++fileIdx )
 	{
-		std::vector<unsigned char> fileData;
 		SFileInfo fi = fs.GetFileInfo( fileIdx );
 
-		if( !fs.ExtractFile( fi.name, fileData, withBinaryHeader ) )
+		// The file data is written straight from the disk image.
+		if( !fs.ExtractFileSegments( fi.name, segments, fileData, withBinaryHeader ) )
 		{
 			std::cout << "The requested file couldn't be found. The disk image may be damaged or corrupted." << std::endl;
 			delete img;
@@ -204,42 +219,45 @@ bool ExtractCommand( const std::vector<std::string>& _args, DiskImageFactory& _d
 
 		// Detokenize BASIC
 		size_t bytesWritten = 0;
-		SDGNDosDirectoryEntry entry = fs.GetDirectory()[fileIdx];
-		if( entry.fileType == DRAGONDOS_FILETYPE_BASIC  )
+		size_t dataSize = 0;
+		if( fs.GetFile( (unsigned short int)fileIdx ).GetFileType() == DRAGONDOS_FILETYPE_BASIC  )
 		{
+			std::vector<unsigned char> basicData;
+			basicData.reserve( GetSegmentsSize( segments ) );
+			for( const SFileSegment& segment : segments )
+			{
+				basicData.insert( basicData.end(), segment.data, segment.data + segment.size );
+			}
+
 			std::stringstream strStream;
-			std::stringstream clrStream;
 			std::string textColors;
 			unsigned short int programStart = DRAGONDOS_BASIC_PROGRAM_START;
 
-			DragonDOS_BASIC::Decode( fileData, strStream, textColors, programStart, false, false );
+			DragonDOS_BASIC::Decode( basicData, strStream, textColors, programStart, false, false );
 
-			bytesWritten = fwrite( strStream.str().c_str(), 1, strStream.str().length(), pOut );
-			fclose( pOut );
+			std::string text = strStream.str();
+			dataSize = text.length();
+			bytesWritten = fwrite( text.c_str(), 1, dataSize, pOut );
 		}
 		else
 		{
-			size_t bytesWritten = fwrite( fileData.data(), 1, fileData.size(), pOut );
-			fclose( pOut );
-
-			if( bytesWritten != fileData.size() )
-			{
-				std::cout << "Error writing file " << fi.name.c_str() << " " << bytesWritten;
-				std::cout << " of " << fileData.size() << " bytes written." << std::endl;
-				continue;
-			}
+			dataSize = GetSegmentsSize( segments );
+			bytesWritten = WriteFileSegments( pOut, segments );
 		}
 
-		fclose( pOut );
+		if( 0 != fclose( pOut ) )
+		{
+			bytesWritten = 0;
+		}
 
-		if( bytesWritten != fileData.size() )
+		if( bytesWritten != dataSize )
 		{
-			std::cout << "Error writing file " << fi.name << " " << bytesWritten << " of " << fileData.size() << " bytes written." << std::endl;
+			std::cout << "Error writing file " << fi.name << " " << bytesWritten << " of " << dataSize << " bytes written." << std::endl;
 			delete img;
 			return false;
 		}
 
-		std::cout << fileIdx << "\t" << PadFilename(fi.name) << "\t" << bytesWritten << " of " << fileData.size() << " bytes written." << std::endl;
+		std::cout << fileIdx << "\t" << PadFilename(fi.name) << "\t" << bytesWritten << " of " << dataSize << " bytes written." << std::endl;
 	}
 
 	delete img;
@@ -451,6 +469,21 @@ bool DeleteCommand( const std::vector<std::string>& _args, DiskImageFactory& _di
 	return true;
 }
 
+// Parses a load or exec address given in decimal or hex (starting with 0x).
+bool ParseAddress( const std::string& _arg, const char* _addressName, unsigned short int& _address )
+{
+	char* parseEnd = nullptr;
+	unsigned long int parsedAddress = strtoul( _arg.c_str(), &parseEnd, 0 );
+	if( _arg.empty() || *parseEnd != 0 || parsedAddress > 0xFFFF )
+	{
+		std::cout << "Invalid " << _addressName << " address " << _arg << std::endl << "Valid range is 0 to 65535 (0xFFFF)" << std::endl;
+		return false;
+	}
+
+	_address = (unsigned short int)parsedAddress;
+	return true;
+}
+
 bool InsertBasicCommand( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory )
 {
 	// Check arguments
@@ -514,26 +547,7 @@ bool InsertBasicCommand( const std::vector<std::string>& _args, DiskImageFactory
 	}
 
 	std::vector<unsigned char> encodedData; 
-	
-	// Add file header /////////////////////////////////
-	// For BASIC files, load address is usually always 
-	// 0x2401 and the exec address 0x8B8D
-	////////////////////////////////////////////////////
-	encodedData.push_back( DRAGONDOS_FILE_HEADER_BEGIN ); // Constant
-	encodedData.push_back( DRAGONDOS_FILETYPE_BASIC    ); // File type
-	encodedData.push_back( 0x24                        ); // Load address high byte
-	encodedData.push_back( 0x01                        ); // Load address low byte
-	encodedData.push_back( 0x00                        ); // File size high byte (updated below)
-	encodedData.push_back( 0x00                        ); // File size low byte (updated below)
-	encodedData.push_back( 0x8B                        ); // Exec address high byte
-	encodedData.push_back( 0x8D                        ); // Exec address low byte
-	encodedData.push_back( DRAGONDOS_FILE_HEADER_END   ); // Constant
-	////////////////////////////////////////////////////
-
-	DragonDOS_BASIC::Encode( fileData, encodedData );
-
-	encodedData[4] = (encodedData.size() / 256) & 0xFF;
-	encodedData[5] = encodedData.size() & 0xFF;
+	EncodeBasicFile( fileData, encodedData );
 
 	// Check if there's enough room on the disk for the file to be inserted.
 	size_t freeBytes = fs.GetFreeSize();
@@ -651,46 +665,16 @@ bool InsertBinaryCommand( const std::vector<std::string>& _args, DiskImageFactor
 		return false;
 	}
 
-	// Get or override Load address
-	if( _args.size() > 4 )
+	// Get or override Load and Exec addresses
+	if( (_args.size() > 4 && !ParseAddress( _args[4], "load", loadAddress )) ||
+		(_args.size() > 5 && !ParseAddress( _args[5], "exec", execAddress )) )
 	{
-		unsigned long int parsedLoadAddress = strtoul( _args[4].c_str(), nullptr, 0 );
-		if( parsedLoadAddress > 0xFFFF )
-		{
-			std::cout << "Out of range load address " << parsedLoadAddress << std::endl << "Valid range is 0 to 65535 (0xFFFF)" << std::endl;
-			delete img;
-			return false;
-		}
-		loadAddress = (unsigned short int)parsedLoadAddress;
+		delete img;
+		return false;
 	}
 
-	// Get or override Load address
-	if( _args.size() > 5 )
-	{
-		unsigned long int parsedExecAddress = strtoul( _args[5].c_str(), nullptr, 0 );
-		if( parsedExecAddress > 0xFFFF )
-		{
-			std::cout << "Out of range exec address " << parsedExecAddress << std::endl << "Valid range is 0 to 65535 (0xFFFF)" << std::endl;
-			delete img;
-			return false;
-		} 
-		execAddress = (unsigned short int)parsedExecAddress;
-	}
-
-	// Add or update file header ///////////////////////
-	// For BASIC files, load address is usually always 
-	// 0x2401 and the exec address 0x8B8D
-	////////////////////////////////////////////////////
-	fileData[0] = DRAGONDOS_FILE_HEADER_BEGIN;      // Constant
-	fileData[1] = DRAGONDOS_FILETYPE_BINARY;        // File type
-	fileData[2] = (loadAddress / 256) & 0xFF;       // Load address high byte
-	fileData[3] = loadAddress & 0xFF;               // Load address low byte
-	fileData[4] = (insertFileSize / 256) & 0xFF;    // File size high byte
-	fileData[5] = insertFileSize & 0xFF;            // File size low byte
-	fileData[6] = (execAddress / 256) & 0xFF;       // Exec address high byte
-	fileData[7] = execAddress & 0xFF;               // Exec address low byte
-	fileData[8] = DRAGONDOS_FILE_HEADER_END;        // Constant
-	////////////////////////////////////////////////////
+	// Add or update file header
+	WriteFileHeader( fileData.data(), DRAGONDOS_FILETYPE_BINARY, loadAddress, dataSize - DRAGONDOS_FILEHEADER_SIZE, execAddress );
 
 	std::filesystem::path filePath( _args[3] );
 
@@ -808,6 +792,298 @@ bool InsertDataCommand( const std::vector<std::string>& _args, DiskImageFactory&
 	return true;
 }
 
+// Loads a file to be inserted by the insert command, preparing it for its type.
+// BASIC files are tokenized and binary files get a DragonDOS header if they don't have one.
+// Load and exec addresses for a binary file can be given as file.bin@load,exec, and
+// they're required if the file has no header.
+bool LoadFileToInsert( const std::string& _fileArg, SDGNDosNewFile& _file )
+{
+	// Split the addresses off, unless the @ is part of an existing file's name.
+	std::string filename = _fileArg;
+	std::string addresses;
+	size_t atPos = _fileArg.rfind( '@' );
+	if( std::string::npos != atPos && !std::filesystem::exists( _fileArg ) )
+	{
+		filename  = _fileArg.substr( 0, atPos );
+		addresses = _fileArg.substr( atPos + 1 );
+	}
+
+	std::filesystem::path filePath( filename );
+	std::string extension = filePath.extension().string();
+	std::transform( extension.begin(), extension.end(), extension.begin(), ::toupper );
+
+	bool bBinary = (0 == extension.compare(".BIN"));
+	bool hasAddresses = !addresses.empty();
+	unsigned short int loadAddress = 0;
+	unsigned short int execAddress = 0;
+
+	if( hasAddresses )
+	{
+		size_t commaPos = addresses.find( ',' );
+		if( !bBinary || std::string::npos == commaPos )
+		{
+			std::cout << "Addresses can only be given to .BIN files, as file.bin@load,exec (" << _fileArg << ")." << std::endl;
+			return false;
+		}
+
+		if( !ParseAddress( addresses.substr( 0, commaPos ), "load", loadAddress ) ||
+			!ParseAddress( addresses.substr( commaPos + 1 ), "exec", execAddress ) )
+		{
+			return false;
+		}
+	}
+
+	FILE* pIn = fopen( filename.c_str(), "rb" );
+	if( nullptr == pIn )
+	{
+		std::cout << "Could not open requested file " << filename << std::endl;
+		return false;
+	}
+
+	fseek( pIn, 0, SEEK_END );
+	size_t insertFileSize = ftell( pIn );
+	fseek( pIn, 0, SEEK_SET );
+
+	_file.fileName = filePath.filename().string();
+	_file.data.clear();
+
+	bool hasHeader = false;
+	if( bBinary )
+	{
+		unsigned short int headerLoadAddress = 0;
+		unsigned short int headerExecAddress = 0;
+		hasHeader = GetBinaryFileHeaderParams( pIn, insertFileSize, headerLoadAddress, headerExecAddress );
+
+		if( !hasHeader && !hasAddresses )
+		{
+			fclose( pIn );
+			std::cout << filename << " has no DragonDOS header. Give its load and exec addresses as ";
+			std::cout << filename << "@load,exec" << std::endl;
+			return false;
+		}
+
+		if( !hasAddresses )
+		{
+			loadAddress = headerLoadAddress;
+			execAddress = headerExecAddress;
+		}
+	}
+
+	size_t dataStart = (bBinary && !hasHeader) ? DRAGONDOS_FILEHEADER_SIZE : 0;
+	std::vector<unsigned char> fileData( dataStart + insertFileSize );
+	size_t bytesRead = fread( fileData.data() + dataStart, 1, insertFileSize, pIn );
+	fclose( pIn );
+
+	if( bytesRead < insertFileSize )
+	{
+		std::cout << "Error loading file " << filename << " (" << bytesRead << " of ";
+		std::cout << insertFileSize << " bytes read)." << std::endl;
+		return false;
+	}
+
+	if( 0 == extension.compare(".BAS") )
+	{
+		std::vector<char> basicText( fileData.begin(), fileData.end() );
+		EncodeBasicFile( basicText, _file.data );
+	}
+	else
+	{
+		if( bBinary )
+		{
+			WriteFileHeader( fileData.data(), DRAGONDOS_FILETYPE_BINARY, loadAddress, fileData.size() - DRAGONDOS_FILEHEADER_SIZE, execAddress );
+		}
+
+		_file.data.swap( fileData );
+	}
+
+	if( _file.data.size() > DRAGONDOS_MAX_FILE_SIZE )
+	{
+		std::cout << "Cannot insert file " << filename << ", size is greater than 65535 bytes." << std::endl;
+		return false;
+	}
+
+	return true;
+}
+
+bool InsertCommand( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory )
+{
+	bool bMany = (_args.size() > 3) && (0 == _args[3].compare("--many"));
+	size_t firstFileArg = bMany ? 4 : 3;
+
+	// Check arguments
+	if( _args.size() <= firstFileArg || (!bMany && _args.size() > 4) )
+	{
+		std::cout << "The Insert command requires a disk image filename and the filename of the file to insert." << std::endl;
+		std::cout << "To insert several files in a single pass, put --many before their filenames." << std::endl << std::endl;
+		std::cout << "Examples:" << std::endl;
+		std::cout << "\tdragondos insert mydisk.vdk program.bas" << std::endl;
+		std::cout << "\tdragondos insert mydisk.vdk --many program.bas game.bin scores.dat" << std::endl;
+		std::cout << "\tdragondos insert mydisk.vdk --many program.bas raw.bin@0x3000,0x3000" << std::endl << std::endl;
+
+		HelpCommand();
+
+		return false;
+	}
+
+	// Load disk image and initialize file system
+	IDiskImageInterface* img;
+	CDragonDOS_FS fs;
+
+	if( !LoadImageAndFilesystem( _args[2], img, &fs, _diskFactory ) )
+	{
+		return false;
+	}
+
+	// Load files to be inserted
+	std::vector<SDGNDosNewFile> files( _args.size() - firstFileArg );
+	size_t totalSize = 0;
+
+	for( size_t fileIdx = 0; fileIdx < files.size(); ++fileIdx )
+	{
+		if( !LoadFileToInsert( _args[firstFileArg + fileIdx], files[fileIdx] ) )
+		{
+			delete img;
+			return false;
+		}
+
+		totalSize += files[fileIdx].data.size();
+	}
+
+	// Check if there's enough room on the disk for the files to be inserted.
+	size_t freeBytes = fs.GetFreeSize();
+	if( totalSize > freeBytes )
+	{
+		std::cout << "Not enough room to insert " << files.size() << " file(s). Another " << totalSize - freeBytes << " bytes are needed." << std::endl;
+		delete img;
+		return false;
+	}
+
+	// Create backup file
+	std::string backupFilename = _args[2];
+	backupFilename += ".bak";
+	if( !fs.GetDisk()->Save( backupFilename ) )
+	{
+		std::cout << "Could not create backup file " << backupFilename << std::endl;
+		delete img;
+		return false;
+	}
+
+	if( !fs.InsertFiles( files ) )
+	{
+		std::cout << "The requested files couldn't be inserted. Please check that the file names are correct." << std::endl;
+		std::cout << "The disk image may not have enough free space or directory entries or be damaged or corrupted." << std::endl;
+		delete img;
+		return false;
+	}
+
+	// Save modified disk image
+	if( !fs.GetDisk()->Save( _args[2] ) )
+	{
+		std::cout << "Could not overwrite file " << _args[2] << std::endl;
+		delete img;
+		return false;
+	}
+
+	delete img;
+	return true;
+}
+
+void PrintFragmentationInfo( const SDGNDosFragmentationInfo& _info )
+{
+	std::cout << "\tFiles: " << _info.filesNum << " (" << _info.fragmentedFilesNum << " fragmented, ";
+	std::cout << _info.extentsNum << " runs of sectors, " << _info.continuationEntriesNum << " continuation entries)" << std::endl;
+	std::cout << "\tFree space: " << _info.freeSectorsNum << " sectors in " << _info.freeRunsNum << " runs, largest run ";
+	std::cout << _info.largestFreeRun << " sectors" << std::endl;
+	std::cout << "\tAverage distance to directory track: " << _info.averageDirDistance << " tracks" << std::endl;
+	std::cout << "\tFragmentation score: " << _info.score << "%" << std::endl;
+}
+
+bool DefragCommand( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory )
+{
+	// Check arguments
+	if( _args.size() < 3 )
+	{
+		std::cout << "The Defrag command requires a disk image filename." << std::endl;
+		std::cout << "Optionally, the -plan flag shows what would be done without modifying the disk image." << std::endl << std::endl;
+		std::cout << "Examples:" << std::endl;
+		std::cout << "\tdragondos defrag mydisk.vdk" << std::endl;
+		std::cout << "\tdragondos defrag mydisk.vdk -plan" << std::endl << std::endl;
+
+		HelpCommand();
+
+		return false;
+	}
+
+	bool bPlanOnly = (_args.size() > 3) && (0 == _args[3].compare("-plan"));
+
+	// Load disk image and initialize file system
+	IDiskImageInterface* img;
+	CDragonDOS_FS fs;
+
+	if( !LoadImageAndFilesystem( _args[2], img, &fs, _diskFactory ) )
+	{
+		return false;
+	}
+
+	SDGNDosFragmentationInfo before;
+	SDGNDosFragmentationInfo after;
+
+	if( !fs.GetFragmentationInfo( before ) || !fs.Defragment( true, after ) )
+	{
+		std::cout << "Could not plan the defragmentation of " << _args[2] << "." << std::endl;
+		std::cout << "The disk image may be damaged or corrupted." << std::endl;
+		delete img;
+		return false;
+	}
+
+	std::cout << "Current layout:" << std::endl;
+	PrintFragmentationInfo( before );
+
+	if( !CDragonDOS_FS::DefragmentGains( before, after ) )
+	{
+		std::cout << "Defragmenting wouldn't improve " << _args[2] << ", so it's left as it is." << std::endl;
+		delete img;
+		return true;
+	}
+
+	std::cout << (bPlanOnly ? "After defragmenting:" : "New layout:") << std::endl;
+	PrintFragmentationInfo( after );
+
+	if( bPlanOnly )
+	{
+		delete img;
+		return true;
+	}
+
+	// Create backup file
+	std::string backupFilename = _args[2];
+	backupFilename += ".bak";
+	if( !fs.GetDisk()->Save( backupFilename ) )
+	{
+		std::cout << "Could not create backup file " << backupFilename << std::endl;
+		delete img;
+		return false;
+	}
+
+	if( !fs.Defragment( false, after ) )
+	{
+		std::cout << "The disk image couldn't be defragmented. It may be damaged or corrupted." << std::endl;
+		delete img;
+		return false;
+	}
+
+	// Save modified disk image
+	if( !fs.GetDisk()->Save( _args[2] ) )
+	{
+		std::cout << "Could not overwrite file " << _args[2] << std::endl;
+		delete img;
+		return false;
+	}
+
+	delete img;
+	return true;
+}
+
 bool ListImagesCommand( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory )
 {
 	for( size_t imageIdx = 0; imageIdx < _diskFactory.Size(); ++imageIdx )
@@ -17,6 +17,8 @@ bool DeleteCommand       ( const std::vector<std::string>& _args, DiskImageFacto
 bool InsertBasicCommand  ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
 bool InsertBinaryCommand ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
 bool InsertDataCommand   ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
+bool InsertCommand       ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
+bool DefragCommand       ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
 bool ListImagesCommand   ( const std::vector<std::string>& _args, DiskImageFactory& _diskFactory );
 
 #endif
\ No newline at end of file
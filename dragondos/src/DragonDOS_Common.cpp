@@ -7,6 +7,7 @@
 ////////////////////////////////////////////////////////////////////
 
 #include "DragonDOS_Common.h"
+#include "DragonDOS_BASIC.h"
 #include "../../common/FileSystems/DragonDOS_FS.h"
 
 // Returns true and sets loadAddress and execAddress if the file contains the DragonDOS header, false otherwise.
@@ -37,3 +38,28 @@ bool GetBinaryFileHeaderParams( FILE* file, size_t fileSize, unsigned short int&
 
 	return true;
 }
+
+// Writes the DRAGONDOS_FILEHEADER_SIZE bytes of a DragonDOS file header to _dst.
+void WriteFileHeader( unsigned char* _dst, unsigned char _fileType, unsigned short int _loadAddress, size_t _fileSize, unsigned short int _execAddress )
+{
+	_dst[0] = DRAGONDOS_FILE_HEADER_BEGIN;      // Constant
+	_dst[1] = _fileType;                        // File type
+	_dst[2] = (_loadAddress / 256) & 0xFF;      // Load address high byte
+	_dst[3] = _loadAddress & 0xFF;              // Load address low byte
+	_dst[4] = (_fileSize / 256) & 0xFF;         // File size high byte
+	_dst[5] = _fileSize & 0xFF;                 // File size low byte
+	_dst[6] = (_execAddress / 256) & 0xFF;      // Exec address high byte
+	_dst[7] = _execAddress & 0xFF;              // Exec address low byte
+	_dst[8] = DRAGONDOS_FILE_HEADER_END;        // Constant
+}
+
+// Tokenizes an ASCII BASIC listing into _dst, behind a DragonDOS file header.
+// For BASIC files, load address is usually always 0x2401 and the exec address 0x8B8D.
+void EncodeBasicFile( const std::vector<char>& _text, std::vector<unsigned char>& _dst )
+{
+	_dst.assign( DRAGONDOS_FILEHEADER_SIZE, 0 );
+
+	DragonDOS_BASIC::Encode( _text, _dst );
+
+	WriteFileHeader( _dst.data(), DRAGONDOS_FILETYPE_BASIC, 0x2401, _dst.size(), 0x8B8D );
+}
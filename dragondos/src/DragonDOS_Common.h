@@ -8,5 +8,8 @@
 ////////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <vector>
 
 bool GetBinaryFileHeaderParams( FILE* file, size_t fileSize, unsigned short int& loadAddress, unsigned short int& execAddress );
+void WriteFileHeader( unsigned char* _dst, unsigned char _fileType, unsigned short int _loadAddress, size_t _fileSize, unsigned short int _execAddress );
+void EncodeBasicFile( const std::vector<char>& _text, std::vector<unsigned char>& _dst );
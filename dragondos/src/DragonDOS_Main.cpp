@@ -8,6 +8,7 @@
 #include "../../common/DiskImages/JVCDiskImage.h"
 #include "../../common/DiskImages/IMDDiskImage.h"
 #include "../../common/DiskImages/RawDiskImage.h"
+#include "../../common/DiskImages/EDSKDiskImage.h"
 
 // File systems
 #include "../../common/FileSystems/DragonDOS_FS.h"
@@ -29,6 +30,8 @@ bool ProcessCommand( const std::vector<std::string> _args, DiskImageFactory& _di
     else if( 0 == command.compare("insertbasic") ) return InsertBasicCommand ( _args, _diskFactory );
     else if( 0 == command.compare("insertbinary")) return InsertBinaryCommand( _args, _diskFactory );
     else if( 0 == command.compare("insertdata")  ) return InsertDataCommand  ( _args, _diskFactory );
+    else if( 0 == command.compare("insert")      ) return InsertCommand      ( _args, _diskFactory );
+    else if( 0 == command.compare("defrag")      ) return DefragCommand      ( _args, _diskFactory );
     else if( 0 == command.compare("listimages")  ) return ListImagesCommand  ( _args, _diskFactory );
 
     HelpCommand();
@@ -51,6 +54,13 @@ int main( int argc, char** argv )
 	diskFactory.RegisterDiskImageFormat( new CIMDDiskImage );
 	diskFactory.RegisterDiskImageFormat( new CRAWDiskImage );
 
+	// EDSK images are read a track at a time as the commands need them, which
+	// for most of them is just the directory track. New ones get an Offset-Info block.
+	CEDSKDiskImage* edskImage = new CEDSKDiskImage;
+	edskImage->SetLazyLoad( true );
+	edskImage->SetWriteOffsetInfo( true );
+	diskFactory.RegisterDiskImageFormat( edskImage );
+
     std::vector<std::string> args;
     args.insert( args.begin(), argv, &argv[argc] );
 
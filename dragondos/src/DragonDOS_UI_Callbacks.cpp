@@ -67,7 +67,7 @@ void UpdateUI( const SDRAGONDOS_Context* _context )
 		uint16_t fileSectors = (uint16_t)(pFS->GetFileSize(fileIdx)/pDisk->GetSectorSize());
 		fileSectors += (pFS->GetFileSize(fileIdx)%pDisk->GetSectorSize() != 0) ? 1 : 0;
 
-		CDGNDosFile ddosFile = pFS->GetFile((unsigned short int)fileIdx);
+		const CDGNDosFile& ddosFile = pFS->GetFile((unsigned short int)fileIdx);
 		std::string fileType = pFS->GetFileTypeString((unsigned short int)fileIdx);
 		fileType += ' '; // padding
 
@@ -408,26 +408,7 @@ void insertBasic_cb(Fl_Widget* pWidget,void* _context)
 		fclose( pIn );
 
 		std::vector<unsigned char> encodedData; 
-		
-		// Add file header /////////////////////////////////
-		// For BASIC files, load address is usually always 
-		// 0x2401 and the exec address 0x8B8D
-		////////////////////////////////////////////////////
-		encodedData.push_back( DRAGONDOS_FILE_HEADER_BEGIN ); // Constant
-		encodedData.push_back( DRAGONDOS_FILETYPE_BASIC    ); // File type
-		encodedData.push_back( 0x24                        ); // Load address high byte
-		encodedData.push_back( 0x01                        ); // Load address low byte
-		encodedData.push_back( 0x00                        ); // File size high byte (updated below)
-		encodedData.push_back( 0x00                        ); // File size low byte (updated below)
-		encodedData.push_back( 0x8B                        ); // Exec address high byte
-		encodedData.push_back( 0x8D                        ); // Exec address low byte
-		encodedData.push_back( DRAGONDOS_FILE_HEADER_END   ); // Constant
-		////////////////////////////////////////////////////
-
-		DragonDOS_BASIC::Encode( fileData, encodedData );
-
-		encodedData[4] = (encodedData.size() / 256) & 0xFF;
-		encodedData[5] = encodedData.size() & 0xFF;
+		EncodeBasicFile( fileData, encodedData );
 
 		std::filesystem::path filePath( file );
 		fs->InsertFile( filePath.filename().string(), encodedData, true );
@@ -507,20 +488,7 @@ void insertBinary_cb(Fl_Widget* pWidget,void* _context)
 		{
 			AskLoadAndExecAddresses( pContext->loadAddress, pContext->execAddress );
 
-			// Add file header /////////////////////////////////
-			// For BASIC files, load address is usually always 
-			// 0x2401 and the exec address 0x8B8D
-			////////////////////////////////////////////////////
-			fileData[0] = DRAGONDOS_FILE_HEADER_BEGIN;          // Constant
-			fileData[1] = DRAGONDOS_FILETYPE_BINARY;            // File type
-			fileData[2] = (pContext->loadAddress / 256) & 0xFF; // Load address high byte
-			fileData[3] = pContext->loadAddress & 0xFF;         // Load address low byte
-			fileData[4] = (insertFileSize / 256) & 0xFF;        // File size high byte
-			fileData[5] = insertFileSize & 0xFF;                // File size low byte
-			fileData[6] = (pContext->execAddress / 256) & 0xFF; // Exec address high byte
-			fileData[7] = pContext->execAddress & 0xFF;         // Exec address low byte
-			fileData[8] = DRAGONDOS_FILE_HEADER_END;            // Constant
-			////////////////////////////////////////////////////
+			WriteFileHeader( fileData.data(), DRAGONDOS_FILETYPE_BINARY, pContext->loadAddress, insertFileSize, pContext->execAddress );
 		}
 
 		std::filesystem::path filePath( file );
@@ -21,6 +21,7 @@
 #include "../../common/DiskImages/JVCDiskImage.h"
 #include "../../common/DiskImages/IMDDiskImage.h"
 #include "../../common/DiskImages/RawDiskImage.h"
+#include "../../common/DiskImages/EDSKDiskImage.h"
 
 // File systems
 #include "../../common/FileSystems/DragonDOS_FS.h"
@@ -280,6 +281,12 @@ int main( int argc, char** argv )
 	diskFactory.RegisterDiskImageFormat( new CJVCDiskImage );
 	diskFactory.RegisterDiskImageFormat( new CIMDDiskImage );
 	diskFactory.RegisterDiskImageFormat( new CRAWDiskImage );
+
+	// Only the tracks that are used get read, and new images get an Offset-Info block.
+	CEDSKDiskImage* edskImage = new CEDSKDiskImage;
+	edskImage->SetLazyLoad( true );
+	edskImage->SetWriteOffsetInfo( true );
+	diskFactory.RegisterDiskImageFormat( edskImage );
 	context.diskImageFactory = &diskFactory;
 
     CDragonDOS_FS fs;
@@ -339,7 +339,7 @@ void CDragonDOSViewFileWindow::SetData( const CDragonDOS_FS* _fs, const std::vec
 			fileHeader.append( DRAGONDOSVFW_FILE_HEADER_FILLER_NUM, '-' );
 		}
 
-		const CDGNDosFile ddosFile = _fs->GetFile((unsigned short int)file);
+		const CDGNDosFile& ddosFile = _fs->GetFile((unsigned short int)file);
 
 		std::vector<unsigned char> fileData;
 		_fs->ExtractFile        ( fileName, fileData, false );
@@ -12,13 +12,156 @@
 #include <iostream>
 #include <cstring>
 #include <algorithm>
+#include <sstream>
+#include <fstream>
+#include <map>
+#include <filesystem>
+#include <thread>
+#include <atomic>
 #include "dskfile.h"
 #include "../common/crc.h"
 
 using namespace std;
 
-// Compare disk images and show output to the console
-bool Compare( CDSKFile& disk1, CDSKFile& disk2, bool _verbose )
+// Calls _job(0) to _job(_jobsNum - 1) from a pool of threads, one per core.
+// Jobs are started in index order. Once a job returns false, jobs after the lowest
+// failing one are skipped, but every job before it is still run.
+template< typename TJob >
+void RunOnWorkers( size_t _jobsNum, TJob _job )
+{
+    atomic<size_t> nextJob( 0 );
+    atomic<size_t> firstFailed( _jobsNum );
+
+    auto worker = [&]()
+    {
+        for( size_t idx = nextJob++; idx < _jobsNum; idx = nextJob++ )
+        {
+            // Indices only grow, so nothing left for this worker can be needed.
+            if( idx > firstFailed )
+            {
+                break;
+            }
+
+            if( !_job( idx ) )
+            {
+                size_t failed = firstFailed;
+                while( idx < failed && !firstFailed.compare_exchange_weak( failed, idx ) )
+                {
+                }
+            }
+        }
+    };
+
+    size_t threadsNum = max( 1u, thread::hardware_concurrency() );
+    threadsNum = min( threadsNum, _jobsNum );
+
+    vector<thread> workers;
+    for( size_t workerIdx = 1; workerIdx < threadsNum; ++workerIdx )
+    {
+        workers.push_back( thread( worker ) );
+    }
+    worker();
+
+    for( auto& workerThread : workers )
+    {
+        workerThread.join();
+    }
+}
+
+// Compares one track of both disks. Messages are written to _out so that tracks
+// compared in parallel can be shown in order afterwards.
+bool CompareTrack( const CDSKFile_TrackInfoBlock& _track1, const CDSKFile_TrackInfoBlock& _track2, int _side, size_t _track, bool _verbose, bool _firstDiff, ostream& _out )
+{
+    bool retVal = true;
+
+    // 3 - Number of sectors
+    if( _track1.sectorsNum != _track2.sectorsNum )
+    {
+        if( _verbose )
+        {
+            _out << "Disks side " << _side << ", track " << _track << " have different number of sectors. ";
+            _out << (int)_track1.sectorsNum << " vs " << (int)_track2.sectorsNum << "." << endl;
+        }
+        retVal = false;
+    }
+
+    // 4 - Sector info and data
+    size_t sectorsNum = _track1.sectorsNum;
+
+    for( size_t sector = 0; sector < sectorsNum; ++sector )
+    {
+        if( !retVal && _firstDiff )
+        {
+            break;
+        }
+
+        // Sector info
+        if( sector >= _track1.sectorInfoList.size() ||
+            sector >= _track2.sectorInfoList.size() )
+        {
+            continue;
+        }
+
+        if( _track1.sectorInfoList[sector].track      != _track2.sectorInfoList[sector].track      ||
+            _track1.sectorInfoList[sector].side       != _track2.sectorInfoList[sector].side       ||
+            _track1.sectorInfoList[sector].sectorID   != _track2.sectorInfoList[sector].sectorID   ||
+            _track1.sectorInfoList[sector].sectorSize != _track2.sectorInfoList[sector].sectorSize ||
+            _track1.sectorInfoList[sector].FDCStatus1 != _track2.sectorInfoList[sector].FDCStatus1 ||
+            _track1.sectorInfoList[sector].FDCStatus2 != _track2.sectorInfoList[sector].FDCStatus2 ||
+            _track1.sectorInfoList[sector].dataLength != _track2.sectorInfoList[sector].dataLength )
+        {
+            if( _verbose )
+            {
+                _out << "Disks side " << _side << ", track " << _track << ", sector " << sector;
+                _out << " have different sector info. " << endl;
+                _out << "> track      " << (int)_track1.sectorInfoList[sector].track      << " vs " << (int)_track2.sectorInfoList[sector].track      << endl;
+                _out << "  side       " << (int)_track1.sectorInfoList[sector].side       << " vs " << (int)_track2.sectorInfoList[sector].side       << endl;
+                _out << "  sectorID   " << (int)_track1.sectorInfoList[sector].sectorID   << " vs " << (int)_track2.sectorInfoList[sector].sectorID   << endl;
+                _out << "  sectorSize " << (int)_track1.sectorInfoList[sector].sectorSize << " vs " << (int)_track2.sectorInfoList[sector].sectorSize << endl;
+                _out << "  FDCStatus1 " << (int)_track1.sectorInfoList[sector].FDCStatus1 << " vs " << (int)_track2.sectorInfoList[sector].FDCStatus1 << endl;
+                _out << "  FDCStatus2 " << (int)_track1.sectorInfoList[sector].FDCStatus2 << " vs " << (int)_track2.sectorInfoList[sector].FDCStatus2 << endl;
+                _out << "  dataLength " << (int)_track1.sectorInfoList[sector].dataLength << " vs " << (int)_track2.sectorInfoList[sector].dataLength << endl;
+            }
+            retVal = false;
+        }
+
+        // Sector data
+        size_t sector1len = _track1.sectorData[sector].size();
+        size_t sector2len = _track2.sectorData[sector].size();
+        if( sector1len != sector2len )
+        {
+            if( _verbose )
+            {
+                _out << "Disks side " << _side << ", track " << _track << ", sector " << sector;
+                _out << " have different sector size. " << endl;
+                _out << "> Sector size " << sector1len << " vs " << sector2len << endl;
+            }
+            retVal = false;
+            continue;
+        }
+
+        // CRCs are only needed to report differing sectors.
+        if( 0 != memcmp( _track1.sectorData[sector].data(), _track2.sectorData[sector].data(), sector1len ) )
+        {
+            if( _verbose )
+            {
+                unsigned short int crc1 = crc::CCRC16<crc::CRC16_CCITT_POLY>::Compute( _track1.sectorData[sector].data(), sector1len, 0xFFFF );
+                unsigned short int crc2 = crc::CCRC16<crc::CRC16_CCITT_POLY>::Compute( _track2.sectorData[sector].data(), sector2len, 0xFFFF );
+
+                _out << "Disks side " << _side << ", track " << _track << ", sector " << sector;
+                _out << " have different sector data. " << endl;
+                _out << "> CRC " << hex << crc1 << " vs " << crc2 << dec << endl;
+            }
+            retVal = false;
+        }
+    }
+
+    return retVal;
+}
+
+// Compare disk images and show output to the console.
+// Tracks are compared in parallel. With _firstDiff, stops at the first difference found.
+bool Compare( CDSKFile& disk1, CDSKFile& disk2, bool _verbose, bool _firstDiff )
 {
     bool retVal = true;
     const CDSKFile_DiskInfoBlock& info1 = disk1.GetDiskInfoBlock();
@@ -34,9 +177,30 @@ bool Compare( CDSKFile& disk1, CDSKFile& disk2, bool _verbose )
             cout << (int)info2.sidesNum << "." << endl;
         }
         retVal = false; // Disks are different, but let's compare some data.
+
+        if( _firstDiff )
+        {
+            return retVal;
+        }
     }
     int sidesNum = min( info1.sidesNum, info2.sidesNum );
 
+    // Build the list of tracks to compare, side by side.
+    struct STrackJob
+    {
+        const CDSKFile_TrackInfoBlock* track1;
+        const CDSKFile_TrackInfoBlock* track2;
+        int    side;
+        size_t track;
+        string output;
+        bool   same;
+        bool   done;
+    };
+
+    vector<STrackJob> jobs;
+    vector<string> sideMessages( sidesNum );
+    vector<size_t> sideFirstJob( sidesNum + 1, 0 );
+
     for( int side = 0; side < sidesNum; ++side )
     {
         const vector<CDSKFile_TrackInfoBlock>& disk1Side = disk1.GetSide(side != 0);
@@ -47,89 +211,393 @@ bool Compare( CDSKFile& disk1, CDSKFile& disk2, bool _verbose )
         {
             if( _verbose )
             {
-                cout << "Disks side " << side << " have different number of tracks. ";
-                cout << disk1Side.size() << " vs " << disk2Side.size() << "." << endl;
+                stringstream message;
+                message << "Disks side " << side << " have different number of tracks. ";
+                message << disk1Side.size() << " vs " << disk2Side.size() << "." << endl;
+                sideMessages[side] = message.str();
             }
         }
 
         size_t numTracks = min(disk1Side.size(),disk2Side.size());
 
+        sideFirstJob[side] = jobs.size();
         for( size_t track = 0; track < numTracks; ++track )
         {
-            // 3 - Number of sectors
-            if( disk1Side[track].sectorsNum != disk2Side[track].sectorsNum )
+            STrackJob job;
+            job.track1 = &disk1Side[track];
+            job.track2 = &disk2Side[track];
+            job.side   = side;
+            job.track  = track;
+            job.same   = true;
+            job.done   = false;
+            jobs.push_back( job );
+        }
+    }
+    sideFirstJob[sidesNum] = jobs.size();
+
+    // Compare tracks on a pool of workers. When stopping at the first difference,
+    // every track before the first differing one is still compared.
+    RunOnWorkers( jobs.size(), [&]( size_t _idx )
+    {
+        STrackJob& job = jobs[_idx];
+        stringstream output;
+
+        job.same   = CompareTrack( *job.track1, *job.track2, job.side, job.track, _verbose, _firstDiff, output );
+        job.output = output.str();
+        job.done   = true;
+
+        return job.same || !_firstDiff;
+    } );
+
+    // Show results in disk order
+    for( int side = 0; side < sidesNum; ++side )
+    {
+        cout << sideMessages[side];
+
+        for( size_t idx = sideFirstJob[side]; idx < sideFirstJob[side + 1]; ++idx )
+        {
+            // Only tracks after a differing one are ever skipped.
+            if( !jobs[idx].done )
+            {
+                return false;
+            }
+
+            cout << jobs[idx].output;
+
+            if( !jobs[idx].same )
             {
-                if( _verbose )
+                retVal = false;
+
+                if( _firstDiff )
                 {
-                    cout << "Disks side " << side << ", track " << track << " have different number of sectors. ";
-                    cout << (int)disk1Side[track].sectorsNum << " vs " << (int)disk2Side[track].sectorsNum << "." << endl;
+                    return retVal;
                 }
-                retVal = false;
             }
+        }
+    }
+
+    return retVal;
+}
+
+// Checks, one track after another, that two images hold exactly the same data.
+// Used to confirm duplicates, so unlike Compare it also fails on different numbers of tracks.
+bool SameImage( CDSKFile& _disk1, CDSKFile& _disk2 )
+{
+    unsigned char sidesNum = _disk1.GetDiskInfoBlock().sidesNum;
+    if( sidesNum != _disk2.GetDiskInfoBlock().sidesNum )
+    {
+        return false;
+    }
+
+    stringstream output;
+    for( int side = 0; side < sidesNum && side < 2; ++side )
+    {
+        const vector<CDSKFile_TrackInfoBlock>& disk1Side = _disk1.GetSide(side != 0);
+        const vector<CDSKFile_TrackInfoBlock>& disk2Side = _disk2.GetSide(side != 0);
+
+        if( disk1Side.size() != disk2Side.size() )
+        {
+            return false;
+        }
+
+        for( size_t track = 0; track < disk1Side.size(); ++track )
+        {
+            if( !CompareTrack( disk1Side[track], disk2Side[track], side, track, false, true, output ) )
+            {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// 64 bit FNV-1a, used to combine the geometry and sector digests of an image.
+void HashBytes( unsigned long long& _hash, const void* _data, size_t _size )
+{
+    const unsigned char* data = (const unsigned char*)_data;
+    for( size_t idx = 0; idx < _size; ++idx )
+    {
+        _hash ^= data[idx];
+        _hash *= 0x100000001B3ULL;
+    }
+}
+
+// Hashes everything Compare looks at: number of sides, tracks and sectors,
+// sector info and a CRC32 of each sector's data.
+unsigned long long HashImage( CDSKFile& _disk )
+{
+    unsigned long long hash = 0xCBF29CE484222325ULL;
+
+    unsigned char sidesNum = _disk.GetDiskInfoBlock().sidesNum;
+    HashBytes( hash, &sidesNum, 1 );
+
+    for( int side = 0; side < sidesNum && side < 2; ++side )
+    {
+        const vector<CDSKFile_TrackInfoBlock>& tracks = _disk.GetSide(side != 0);
+        unsigned long long tracksNum = tracks.size();
+        HashBytes( hash, &tracksNum, sizeof(tracksNum) );
 
-            // 4 - Sector info and data
-            size_t sectorsNum = disk1Side[track].sectorsNum;
+        for( auto& track : tracks )
+        {
+            HashBytes( hash, &track.sectorsNum, 1 );
 
-            for( size_t sector = 0; sector < sectorsNum; ++sector )
+            for( size_t sector = 0; sector < track.sectorInfoList.size(); ++sector )
             {
-                // Sector info
-                if( sector >= disk1Side[track].sectorInfoList.size() ||
-                    sector >= disk2Side[track].sectorInfoList.size() )
+                const CDSKFile_SectorInfo& info = track.sectorInfoList[sector];
+                unsigned char infoBytes[8] = { info.track, info.side, info.sectorID, info.sectorSize, info.FDCStatus1, info.FDCStatus2,
+                                               (unsigned char)(info.dataLength & 0xFF), (unsigned char)(info.dataLength >> 8) };
+                HashBytes( hash, infoBytes, sizeof(infoBytes) );
+
+                if( sector < track.sectorData.size() )
                 {
-                    continue;
+                    unsigned long long dataSize = track.sectorData[sector].size();
+                    uint32_t dataCRC = crc::CRC32( track.sectorData[sector].data(), track.sectorData[sector].size() );
+                    HashBytes( hash, &dataSize, sizeof(dataSize) );
+                    HashBytes( hash, &dataCRC, sizeof(dataCRC) );
                 }
+            }
+        }
+    }
+
+    return hash;
+}
 
-                if( disk1Side[track].sectorInfoList[sector].track      != disk2Side[track].sectorInfoList[sector].track      ||
-                    disk1Side[track].sectorInfoList[sector].side       != disk2Side[track].sectorInfoList[sector].side       ||
-                    disk1Side[track].sectorInfoList[sector].sectorID   != disk2Side[track].sectorInfoList[sector].sectorID   ||
-                    disk1Side[track].sectorInfoList[sector].sectorSize != disk2Side[track].sectorInfoList[sector].sectorSize ||
-                    disk1Side[track].sectorInfoList[sector].FDCStatus1 != disk2Side[track].sectorInfoList[sector].FDCStatus1 ||
-                    disk1Side[track].sectorInfoList[sector].FDCStatus2 != disk2Side[track].sectorInfoList[sector].FDCStatus2 ||
-                    disk1Side[track].sectorInfoList[sector].dataLength != disk2Side[track].sectorInfoList[sector].dataLength )
+string JSONEscape( const string& _string )
+{
+    string retVal;
+    for( char c : _string )
+    {
+        switch( c )
+        {
+            case '"':  retVal += "\\\""; break;
+            case '\\': retVal += "\\\\"; break;
+            case '\n': retVal += "\\n"; break;
+            case '\r': retVal += "\\r"; break;
+            case '\t': retVal += "\\t"; break;
+            default:
+                if( (unsigned char)c < 0x20 )
                 {
-                    if( _verbose )
-                    {
-                        cout << "Disks side " << side << ", track " << track << ", sector " << sector;
-                        cout << " have different sector info. " << endl;
-                        cout << "> track      " << (int)disk1Side[track].sectorInfoList[sector].track      << " vs " << (int)disk2Side[track].sectorInfoList[sector].track      << endl;
-                        cout << "  side       " << (int)disk1Side[track].sectorInfoList[sector].side       << " vs " << (int)disk2Side[track].sectorInfoList[sector].side       << endl;
-                        cout << "  sectorID   " << (int)disk1Side[track].sectorInfoList[sector].sectorID   << " vs " << (int)disk2Side[track].sectorInfoList[sector].sectorID   << endl;
-                        cout << "  sectorSize " << (int)disk1Side[track].sectorInfoList[sector].sectorSize << " vs " << (int)disk2Side[track].sectorInfoList[sector].sectorSize << endl;
-                        cout << "  FDCStatus1 " << (int)disk1Side[track].sectorInfoList[sector].FDCStatus1 << " vs " << (int)disk2Side[track].sectorInfoList[sector].FDCStatus1 << endl;
-                        cout << "  FDCStatus2 " << (int)disk1Side[track].sectorInfoList[sector].FDCStatus2 << " vs " << (int)disk2Side[track].sectorInfoList[sector].FDCStatus2 << endl;
-                        cout << "  dataLength " << (int)disk1Side[track].sectorInfoList[sector].dataLength << " vs " << (int)disk2Side[track].sectorInfoList[sector].dataLength << endl;
-                    }
-                    retVal = false;
+                    char escaped[8];
+                    snprintf( escaped, sizeof(escaped), "\\u%04x", c );
+                    retVal += escaped;
                 }
+                else
+                {
+                    retVal += c;
+                }
+                break;
+        }
+    }
+    return retVal;
+}
+
+string CSVEscape( const string& _string )
+{
+    if( string::npos == _string.find_first_of( ",\"\r\n" ) )
+    {
+        return _string;
+    }
+
+    string retVal = "\"";
+    for( char c : _string )
+    {
+        if( c == '"' ) retVal += '"';
+        retVal += c;
+    }
+    retVal += '"';
+    return retVal;
+}
+
+// Finds groups of identical images among the .dsk files in _folder and its subfolders.
+// Images are loaded and hashed in parallel; only images with the same hash are
+// loaded again and checked track by track with SameImage.
+bool Dedupe( const string& _folder, const string& _jsonReport, const string& _csvReport, bool _verbose )
+{
+    // Collect image files
+    vector<string> files;
+    error_code errorCode;
+    filesystem::recursive_directory_iterator dirIterator( _folder, filesystem::directory_options::skip_permission_denied, errorCode );
+    if( errorCode )
+    {
+        cout << "Couldn't read folder " << _folder << endl;
+        return false;
+    }
+
+    for( ; dirIterator != filesystem::recursive_directory_iterator(); dirIterator.increment( errorCode ) )
+    {
+        if( errorCode )
+        {
+            break;
+        }
+
+        if( !dirIterator->is_regular_file( errorCode ) )
+        {
+            continue;
+        }
+
+        string extension = dirIterator->path().extension().string();
+        transform( extension.begin(), extension.end(), extension.begin(), ::tolower );
+        if( extension == ".dsk" )
+        {
+            files.push_back( dirIterator->path().string() );
+        }
+    }
+    sort( files.begin(), files.end() );
+
+    // Hash every image
+    vector<unsigned long long> hashes( files.size(), 0 );
+    vector<char> loaded( files.size(), 0 );
+
+    RunOnWorkers( files.size(), [&]( size_t _idx )
+    {
+        CDSKFile disk;
+        if( disk.Load( files[_idx] ) )
+        {
+            hashes[_idx] = HashImage( disk );
+            loaded[_idx] = 1;
+        }
+        return true;
+    } );
+
+    // Bucket by hash
+    map<unsigned long long, vector<size_t>> buckets;
+    vector<string> failed;
+    for( size_t idx = 0; idx < files.size(); ++idx )
+    {
+        if( loaded[idx] )
+        {
+            buckets[hashes[idx]].push_back( idx );
+        }
+        else
+        {
+            failed.push_back( files[idx] );
+        }
+    }
+
+    // Confirm duplicates within each bucket
+    vector<vector<string>> groups;
+    for( auto& bucket : buckets )
+    {
+        if( bucket.second.size() < 2 )
+        {
+            continue;
+        }
+
+        vector<CDSKFile> disks( bucket.second.size() );
+        vector<vector<size_t>> bucketGroups;
+        for( size_t image = 0; image < bucket.second.size(); ++image )
+        {
+            if( !disks[image].Load( files[bucket.second[image]] ) )
+            {
+                continue;
+            }
 
-                // Sector data
-                size_t sector1len = disk1Side[track].sectorData[sector].size();
-                size_t sector2len = disk2Side[track].sectorData[sector].size();
-                if( sector1len != sector2len )
+            bool grouped = false;
+            for( auto& group : bucketGroups )
+            {
+                if( SameImage( disks[group[0]], disks[image] ) )
                 {
-                    if( _verbose )
-                    {
-                        cout << "Disks side " << side << ", track " << track << ", sector " << sector;
-                        cout << " have different sector size. " << endl;
-                        cout << "> Sector size " << sector1len << " vs " << sector2len << endl;
-                    }
-                    retVal = false;
-                    continue;
+                    group.push_back( image );
+                    grouped = true;
+                    break;
                 }
+            }
 
-                size_t dataLength = min(sector1len,sector2len);
-                unsigned short int crc1 = crc::CRC16_MSB( disk1Side[track].sectorData[sector].data(), disk1Side[track].sectorData[sector].size(), crc::CRC16_CCITT_POLY, 0xFFFF );
-                unsigned short int crc2 = crc::CRC16_MSB( disk2Side[track].sectorData[sector].data(), disk2Side[track].sectorData[sector].size(), crc::CRC16_CCITT_POLY, 0xFFFF );
+            if( !grouped )
+            {
+                bucketGroups.push_back( vector<size_t>( 1, image ) );
+            }
+        }
 
-                if( 0 != memcmp( disk1Side[track].sectorData[sector].data(), disk2Side[track].sectorData[sector].data(), dataLength) )
+        for( auto& group : bucketGroups )
+        {
+            if( group.size() < 2 )
+            {
+                continue;
+            }
+
+            vector<string> groupFiles;
+            for( auto image : group )
+            {
+                groupFiles.push_back( files[bucket.second[image]] );
+            }
+            groups.push_back( groupFiles );
+        }
+    }
+    sort( groups.begin(), groups.end() );
+
+    // Console output
+    for( size_t group = 0; group < groups.size(); ++group )
+    {
+        cout << "Group " << group << ":" << endl;
+        for( auto& file : groups[group] )
+        {
+            cout << "    " << file << endl;
+        }
+    }
+
+    if( _verbose )
+    {
+        for( auto& file : failed )
+        {
+            cout << "Couldn't load " << file << endl;
+        }
+    }
+
+    cout << files.size() << " images, " << groups.size() << " duplicate groups, " << failed.size() << " could not be loaded." << endl;
+
+    // Reports
+    bool retVal = true;
+    if( !_jsonReport.empty() )
+    {
+        ofstream jsonFile( _jsonReport );
+        if( !jsonFile.is_open() )
+        {
+            cout << "Couldn't write " << _jsonReport << endl;
+            retVal = false;
+        }
+        else
+        {
+            jsonFile << "{" << endl;
+            jsonFile << "    \"images\": " << files.size() << "," << endl;
+            jsonFile << "    \"failed\": [";
+            for( size_t idx = 0; idx < failed.size(); ++idx )
+            {
+                jsonFile << (idx ? ", " : "") << "\"" << JSONEscape( failed[idx] ) << "\"";
+            }
+            jsonFile << "]," << endl;
+            jsonFile << "    \"groups\": [";
+            for( size_t group = 0; group < groups.size(); ++group )
+            {
+                jsonFile << (group ? "," : "") << endl << "        [";
+                for( size_t idx = 0; idx < groups[group].size(); ++idx )
+                {
+                    jsonFile << (idx ? ", " : "") << "\"" << JSONEscape( groups[group][idx] ) << "\"";
+                }
+                jsonFile << "]";
+            }
+            jsonFile << (groups.empty() ? "" : "\n    ") << "]" << endl;
+            jsonFile << "}" << endl;
+        }
+    }
+
+    if( !_csvReport.empty() )
+    {
+        ofstream csvFile( _csvReport );
+        if( !csvFile.is_open() )
+        {
+            cout << "Couldn't write " << _csvReport << endl;
+            retVal = false;
+        }
+        else
+        {
+            csvFile << "group,file" << endl;
+            for( size_t group = 0; group < groups.size(); ++group )
+            {
+                for( auto& file : groups[group] )
                 {
-                    if( _verbose )
-                    {
-                        cout << "Disks side " << side << ", track " << track << ", sector " << sector;
-                        cout << " have different sector data. " << endl;
-                        cout << "> CRC " << hex << crc1 << " vs " << crc2 << dec << endl;
-                    }
-                    retVal = false;
+                    csvFile << group << "," << CSVEscape( file ) << endl;
                 }
             }
         }
@@ -141,16 +609,22 @@ bool Compare( CDSKFile& disk1, CDSKFile& disk2, bool _verbose )
 void ShowUsage()
 {
     cout << "DskComp Usage:" << endl << endl;
-    cout << "    DskComp filename1 filename2 [options]" << endl << endl;
+    cout << "    DskComp filename1 filename2 [options]" << endl;
+    cout << "    DskComp --dedupe folder [--json report.json] [--csv report.csv] [-v]" << endl << endl;
     cout << "    Options:" << endl;
     cout << "        -v" << endl << "            Verbose, lots of info." << endl << endl;
+    cout << "        --first-diff" << endl << "            Stop at the first difference found." << endl << endl;
     cout << "DskComp returns with 0 if the disk images have the same contents, nonzero otherwise." << endl << endl;
+    cout << "With --dedupe, lists groups of identical .dsk images found in folder and its" << endl;
+    cout << "subfolders, optionally writing them to a JSON or CSV report." << endl;
+    cout << "Returns 0 if the folder could be scanned and the reports written, nonzero otherwise." << endl << endl;
 }
 
 int main(int argc, char** argv)
 {
     // Variables
     bool verbose = false;
+    bool firstDiff = false;
     CDSKFile disk1;
     CDSKFile disk2;
 
@@ -162,9 +636,24 @@ int main(int argc, char** argv)
         return -1;
     }
 
+    if( 0 == strcmp(argv[1],"--dedupe") )
+    {
+        string jsonReport;
+        string csvReport;
+        for( int iArg = 3; iArg < argc; ++iArg )
+        {
+            if( 0 == strcmp(argv[iArg],"-v") ) verbose = true;
+            else if( 0 == strcmp(argv[iArg],"--json") && iArg + 1 < argc ) jsonReport = argv[++iArg];
+            else if( 0 == strcmp(argv[iArg],"--csv") && iArg + 1 < argc ) csvReport = argv[++iArg];
+        }
+
+        return Dedupe( argv[2], jsonReport, csvReport, verbose ) ? 0 : -1;
+    }
+
     for( int iArg = 0; iArg < argc; ++iArg )
     {
         if( 0 == strcmp(argv[iArg],"-v") ) verbose = true;
+        if( 0 == strcmp(argv[iArg],"--first-diff") ) firstDiff = true;
     }
 
     // Load disk images
@@ -181,7 +670,7 @@ int main(int argc, char** argv)
     }
 
     // Compare images
-    if( !Compare(disk1, disk2, verbose) )
+    if( !Compare(disk1, disk2, verbose, firstDiff) )
     {
         return -1;
     }
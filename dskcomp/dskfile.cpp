@@ -71,6 +71,7 @@ bool CDSKFile::Load(const string& _filename)
 		lastError += _filename;
 		lastError += " is less than 256 bytes long. It's either corrupted or not a .DSK file.";
 
+		fclose(pIn);
 		return false;
 	}
 
@@ -14,6 +14,7 @@ const string MMBE_CMD_LIST    = "list";
 const string MMBE_CMD_CREATE  = "create";
 const string MMBE_CMD_REMOVE  = "remove";
 const string MMBE_CMD_EXTRACT = "extract";
+const string MMBE_CMD_EXTRACTALL = "extractall";
 const string MMBE_CMD_LOCK    = "lock";
 const string MMBE_CMD_UNLOCK  = "unlock";
 const string MMBE_CMD_ADD     = "add";
@@ -57,6 +58,12 @@ void ShowHelp()
     cout << "                                              'slot.sdd' (i.e. 34.ssd)."   << endl;
     cout << "          extract 'filename' 'ssdname' slot - Extracts given slot disk as" << endl;
     cout << "                                              given SSD image name."       << endl;
+    cout << "          extractall 'filename' 'folder'    - Extracts every formatted"    << endl;
+    cout << "                                              slot into folder as"         << endl;
+    cout << "                                              'slot_name.ssd'."            << endl;
+    cout << "          extractall 'filename' 'folder' first-last"                       << endl;
+    cout << "                                            - Same, for slots first to"    << endl;
+    cout << "                                              last (i.e. 0-99)."           << endl;
 }
 
 void ListMMB( const string& _filename, string& _errorString )
@@ -199,6 +206,77 @@ void ExtractImage( const std::string& _filename, const std::string& _imageName,
     mmb.ExtractImageInSlot( _imageName, slot, _errorString );
 }
 
+void ExtractAllImages( const std::string& _filename, const std::string& _folder, const std::string& _range, std::string& _errorString )
+{
+    // Open source MMB
+    CMMBFile mmb;
+    if( !mmb.Open(_filename, _errorString) )
+    {
+        return;
+    }
+
+    if( 0 == mmb.GetNumberOfDisks() )
+    {
+        return;
+    }
+
+    // Parse slot range, either 'first-last' or a single slot
+    size_t firstSlot = 0;
+    size_t lastSlot = mmb.GetNumberOfDisks() - 1;
+    if( !_range.empty() )
+    {
+        size_t separator = _range.find( '-' );
+        firstSlot = CheckSlotNumber( mmb, _range.substr( 0, separator ), _errorString );
+        if( !_errorString.empty() )
+        {
+            return;
+        }
+
+        lastSlot = firstSlot;
+        if( string::npos != separator )
+        {
+            lastSlot = CheckSlotNumber( mmb, _range.substr( separator + 1 ), _errorString );
+            if( !_errorString.empty() )
+            {
+                return;
+            }
+        }
+
+        if( lastSlot < firstSlot )
+        {
+            _errorString = "Invalid slot range: ";
+            _errorString += _range;
+            return;
+        }
+    }
+
+    string folderName = _folder;
+#ifdef WIN32
+    if( !folderName.empty() && folderName.back() != '\\' ) folderName += '\\';
+#else
+    if( !folderName.empty() && folderName.back() != '/' ) folderName += '/';
+#endif
+
+    vector<size_t> slots;
+    vector<string> filenames;
+    for( size_t slot = firstSlot; slot <= lastSlot; ++slot )
+    {
+        unsigned char diskAttribute = mmb.GetEntryAttribute( slot );
+        if( MMB_DISKATTRIBUTE_INVALID == diskAttribute || MMB_DISKATTRIBUTE_UNFORMATTED == diskAttribute )
+        {
+            continue;
+        }
+
+        slots.push_back( slot );
+        filenames.push_back( folderName + mmb.GetSlotImageFilename( slot ) );
+    }
+
+    if( mmb.ExtractImagesInSlots( slots, filenames, 0, _errorString ) )
+    {
+        cout << "Extracted " << slots.size() << " disk images." << endl;
+    }
+}
+
 // Execute specified command. Returns true if processed or false for launching gui.
 bool ProcessArguments( int argc, char** argv, string& _errorString )
 {
@@ -289,6 +367,11 @@ bool ProcessArguments( int argc, char** argv, string& _errorString )
             ExtractImage( argv[2], ssdName, argv[3], _errorString );
             return true;
         }
+        else if( 0 == command.compare(MMBE_CMD_EXTRACTALL) )
+        {
+            ExtractAllImages( argv[2], argv[3], "", _errorString );
+            return true;
+        }
         else
         {
             ShowHelp();
@@ -314,6 +397,11 @@ bool ProcessArguments( int argc, char** argv, string& _errorString )
             ExtractImage( argv[2], argv[3], argv[4], _errorString );
             return true;
         }
+        else if( 0 == command.compare(MMBE_CMD_EXTRACTALL) )
+        {
+            ExtractAllImages( argv[2], argv[3], argv[4], _errorString );
+            return true;
+        }
         else
         {
             ShowHelp();
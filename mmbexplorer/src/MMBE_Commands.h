@@ -11,6 +11,7 @@ void LockImage   ( const std::string& _filename, const std::string& _slot,     s
 void UnlockImage ( const std::string& _filename, const std::string& _slot,     std::string& _errorString );
 void AddImage    ( const std::string& _filename, const std::string& _imageName, const std::string& _slot, std::string& _errorString );
 void ExtractImage( const std::string& _filename, const std::string& _imageName, const std::string& _slot, std::string& _errorString );
+void ExtractAllImages( const std::string& _filename, const std::string& _folder, const std::string& _range, std::string& _errorString );
 
 // Execute specified command. Returns true if processed or false for launching gui.
 bool ProcessArguments( int argc, char** argv, std::string& _errorString );
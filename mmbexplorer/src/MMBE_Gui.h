@@ -180,6 +180,7 @@ private:
 
     void SetTableSize(int ccount, int rcount) const;
 
+    void CommitBatch();
 
     bool LoadFile( const std::string& _filename, DFSEntry& _dst, std::string& _errorString );
 
@@ -209,4 +210,9 @@ private:
 
     // Boot options dialog
     CMMBE_BootOptionsWindow* mBootOptionsWindow = nullptr;
+
+    // CRC32 of every file in the last slot checksummed by GetFileCRC
+    size_t mCRCCacheSlot = (size_t)-1;
+    size_t mCRCCacheRevision = 0;
+    std::vector<uint32_t> mCRCCache;
 };
@@ -1,9 +1,16 @@
 #define _CRT_SECURE_NO_WARNINGS
 
 #include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
 #include <string.h> // for memset
+#include <fcntl.h>
 #include "MMBFile.h"
 #ifdef WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
 #include <io.h>
 #else
 #include <unistd.h>
@@ -17,6 +24,7 @@ const size_t bytesInKilobyte = 1024;
 CMMBFile::CMMBFile()
 {
     mDirectory = new SMMBDirectoryEntry[MMB_MAXNUMBEROFDISKS];
+    mDirectoryEntries = MMB_MAXNUMBEROFDISKS;
 }
 
 CMMBFile::~CMMBFile()
@@ -155,6 +163,10 @@ bool CMMBFile::Create(const std::string& _filename, size_t _numberOfDisks, std::
 
 void CMMBFile::Close()
 {
+    mSessionActive = false;
+    CancelBatch();
+    ++mRevision;
+
     if (nullptr != mFile)
     {
         fclose(mFile);
@@ -203,6 +215,7 @@ bool CMMBFile::Resize(size_t _numberOfDisks, std::string& _errorString)
     }
 
     size_t diskCount = 1;
+    fseek(mFile, 0, SEEK_SET);
     if (_numberOfDisks > mNumberOfDisks)
     {
         while (_numberOfDisks > 0) {
@@ -256,6 +269,7 @@ bool CMMBFile::Resize(size_t _numberOfDisks, std::string& _errorString)
     fwrite(&chunks, 1, 1, mFile);
 
     CloseMMBFileInternal();
+    ++mRevision;
 
     mFileSize = newsize;
     mNumberOfChunks = (mFileSize + MMB_CHUNKSIZE - 1) / (MMB_DIRECTORYSIZE + (MMB_MAXNUMBEROFDISKS * MMB_DISKSIZE));
@@ -327,10 +341,224 @@ unsigned char CMMBFile::GetEntryAttribute( size_t _entry )
     return mDirectory[_entry].diskAttributes; 
 }
 
+bool CMMBFile::BeginSession( std::string& _errorString )
+{
+    if( mFilename.empty() )
+    {
+        _errorString = "No MMB file opened.";
+        return false;
+    }
+
+    if( !OpenMMBFileInternal() )
+    {
+        _errorString = "Could not open file ";
+        _errorString += mFilename;
+        return false;
+    }
+
+    mSessionActive = true;
+
+    return true;
+}
+
+void CMMBFile::EndSession()
+{
+    mSessionActive = false;
+    CloseMMBFileInternal();
+}
+
+void CMMBFile::BeginBatch()
+{
+    mBatch.clear();
+    mBatchActive = true;
+}
+
+void CMMBFile::CancelBatch()
+{
+    mBatch.clear();
+    mBatchActive = false;
+}
+
+bool CMMBFile::Commit( std::string& _errorString )
+{
+    if( !mBatchActive )
+    {
+        _errorString = "No batch in progress.";
+        return false;
+    }
+
+    std::vector<SMMBBatchOperation> batch;
+    batch.swap( mBatch );
+    mBatchActive = false;
+
+    if( batch.empty() )
+    {
+        return true;
+    }
+
+    if( !OpenMMBFileInternal() )
+    {
+        _errorString = "No MMB file opened.";
+        Close();
+        return false;
+    }
+
+    // Slot order is file order. Operations on the same slot keep the order they were queued in.
+    std::stable_sort( batch.begin(), batch.end(), []( const SMMBBatchOperation& _a, const SMMBBatchOperation& _b ) { return _a.slot < _b.slot; } );
+
+    const std::vector<unsigned char> emptyImage( MMB_DISKSIZE, 0 );
+    unsigned char directory[MMB_DIRECTORYSIZE];
+    bool retVal = true;
+    size_t op = 0;
+
+    while( retVal && op < batch.size() )
+    {
+        size_t chunk = batch[op].slot / MMB_MAXNUMBEROFDISKS;
+        size_t chunkOffset = MMB_CHUNKSIZE * chunk;
+        size_t firstOp = op;
+        size_t lastOp = op;
+        while( lastOp < batch.size() && batch[lastOp].slot / MMB_MAXNUMBEROFDISKS == chunk )
+        {
+            ++lastOp;
+        }
+
+        fseek( mFile, chunkOffset, SEEK_SET );
+        if( MMB_DIRECTORYSIZE != fread( directory, 1, MMB_DIRECTORYSIZE, mFile ) )
+        {
+            _errorString = "Could not read directory of chunk ";
+            _errorString += std::to_string( chunk );
+            retVal = false;
+            break;
+        }
+
+        // Patch the chunk's directory in memory and write it back once.
+        for( op = firstOp; op < lastOp; ++op )
+        {
+            const SMMBBatchOperation& operation = batch[op];
+            unsigned char* entry = &directory[((operation.slot % MMB_MAXNUMBEROFDISKS) + 1) * MMB_DIRECTORYENTRYSIZE];
+
+            switch( operation.type )
+            {
+                case EMMBBatch_Insert:
+                    memset( entry, 0, MMB_DIRECTORYENTRYSIZE );
+                    memcpy( &entry[0], operation.data->data(), 8 );
+                    memcpy( &entry[8], &operation.data->data()[256], 4 );
+                    entry[MMB_DIRECTORYENTRYSIZE - 1] = MMB_DISKATTRIBUTE_UNLOCKED;
+                    break;
+                case EMMBBatch_Remove:
+                    memcpy( entry, emptyDirectoryEntry, MMB_DIRECTORYENTRYSIZE );
+                    break;
+                case EMMBBatch_Lock:
+                    entry[MMB_DIRECTORYENTRYSIZE - 1] = MMB_DISKATTRIBUTE_LOCKED;
+                    break;
+                case EMMBBatch_Unlock:
+                    entry[MMB_DIRECTORYENTRYSIZE - 1] = MMB_DISKATTRIBUTE_UNLOCKED;
+                    break;
+                case EMMBBatch_Rename:
+                    memcpy( entry, operation.name.c_str(), MMB_MAXDISKNAMELENGTH );
+                    break;
+            }
+        }
+
+        fseek( mFile, chunkOffset, SEEK_SET );
+        if( MMB_DIRECTORYSIZE != fwrite( directory, 1, MMB_DIRECTORYSIZE, mFile ) )
+        {
+            _errorString = "Could not write directory of chunk ";
+            _errorString += std::to_string( chunk );
+            retVal = false;
+            break;
+        }
+
+        // Then the disk data, in ascending offset order.
+        for( op = firstOp; retVal && op < lastOp; ++op )
+        {
+            const SMMBBatchOperation& operation = batch[op];
+            size_t diskOffset = chunkOffset + MMB_DIRECTORYSIZE + ((operation.slot % MMB_MAXNUMBEROFDISKS) * MMB_DISKSIZE);
+
+            switch( operation.type )
+            {
+                case EMMBBatch_Insert:
+                    fseek( mFile, diskOffset, SEEK_SET );
+                    retVal = ( MMB_DISKSIZE == fwrite( operation.data->data(), 1, MMB_DISKSIZE, mFile ) );
+                    break;
+                case EMMBBatch_Remove:
+                    fseek( mFile, diskOffset, SEEK_SET );
+                    retVal = ( MMB_DISKSIZE == fwrite( emptyImage.data(), 1, MMB_DISKSIZE, mFile ) );
+                    break;
+                case EMMBBatch_Rename:
+                    fseek( mFile, diskOffset, SEEK_SET );
+                    retVal = ( 8 == fwrite( operation.name.c_str(), 1, 8, mFile ) );
+                    fseek( mFile, diskOffset + MMB_SECTORSIZE, SEEK_SET );
+                    retVal = retVal && ( 4 == fwrite( &operation.name.c_str()[8], 1, 4, mFile ) );
+                    break;
+                default:
+                    break;
+            }
+
+            if( !retVal )
+            {
+                _errorString = "Could not write disk image in slot ";
+                _errorString += std::to_string( operation.slot );
+            }
+        }
+
+        for( size_t updated = firstOp; updated < lastOp; ++updated )
+        {
+            size_t slot = batch[updated].slot;
+            SetDirectoryEntry( slot, &directory[((slot % MMB_MAXNUMBEROFDISKS) + 1) * MMB_DIRECTORYENTRYSIZE] );
+        }
+
+        op = lastOp;
+    }
+
+    CloseMMBFileInternal();
+    ++mRevision;
+
+    return retVal;
+}
+
+void CMMBFile::QueueOperation( EMMBBatch_OperationType _type, size_t _slot, const std::string& _name )
+{
+    SMMBBatchOperation operation;
+    operation.type = _type;
+    operation.slot = _slot;
+    operation.name = _name;
+
+    mBatch.push_back( operation );
+}
+
+void CMMBFile::QueueInsert( const unsigned char* _data, size_t _dataSize, size_t _slot )
+{
+    std::shared_ptr<std::vector<unsigned char>> image = std::make_shared<std::vector<unsigned char>>( MMB_DISKSIZE, 0 );
+    memcpy( image->data(), _data, std::min( _dataSize, MMB_DISKSIZE ) );
+
+    SMMBBatchOperation operation;
+    operation.type = EMMBBatch_Insert;
+    operation.slot = _slot;
+
+    // Formatting many slots queues the same image over and over, so keep a single copy.
+    if( !mBatch.empty() && mBatch.back().type == EMMBBatch_Insert && *mBatch.back().data == *image )
+    {
+        operation.data = mBatch.back().data;
+    }
+    else
+    {
+        operation.data = image;
+    }
+
+    mBatch.push_back( operation );
+}
+
 bool CMMBFile::OpenMMBFileInternal()
 {
     if( nullptr != mFile )
     {
+        // Reuse the session handle. Every operation seeks before reading or writing.
+        if( mSessionActive )
+        {
+            return true;
+        }
+
         fclose( mFile );
     }
 
@@ -343,6 +571,12 @@ void CMMBFile::CloseMMBFileInternal()
 {
     if( nullptr != mFile )
     {
+        if( mSessionActive )
+        {
+            fflush( mFile );
+            return;
+        }
+
         fclose( mFile );
         mFile = nullptr;
     }
@@ -355,49 +589,38 @@ void CMMBFile::ReadDirectory()
         return;
     }
 
-    ClearDirectory();
-    
-    // Read entries
-    char tmpChar = 0;
-    size_t bytesRead = 0;
-    size_t tmpBoot[4];
-    size_t drive;
-
-    fseek(mFile, 0, SEEK_SET);
-
-    for( drive = 0; drive < 4; ++drive )
+    if( mDirectoryEntries != mNumberOfChunks * MMB_MAXNUMBEROFDISKS )
     {
-        bytesRead = fread(&tmpChar, 1, 1, mFile);
-        tmpBoot[drive] = tmpChar;
+        if (mDirectory) delete[] mDirectory;
+        mDirectoryEntries = mNumberOfChunks * MMB_MAXNUMBEROFDISKS;
+        mDirectory = new SMMBDirectoryEntry[mDirectoryEntries];
     }
 
-    for( drive = 0; drive < 4; ++drive )
-    {
-        bytesRead = fread(&tmpChar, 1, 1, mFile);
-        tmpBoot[drive] += 256*tmpChar;
-        SetDriveBootDisk( drive, tmpBoot[drive] );
-    }
+    ClearDirectory();
 
-    if (mDirectory) delete[] mDirectory;
-    mDirectory = new SMMBDirectoryEntry[mNumberOfChunks* MMB_MAXNUMBEROFDISKS];
+    // Read every chunk's directory with a single call.
+    unsigned char directory[MMB_DIRECTORYSIZE];
 
     for (size_t chunk = 0; chunk < mNumberOfChunks; chunk++) {
 
-        // seek to first entry of correct chunk
-        fseek(mFile,MMB_DIRECTORYENTRYSIZE+MMB_CHUNKSIZE*chunk, SEEK_SET);
-        for (size_t entry = 0; entry < MMB_MAXNUMBEROFDISKS; ++entry)
+        fseek(mFile, MMB_CHUNKSIZE*chunk, SEEK_SET);
+        if( MMB_DIRECTORYSIZE != fread(directory, 1, MMB_DIRECTORYSIZE, mFile) )
         {
-            for (size_t nameChar = 0; nameChar < MMB_MAXDISKNAMELENGTH; ++nameChar)
+            break;
+        }
+
+        // The first entry of the first chunk holds the boot disks.
+        if( 0 == chunk )
+        {
+            for( size_t drive = 0; drive < 4; ++drive )
             {
-                bytesRead = fread(&tmpChar, 1, 1, mFile);
-                mDirectory[entry + (chunk * MMB_MAXNUMBEROFDISKS)].name += tmpChar;
+                SetDriveBootDisk( drive, directory[drive] + 256 * directory[drive + 4] );
             }
+        }
 
-            // Skip 3 bytes
-            fseek(mFile, 3, SEEK_CUR);
-
-            // Read disk atributes byte
-            bytesRead = fread(&mDirectory[entry+(chunk*MMB_MAXNUMBEROFDISKS)].diskAttributes, 1, 1, mFile);
+        for (size_t entry = 0; entry < MMB_MAXNUMBEROFDISKS; ++entry)
+        {
+            SetDirectoryEntry( entry + (chunk * MMB_MAXNUMBEROFDISKS), &directory[(entry + 1) * MMB_DIRECTORYENTRYSIZE] );
         }
     }
 
@@ -406,13 +629,25 @@ void CMMBFile::ReadDirectory()
 
 void CMMBFile::ClearDirectory()
 {
-    for( size_t entry = 0; entry < MMB_MAXNUMBEROFDISKS; ++entry )
+    for( size_t entry = 0; entry < mDirectoryEntries; ++entry )
     {
         mDirectory[entry].name = "";
         mDirectory[entry].diskAttributes = MMB_DISKATTRIBUTE_INVALID;
     }
 }
 
+// Updates the in-memory copy of a slot's 16 byte directory entry.
+void CMMBFile::SetDirectoryEntry( size_t _slot, const unsigned char* _entry )
+{
+    if( _slot >= mDirectoryEntries )
+    {
+        return;
+    }
+
+    mDirectory[_slot].name.assign( (const char*)_entry, MMB_MAXDISKNAMELENGTH );
+    mDirectory[_slot].diskAttributes = _entry[MMB_DIRECTORYENTRYSIZE - 1];
+}
+
 size_t CMMBFile::GetNumberOfDisks() const
 {
     return mNumberOfDisks;
@@ -491,6 +726,14 @@ bool CMMBFile::InsertImageInSlot( const std::string& _filename, size_t _slot, st
     bytesRead = fread( pImage, 1, fileSize, pFile );
     fclose( pFile );
 
+    if( mBatchActive )
+    {
+        QueueInsert( pImage, MMB_DISKSIZE, _slot );
+        delete[] pImage;
+        CloseMMBFileInternal();
+        return true;
+    }
+
     // Write directory entry
     unsigned char directoryEntry[MMB_DIRECTORYENTRYSIZE];
     memset( directoryEntry, 0, MMB_DIRECTORYENTRYSIZE );
@@ -514,7 +757,8 @@ bool CMMBFile::InsertImageInSlot( const std::string& _filename, size_t _slot, st
     // Cleanup
     delete[] pImage;
 
-    ReadDirectory();
+    SetDirectoryEntry( _slot, directoryEntry );
+    ++mRevision;
 
     return true;
 }
@@ -540,6 +784,13 @@ bool CMMBFile::InsertImageInSlot( const unsigned char* _data, size_t _dataSize,
         return false;
     }
 
+    if( mBatchActive )
+    {
+        QueueInsert( _data, _dataSize, _slot );
+        CloseMMBFileInternal();
+        return true;
+    }
+
     // Write directory entry
     unsigned char directoryEntry[MMB_DIRECTORYENTRYSIZE];
     memset( directoryEntry, 0, MMB_DIRECTORYENTRYSIZE );
@@ -559,7 +810,8 @@ bool CMMBFile::InsertImageInSlot( const unsigned char* _data, size_t _dataSize,
     fwrite( _data, 1, MMB_DISKSIZE, mFile );
     CloseMMBFileInternal();
 
-    ReadDirectory();
+    SetDirectoryEntry( _slot, directoryEntry );
+    ++mRevision;
 
     return true;
 }
@@ -640,6 +892,166 @@ bool CMMBFile::ExtractImageInSlot( unsigned char* _data, size_t _slot, std::stri
     return true;
 }
 
+// Reads _size bytes at _offset without touching the descriptor's file position,
+// so several threads can read through the same descriptor at once.
+static bool ReadAt( int _fd, unsigned char* _dst, size_t _size, size_t _offset )
+{
+#ifdef WIN32
+    HANDLE handle = (HANDLE)_get_osfhandle( _fd );
+    OVERLAPPED overlapped;
+    memset( &overlapped, 0, sizeof(overlapped) );
+    overlapped.Offset = (DWORD)( (unsigned long long)_offset & 0xFFFFFFFF );
+    overlapped.OffsetHigh = (DWORD)( (unsigned long long)_offset >> 32 );
+
+    DWORD bytesRead = 0;
+    return ReadFile( handle, _dst, (DWORD)_size, &bytesRead, &overlapped ) && bytesRead == _size;
+#else
+    while( _size > 0 )
+    {
+        ssize_t bytesRead = pread( _fd, _dst, _size, (off_t)_offset );
+        if( bytesRead <= 0 )
+        {
+            return false;
+        }
+
+        _dst += bytesRead;
+        _size -= bytesRead;
+        _offset += bytesRead;
+    }
+
+    return true;
+#endif
+}
+
+bool CMMBFile::ExtractImagesInSlots( const std::vector<size_t>& _slots, const std::vector<std::string>& _filenames, size_t _threads, std::string& _errorString )
+{
+    if( mFilename.empty() )
+    {
+        _errorString = "No MMB file opened.";
+        return false;
+    }
+
+    if( _slots.size() != _filenames.size() )
+    {
+        _errorString = "Number of slots and file names don't match.";
+        return false;
+    }
+
+    for( auto slot : _slots )
+    {
+        if( slot >= GetNumberOfDisks() )
+        {
+            _errorString = "Slot number out of range or invalid: ";
+            _errorString += std::to_string( slot );
+            _errorString += " ( max slot number is ";
+            _errorString += std::to_string( GetNumberOfDisks() - 1);
+            _errorString += ").";
+            return false;
+        }
+    }
+
+    if( _slots.empty() )
+    {
+        return true;
+    }
+
+    // Make pending writes of the session handle visible to the reads below.
+    if( nullptr != mFile )
+    {
+        fflush( mFile );
+    }
+
+#ifdef WIN32
+    int fd = _open( mFilename.c_str(), _O_RDONLY | _O_BINARY );
+#else
+    int fd = open( mFilename.c_str(), O_RDONLY );
+#endif
+    if( fd < 0 )
+    {
+        _errorString = "Could not open file ";
+        _errorString += mFilename;
+        return false;
+    }
+
+    if( 0 == _threads )
+    {
+        _threads = std::thread::hardware_concurrency();
+    }
+    _threads = std::max( (size_t)1, std::min( _threads, _slots.size() ) );
+
+    std::atomic<size_t> nextSlot( 0 );
+    std::mutex errorMutex;
+    bool retVal = true;
+
+    auto worker = [&]()
+    {
+        std::vector<unsigned char> image( MMB_DISKSIZE );
+        std::string error;
+
+        for( size_t idx = nextSlot++; idx < _slots.size(); idx = nextSlot++ )
+        {
+            size_t chunk = _slots[idx] / MMB_MAXNUMBEROFDISKS;
+            size_t dnum = _slots[idx] % MMB_MAXNUMBEROFDISKS;
+
+            error.clear();
+            if( !ReadAt( fd, image.data(), MMB_DISKSIZE, MMB_CHUNKSIZE * chunk + MMB_DIRECTORYSIZE + (dnum * MMB_DISKSIZE) ) )
+            {
+                error = "Could not read disk image in slot ";
+                error += std::to_string( _slots[idx] );
+            }
+            else
+            {
+                FILE* pDestinationFile = fopen( _filenames[idx].c_str(), "wb" );
+                if( nullptr == pDestinationFile )
+                {
+                    error = "Could not create/overwrite destination file ";
+                    error += _filenames[idx];
+                }
+                else
+                {
+                    if( MMB_DISKSIZE != fwrite( image.data(), 1, MMB_DISKSIZE, pDestinationFile ) )
+                    {
+                        error = "Could not write destination file ";
+                        error += _filenames[idx];
+                    }
+                    fclose( pDestinationFile );
+                }
+            }
+
+            // Keep going with the remaining slots, but report the first failure.
+            if( !error.empty() )
+            {
+                std::lock_guard<std::mutex> lock( errorMutex );
+                if( retVal )
+                {
+                    _errorString = error;
+                    retVal = false;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for( size_t thread = 1; thread < _threads; ++thread )
+    {
+        workers.push_back( std::thread( worker ) );
+    }
+    worker();
+
+    for( auto& thread : workers )
+    {
+        thread.join();
+    }
+
+#ifdef WIN32
+    _close( fd );
+#else
+    close( fd );
+#endif
+
+    return retVal;
+}
+
 bool CMMBFile::LockImageInSlot( size_t _slot, std::string& _errorString )
 {
     if( !OpenMMBFileInternal() )
@@ -661,6 +1073,13 @@ bool CMMBFile::LockImageInSlot( size_t _slot, std::string& _errorString )
         return false;
     }
 
+    if( mBatchActive )
+    {
+        QueueOperation( EMMBBatch_Lock, _slot );
+        CloseMMBFileInternal();
+        return true;
+    }
+
     size_t chunk = _slot / MMB_MAXNUMBEROFDISKS;
     size_t dnum = _slot % MMB_MAXNUMBEROFDISKS;
 
@@ -668,7 +1087,7 @@ bool CMMBFile::LockImageInSlot( size_t _slot, std::string& _errorString )
     fwrite( &MMB_DISKATTRIBUTE_LOCKED, 1, 1, mFile );
     CloseMMBFileInternal();
 
-    ReadDirectory();
+    mDirectory[_slot].diskAttributes = MMB_DISKATTRIBUTE_LOCKED;
 
     return true;
 }
@@ -694,6 +1113,13 @@ bool CMMBFile::UnlockImageInSlot( size_t _slot, std::string& _errorString )
         return false;
     }
 
+    if( mBatchActive )
+    {
+        QueueOperation( EMMBBatch_Unlock, _slot );
+        CloseMMBFileInternal();
+        return true;
+    }
+
     size_t chunk = _slot / MMB_MAXNUMBEROFDISKS;
     size_t dnum = _slot % MMB_MAXNUMBEROFDISKS;
 
@@ -701,7 +1127,7 @@ bool CMMBFile::UnlockImageInSlot( size_t _slot, std::string& _errorString )
     fwrite( &MMB_DISKATTRIBUTE_UNLOCKED, 1, 1, mFile );
     CloseMMBFileInternal();
 
-    ReadDirectory();
+    mDirectory[_slot].diskAttributes = MMB_DISKATTRIBUTE_UNLOCKED;
 
     return true;
 }
@@ -727,6 +1153,13 @@ bool CMMBFile::RemoveImageFromSlot( size_t _slot, std::string& _errorString )
         return false;
     }
 
+    if( mBatchActive )
+    {
+        QueueOperation( EMMBBatch_Remove, _slot );
+        CloseMMBFileInternal();
+        return true;
+    }
+
     size_t chunk = _slot / MMB_MAXNUMBEROFDISKS;
     size_t dnum = _slot % MMB_MAXNUMBEROFDISKS;
 
@@ -751,11 +1184,30 @@ bool CMMBFile::RemoveImageFromSlot( size_t _slot, std::string& _errorString )
     CloseMMBFileInternal();
     delete[] pImage;
 
-    ReadDirectory();
+    SetDirectoryEntry( _slot, emptyDirectoryEntry );
+    ++mRevision;
 
     return true;
 }
 
+std::string CMMBFile::GetSlotImageFilename( size_t _slot ) const
+{
+    std::string filename = std::to_string( _slot );
+    if( filename.length() < 3 )
+    {
+        filename.insert( filename.begin(), 3 - filename.length(), '0' );
+    }
+
+    filename += '_';
+    if( _slot < mDirectoryEntries )
+    {
+        filename += mDirectory[_slot].name.c_str();
+    }
+    filename += ".ssd";
+
+    return filename;
+}
+
 const std::string& CMMBFile::GetFilename()
 {
     return mFilename;
@@ -791,6 +1243,7 @@ bool CMMBFile::LockFile( size_t _slot, size_t _fileIndex, std::string& _errorStr
     fseek( mFile, -1, SEEK_CUR );
     fwrite( &statusByte, 1, 1, mFile );
     CloseMMBFileInternal();
+    ++mRevision;
     
     return true;
 }
@@ -825,6 +1278,7 @@ bool CMMBFile::UnlockFile( size_t _slot, size_t _fileIndex, std::string& _errorS
     fseek( mFile, -1, SEEK_CUR );
     fwrite( &statusByte, 1, 1, mFile );
     CloseMMBFileInternal();
+    ++mRevision;
 
     return true;
 }
@@ -860,6 +1314,13 @@ bool CMMBFile::NameDisk( size_t _slot, const std::string& _diskName, std::string
         finalName.insert( finalName.end(), 12 - finalName.length(), ' ' );
     }
 
+    if( mBatchActive )
+    {
+        QueueOperation( EMMBBatch_Rename, _slot, finalName );
+        CloseMMBFileInternal();
+        return true;
+    }
+
     size_t chunk = _slot / MMB_MAXNUMBEROFDISKS;
     size_t dnum = _slot % MMB_MAXNUMBEROFDISKS;
 
@@ -873,7 +1334,8 @@ bool CMMBFile::NameDisk( size_t _slot, const std::string& _diskName, std::string
     fwrite( &finalName.c_str()[8], 1, 4, mFile );
     CloseMMBFileInternal();
 
-    ReadDirectory();
+    mDirectory[_slot].name = finalName;
+    ++mRevision;
 
     return true;
 }
@@ -912,6 +1374,7 @@ bool CMMBFile::SetBootOption( size_t _slot, unsigned char _bootOption, std::stri
     fseek( mFile, -1, SEEK_CUR );
     fwrite( &optionsByte, 1, 1, mFile );
     CloseMMBFileInternal();
+    ++mRevision;
 
     return true;
 }
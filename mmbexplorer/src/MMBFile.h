@@ -1,5 +1,7 @@
 #pragma once
 #include <string>
+#include <vector>
+#include <memory>
 
 const unsigned char MMB_DISKATTRIBUTE_INVALID     = 0xFF; // Disk does not exist
 const unsigned char MMB_DISKATTRIBUTE_UNFORMATTED = 0xF0; // Unformatted
@@ -20,6 +22,23 @@ struct SMMBDirectoryEntry
     unsigned char diskAttributes = MMB_DISKATTRIBUTE_INVALID;
 };
 
+enum EMMBBatch_OperationType
+{
+    EMMBBatch_Insert,
+    EMMBBatch_Remove,
+    EMMBBatch_Lock,
+    EMMBBatch_Unlock,
+    EMMBBatch_Rename
+};
+
+struct SMMBBatchOperation
+{
+    EMMBBatch_OperationType type;
+    size_t slot;
+    std::shared_ptr<const std::vector<unsigned char>> data; // Disk image for inserts, shared between identical ones
+    std::string name;                                       // New disk name for renames
+};
+
 class CMMBFile
 {
 public:
@@ -30,6 +49,24 @@ public:
     bool Create( const std::string& _filename, size_t _numberOfDisks, std::string& _errorString ) const;
     void Close ();
 
+    // Session mode keeps the MMB file handle open between operations,
+    // instead of reopening the file for every slot operation.
+    bool BeginSession( std::string& _errorString );
+    void EndSession  ();
+    bool IsSessionActive() const { return mSessionActive; }
+
+    // Between BeginBatch and Commit, InsertImageInSlot, RemoveImageFromSlot,
+    // Lock/UnlockImageInSlot and NameDisk only validate and queue the change.
+    // Commit applies them in file order, writing each chunk's directory once.
+    // Reads done before Commit see the file as it was when the batch began.
+    void BeginBatch ();
+    bool Commit     ( std::string& _errorString );
+    void CancelBatch();
+    bool IsBatchActive() const { return mBatchActive; }
+
+    // Changes whenever disk contents may have changed, so cached data can be checked for staleness.
+    size_t GetRevision() const { return mRevision; }
+
 
     const SMMBDirectoryEntry* GetDirectory();
     size_t GetNumberOfDisks() const;
@@ -43,6 +80,9 @@ public:
     bool InsertImageInSlot  ( const unsigned char* _data, size_t _dataSize, size_t _slot, std::string& _errorString );
     bool ExtractImageInSlot ( const std::string& _filename, size_t _slot, std::string& _errorString );
     bool ExtractImageInSlot ( unsigned char* _data, size_t _slot, std::string& _errorString );
+    // Extracts _slots[n] to _filenames[n] using a pool of _threads workers (0 uses one per core)
+    // doing positional reads on a single shared handle.
+    bool ExtractImagesInSlots( const std::vector<size_t>& _slots, const std::vector<std::string>& _filenames, size_t _threads, std::string& _errorString );
     bool LockImageInSlot    ( size_t _slot, std::string& _errorString );
     bool UnlockImageInSlot  ( size_t _slot, std::string& _errorString );
     bool RemoveImageFromSlot( size_t _slot, std::string& _errorString );
@@ -51,6 +91,8 @@ public:
     
     const char*   GetEntryName     ( size_t _entry );
     unsigned char GetEntryAttribute( size_t _entry );
+    // Default file name for a slot's extracted image, i.e. 034_DISKNAME.ssd
+    std::string   GetSlotImageFilename( size_t _slot ) const;
 
     bool NameDisk     ( size_t _slot, const std::string& _diskName, std::string& _errorString );
     bool LockFile     ( size_t _slot, size_t _fileIndex, std::string& _errorString );
@@ -62,6 +104,9 @@ private:
     void CloseMMBFileInternal();
     void ReadDirectory();
     void ClearDirectory();
+    void SetDirectoryEntry( size_t _slot, const unsigned char* _entry );
+    void QueueOperation( EMMBBatch_OperationType _type, size_t _slot, const std::string& _name = "" );
+    void QueueInsert   ( const unsigned char* _data, size_t _dataSize, size_t _slot );
 
     std::string mFilename;
     FILE* mFile = nullptr;
@@ -70,4 +115,9 @@ private:
     size_t mNumberOfChunks = 0;
     size_t mDriveBootDisks[4] = { 0, 0, 0, 0 };
     SMMBDirectoryEntry *mDirectory = 0;
+    size_t mDirectoryEntries = 0;
+    bool mSessionActive = false;
+    bool mBatchActive = false;
+    std::vector<SMMBBatchOperation> mBatch;
+    size_t mRevision = 0;
 };
\ No newline at end of file